@@ -8,4 +8,3 @@ typedef enum {FALSE = 0, TRUE} BOOL;        /* Define Bool boolean types.    */
 
 
 #endif /* __BOOLEAN_H */
-
\ No newline at end of file
@@ -27,9 +27,61 @@
 #define SYSOK        0                      /* Return code = good.           */
 
 #define SYSNOMSG     1                      /* No messages to receive.       */
+#define SYSTIMEOUT   2                      /* Timed out before it happened. */
+
+#define OS_SET_TIMEOUT  0x7f00              /* OsControl(): read timeout.    */
+
+#define OS_EVENT_ANY    0                   /* OsEventWait(): any flag will  */
+#define OS_EVENT_ALL    1                   /* do, or all flags in the mask, */
+#define OS_EVENT_CLEAR  2                   /* and clear them when they do.  */
+
+#define OS_RW_WRITERS   1                   /* OsRwCreate(): writers first.  */
+
+#define OS_PORT_BALANCE   0                 /* OsPortCreate(): one receiver  */
+#define OS_PORT_BROADCAST 1                 /* gets each, or every member.   */
+
+#define OS_ORDER_FIFO   0                   /* Waiters served as they came.  */
+#define OS_ORDER_PRIO   1                   /* Most urgent waiter first.     */
+
+#ifndef NPRIO                               /* Priority levels. OsCreate()   */
+#define NPRIO          32                   /* takes 1 to NPRIO-1, anything  */
+#endif                                      /* else is SYSERR. 0 is INIT's.  */
 
 typedef unsigned long  HANDLE;              /* Universal OS handle.          */
 
+#if defined(OS_HOSTED) && !defined(far)
+#define far                                 /* No far pointers on the host.  */
+#endif
+
+typedef struct {                            /* Object for OsWaitAny/All():   */
+   int      Type;                           /* OS_WAIT_SEM, _MSG or _DEV.    */
+   HANDLE   Handle;                         /* Semaphore or device handle.   */
+} WAITOBJ;
+
+#define OS_WAIT_SEM  1                      /* Semaphore has a count.        */
+#define OS_WAIT_MSG  2                      /* Own message queue not empty.  */
+#define OS_WAIT_DEV  3                      /* Device read would not wait.   */
+
+typedef struct {                            /* Semaphore with a fast path:   */
+   long     Count;                          /* waits and posts that need not */
+   HANDLE   Sem;                            /* block or wake skip the kernel.*/
+} FASTSEM;
+
+typedef struct {                            /* Reader-writer lock:           */
+   unsigned long State;                     /* readers, writer and waiting.  */
+   int      Options;                        /* OS_RW_WRITERS.                */
+   HANDLE   ReadSem;                        /* Semaphores they wait on.      */
+   HANDLE   WriteSem;
+} RWLOCK;
+
+typedef struct {                            /* Message pool, OsMsgStats():   */
+   unsigned long Blocks;                    /* Messages the pool holds.      */
+   unsigned long InUse;                     /* Queued, or held by receivers. */
+   unsigned long HighWater;                 /* Most ever in use at once.     */
+   unsigned long Inline;                    /* Sends with data in message.   */
+   unsigned long Heap;                      /* Sends with data from heap.    */
+} MSGSTATS;
+
 /*---------------------------------------------------------------------------*/
 /* Available functions...                                                    */
 /*---------------------------------------------------------------------------*/
@@ -38,6 +90,11 @@ void     *OsAlloc(      int     Length);    /* Allocate a block of memory.   */
 
 int       OsAwake(      HANDLE  Pid );      /* Wakeup a specific sleeper.    */
 
+int       OsBuffAlloc(  void  **Buffer,     /* Allocate a pool buffer.       */
+                        unsigned short Size);
+
+int       OsBuffFree(   void   *Buffer);    /* Free a pool buffer.           */
+
 int       OsClose(      HANDLE  FileNbr );  /* Close connection to device.   */
 
 int       OsControl(    HANDLE  FileNbr,    /* Control device.               */
@@ -47,14 +104,53 @@ int       OsControl(    HANDLE  FileNbr,    /* Control device.               */
 HANDLE    OsCreate(                         /* Create Process.               */
                         void     *ProcAddr, /* Procedure address.            */
                         int       SSize,    /* Stack size in words.          */
-                        int       Priority, /* Process priority >= 0.        */
+                        int       Priority, /* Priority 1 to NPRIO-1.        */
                         char     *Name,     /* Name ( for debugging ).       */
                         char     *Data );   /* parameter passed to proc.     */
 
+HANDLE    OsCreateMbox(                     /* Create Process with a lock-   */
+                        void     *ProcAddr, /* free mailbox ring.            */
+                        int       SSize,
+                        int       Priority,
+                        char     *Name,
+                        char     *Data,
+                        int       Slots );  /* Ring slots, power of 2.       */
+
 void      OsDisable(    void );             /* Disable interrupts.           */
 
 void      OsEnable(     void );             /* Enable interrupts.            */
 
+int       OsEventClear( HANDLE  Event,      /* Clear event flags.            */
+                        unsigned long Flags);
+
+HANDLE    OsEventCreate( unsigned long Flags);  /* Create event flag group.  */
+
+int       OsEventDelete( HANDLE  Event);    /* Delete event flag group.      */
+
+int       OsEventSet(   HANDLE  Event,      /* Set event flags, wake all     */
+                        unsigned long Flags);   /* waiters they satisfy.     */
+
+int       OsEventWait(  HANDLE  Event,      /* Wait for event flags, rtn     */
+                        unsigned long  Mask,    /* flag word in *Flags.      */
+                        int     Options,
+                        unsigned long *Flags);
+
+int       OsEventWaitTimeout(               /* Same, give up after a while.  */
+                        HANDLE  Event,
+                        unsigned long  Mask,
+                        int     Options,
+                        unsigned long *Flags,
+                        long    Hundreds);
+
+int       OsFastPost(   FASTSEM *Sem);      /* Post a fast semaphore.        */
+
+int       OsFastSemCreate( FASTSEM *Sem,    /* Set up a fast semaphore.      */
+                        int     Count);
+
+int       OsFastSemDelete( FASTSEM *Sem);   /* Delete a fast semaphore.      */
+
+int       OsFastWait(   FASTSEM *Sem);      /* Wait on a fast semaphore.     */
+
 int       OsFree(       void *);            /* Free a block of memory.       */
 
 HANDLE    OsGetPid(     void );             /* Get current process id.       */
@@ -65,36 +161,134 @@ void     *OsHandDestroy(void *A, HANDLE  Nbr);    /* Destroy a handle.       */
 
 void     *OsHandProtect(void *A, HANDLE  Nbr);    /* Protect handle rtn res. */
 
+int       OsHandRetire(void *A, HANDLE  Nbr,      /* Destroy handle, free    */
+                       int (*Free)(void *));      /* resource when unused.   */
+
 int       OsHandUnprotect( void *A, HANDLE  Nbr); /* Unprotect handle.       */
 
+int       OsIdle(       void );             /* Run others or wait for work.  */
+
 int       OsInit(       void );             /* Initialize OS KERNEL.         */
 
 int       OsKill(       HANDLE  Pid);       /* Kill a process.               */
 
 int       OsLock(       HANDLE *Lock);      /* Lock a resource.              */
 
+int       OsLockOrder(  HANDLE *Lock,       /* Set order waiters get lock.   */
+                        int     Order);
+
+int       OsLockTimeout( HANDLE *Lock,      /* Lock, give up after a while. */
+                        long    Hundreds);
+
+int       OsMsgCall(    HANDLE  Pid,        /* Send, wait for the reply.     */
+                        void   *Data,
+                        int     Length,
+                        void  **Reply,
+                        int    *ReplyLength);
+
+HANDLE    OsMsgCaller(  void );             /* Who to reply to.              */
+
+int       OsMsgFree(    void   *Data);      /* Free from OsMsgRecvBuff().    */
+
 int       OsMsgRecv(    void  **Data,       /* Receive a message.            */
                         int    *Length,
                         int     Wait);
 
+int       OsMsgRecvBatch(                   /* Receive up to Max messages.   */
+                        void  **Data,
+                        int    *Length,
+                        int     Max,
+                        long    Hundreds);
+
+int       OsMsgRecvBuff(                    /* Receive without copying.      */
+                        void  **Data,
+                        int    *Length,
+                        long    Hundreds);
+
+int       OsMsgRecvTimeout(                 /* Receive, give up after a while*/
+                        void  **Data,
+                        int    *Length,
+                        long    Hundreds);
+
+int       OsMsgReply(   HANDLE  Pid,        /* Reply to OsMsgCall().         */
+                        void   *Data,
+                        int     Length);
+
 int       OsMsgSend(    HANDLE  Pid,        /* Send a message to a process.  */
                         void   *Data,
                         int     Length,
                         int     Wait);
 
+int       OsMsgSendBatch(                   /* Send Count messages at once.  */
+                        HANDLE  Pid,
+                        void  **Data,
+                        int    *Length,
+                        int     Count,
+                        int     Wait);
+
+int       OsMsgSendBuff( HANDLE Pid,        /* Send a pool buffer, no copy.  */
+                        void   *Buffer,
+                        int     Length,
+                        int     Wait);
+
+int       OsMsgSendTimeout(                 /* Send, give up after a while.  */
+                        HANDLE  Pid,
+                        void   *Data,
+                        int     Length,
+                        long    Hundreds);
+
+int       OsMsgStats(   MSGSTATS *Stats);   /* Get message pool counts.      */
+
 HANDLE    OsOpen(       char   *Name,       /* Open connection to device.    */
                         int     Options );
 
+HANDLE    OsPortCreate( char   *Name,       /* Create a message port.        */
+                        int     Options);
+
+int       OsPortDelete( HANDLE  Port);      /* Delete a message port.        */
+
+int       OsPortJoin(   HANDLE  Port);      /* Get copies of broadcasts.     */
+
+int       OsPortLeave(  HANDLE  Port);      /* Stop getting them.            */
+
+HANDLE    OsPortOpen(   char   *Name);      /* Find a port by name.          */
+
+int       OsPortRecv(   HANDLE  Port,       /* Receive from a port.          */
+                        void  **Data,
+                        int    *Length,
+                        long    Hundreds);
+
+int       OsPortSend(   HANDLE  Port,       /* Send to a port.               */
+                        void   *Data,
+                        int     Length);
+
 int       OsPost(       HANDLE  Sem);       /* Post a semaphore.             */
 
 int       OsRead(       HANDLE  FileNbr,    /* Read to device.               */
                         char   *Buffer,
                         int     Length );
 
+int       OsProcPool(   int     SSize,      /* Set processes kept for reuse. */
+                        int     Max);
+
+int       OsQuantum(    int     Prio,       /* Set time slice for priority.  */
+                        int     Ticks);
+
 int       OsResume(     HANDLE  Pid);       /* Unsuspend process. Make ready.*/
 
 int       OsReturn(     void );             /* Kills currently running proc. */
 
+int       OsRwCreate(   RWLOCK *Rw,         /* Set up a reader-writer lock.  */
+                        int     Options);
+
+int       OsRwDelete(   RWLOCK *Rw);        /* Delete a reader-writer lock.  */
+
+int       OsRwRead(     RWLOCK *Rw);        /* Lock for reading (shared).    */
+
+int       OsRwUnlock(   RWLOCK *Rw);        /* Unlock, reader or writer.     */
+
+int       OsRwWrite(    RWLOCK *Rw);        /* Lock for writing (exclusive). */
+
 int       OsSched(      void );             /* Reshedule running process.    */
 
 int       OsSeek(       HANDLE  FileNbr,    /* Seek on device.               */
@@ -108,14 +302,31 @@ HANDLE    OsSemCreate(  int     Count);     /* Create a semaphore, set count.*/
 
 int       OsSemDelete(  HANDLE  Sem);       /* Delete a semaphore.           */
 
+int       OsSemOrder(   HANDLE  Sem,        /* Set order waiters are posted. */
+                        int     Order);
+
+#if defined(OS_SMP)
+int       OsSmpStart(   int     Cpus);      /* Run on this many CPUs.        */
+#endif
+
 int       OsTerm(       void );             /* Terminate OS KERNEL.          */
 
 int       OsWait(       HANDLE  Sem);       /* Wait on a semaphore.          */
 
+int       OsWaitAll(    WAITOBJ *List,      /* Wait until all are ready.     */
+                        int     Count,
+                        long    Hundreds);
+
+int       OsWaitAny(    WAITOBJ *List,      /* Wait until one is ready, rtn  */
+                        int     Count,      /* its index.                    */
+                        long    Hundreds);
+
+int       OsWaitTimeout( HANDLE  Sem,       /* Wait, give up after a while. */
+                        long    Hundreds);
+
 int       OsWrite(      HANDLE  FileNbr,    /* Write to device.              */
                         char   *Buffer,
                         int     Length  );
 
 int       OsUnlock(     HANDLE *Lock);      /* Unlock a resource.            */
 
-
\ No newline at end of file
@@ -0,0 +1,122 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSATOMIC.H                                            */
+/*                                                                           */
+/*             Title:  Atomic operations on kernel words.                    */
+/*                                                                           */
+/*       Description:  Loads, stores, compare-and-swap and add on a ULONG    */
+/*                     (or pointer) that other CPUs and interrupt routines   */
+/*                     may change at the same time, without taking the       */
+/*                     kernel lock. OS_SMP builds use the compiler's         */
+/*                     __atomic builtins. Other builds have one CPU, so      */
+/*                     masking interrupts around a plain operation is enough */
+/*                     there, and cheaper than a locked instruction.         */
+/*                     AtomicOff() masks interrupts on this CPU alone, for   */
+/*                     a few instructions that must not be switched away.    */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#if !defined(__OSATOMIC_H)
+#define  __OSATOMIC_H
+
+#if defined(__GNUC__)
+#define  OsAtomicLoad(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define  OsAtomicStore(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define  OsAtomicLoad(p)        (*(p))
+#define  OsAtomicStore(p, v)    (*(p) = (v))
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+/* Keep this CPU from taking an interrupt, and so from switching process,    */
+/* for a few instructions, without the kernel lock. Interrupts may already   */
+/* be off, so put them back the way they were...                             */
+/*---------------------------------------------------------------------------*/
+
+#if defined(OS_HOSTED)
+#define  AtomicOff(On)          ((On) = !HostIntMask, disable())
+#else
+#include <dos.h>
+#define  AtomicOff(On)          ((On) = _FLAGS & 0x0200, disable())
+#endif
+#define  AtomicOn(On)           { if (On) enable(); }
+
+
+#if defined(OS_SMP)
+
+/* Set *p to New if it still holds *Old; else put what it holds in *Old.     */
+#define  OsAtomicCas(p, Old, New)                                            \
+         __atomic_compare_exchange_n((p), (Old), (New), 0,                   \
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define  OsAtomicAdd(p, v)      __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+
+/* Order a store before a later load of another word (and all else).         */
+#define  OsAtomicFence()        __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Ease off the CPU while spinning on a word another CPU will change.        */
+#if defined(__x86_64__)
+#define  OsSpinPause()          __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define  OsSpinPause()          __asm__ __volatile__("yield")
+#else
+#define  OsSpinPause()
+#endif
+
+#else
+
+/*---------------------------------------------------------------------------*/
+/* One CPU: an operation is atomic if no interrupt can come in during it,    */
+/* and the CPU sees its own stores in order...                               */
+/*---------------------------------------------------------------------------*/
+
+#if defined(__GNUC__)
+#define  OsAtomicFence()        __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#else
+#define  OsAtomicFence()
+#endif
+
+#if !defined(__GNUC__)
+#define  __inline__                    /* Turbo C does not inline.           */
+#endif
+
+static __inline__ int OsAtomicCas( ULONG *p, ULONG *Old, ULONG New )
+{
+   int      On;
+   int      Done;
+
+   AtomicOff(On);
+   if ((Done = (*p == *Old)) != 0)
+      *p = New;
+   else
+      *Old = *p;
+   AtomicOn(On);
+
+   return Done;
+}
+
+static __inline__ ULONG OsAtomicAdd( ULONG *p, long Value )
+{
+   int      On;
+   ULONG    New;
+
+   AtomicOff(On);
+   New = (*p += Value);
+   AtomicOn(On);
+
+   return New;
+}
+
+#endif
+
+#endif /* __OSATOMIC_H */
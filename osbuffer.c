@@ -6,16 +6,24 @@
 //              Advanced Communication Development Tools, Inc
 //
 //
-//            Module:  OSHANDLE.C
+//            Module:  OSBUFFER.C
 //
-//             Title:  Manage resources by handle number.
+//             Title:  Manage pools of buffers.
 //
 //       Description:  This module contains:
 //
 //                     OsBuffAlloc   - Allocate a buffer.
 //                     OsBuffFree    - Free a buffer.
-//                     OsBuff        -
-//                     OsBuff        -
+//                     OsBuffGive    - Give a buffer to another process.
+//
+//                     An allocator that finds its pool used up waits on
+//                     the pool's flag in BufferEvent, an event flag group.
+//                     OsBuffFree() sets the flag when someone waits, which
+//                     wakes all of them to try again.
+//
+//                     The Id is the last field of the header, right before
+//                     the data, so OsMsgFree() can tell a pool buffer from
+//                     a copied message by the 4 bytes before the data.
 //
 //            Author:  John C. Overton
 //
@@ -28,7 +36,7 @@
 
 #define  OS_BUFFER_BAD       1
 #define  OS_BUFFER_TOO_BIG   2
-#define  OS_BUFFER_ID        "BUFR"   // ID at start of buffer header.
+#define  OS_BUFFER_ID        "BUFR"   // ID at end of buffer header.
 
 
 //----------------------------------------------------------------------------
@@ -36,7 +44,6 @@
 //----------------------------------------------------------------------------
 
 typedef struct {
-   BYTE     Id[4];                     // Buffer identifier.
    LINK     Link;                      // Link of allocated or free buffers.
    LINK     Queue;                     // Queue of buffers.
    HANDLE   Pid;                       // Owner of this buffer.
@@ -45,6 +52,7 @@ typedef struct {
    USHORT   Size;                      // Total size of buffer.
    USHORT   Head;                      // Index to start of data.
    USHORT   Tail;                      // Index to end of data.
+   BYTE     Id[4];                     // Buffer identifier, just before data.
    BYTE     Buffer[1];                 // Actual buffer area.
 } BUFFER;
 
@@ -55,7 +63,6 @@ typedef struct {
    USHORT   AllocCount;                // Nbr of buffers currently allocated.
    USHORT   FreeCount;                 // Nbr of buffers that are free.
    USHORT   WaitCount;                 // Count of tasks currently waiting.
-   HANDLE   Event;                     // Incase some one has to wait for one
    ANCHOR   Free;                      // Chain of free buffers.
    ANCHOR   Alloc;                     // Chain of allocated buffers.
 
@@ -63,19 +70,23 @@ typedef struct {
 
 BUFFER_ANCHOR BufferAnchor[] = {
 
-   // Index  Size Allow Alloc Free Waiting Event   Free Chain   Alloc Chain
-   // -----  ---- ----- ----- ---- ------- -----   ----------   -----------
-
-   {     1,   256,  200,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     2,   512,  100,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     3,  1600,   50,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     4,  4096,    0,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     5,  8192,    5,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     6, 16384,    5,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     7, 32768,    5,    0,   0,      0,    0,      {NULL},       {NULL} },
-   {     0,     0,    0,    0,   0,      0,    0,      {NULL},       {NULL} }
+   // Index  Size Allow Alloc Free Waiting   Free Chain   Alloc Chain
+   // -----  ---- ----- ----- ---- -------   ----------   -----------
+
+   {     1,   256,  200,    0,   0,      0,      {NULL},       {NULL} },
+   {     2,   512,  100,    0,   0,      0,      {NULL},       {NULL} },
+   {     3,  1600,   50,    0,   0,      0,      {NULL},       {NULL} },
+   {     4,  4096,    0,    0,   0,      0,      {NULL},       {NULL} },
+   {     5,  8192,    5,    0,   0,      0,      {NULL},       {NULL} },
+   {     6, 16384,    5,    0,   0,      0,      {NULL},       {NULL} },
+   {     7, 32768,    5,    0,   0,      0,      {NULL},       {NULL} },
+   {     0,     0,    0,    0,   0,      0,      {NULL},       {NULL} }
 };
 
+#define  BuffFlag(a)   (1L << (a)->Index)   // Pool's flag in BufferEvent.
+
+static HANDLE BufferEvent;             // Event group allocators wait on.
+
 
 
 
@@ -133,6 +144,11 @@ int  OsBuffAlloc(void **RetBuffer, USHORT Size)
       if (Anchor->AllocCount < Anchor->MaxAllow) {  // If we're allowed more...
          Buffer = OsAlloc( Anchor->Size +           // Allocate memory for buf.
                            sizeof(BUFFER) - 1 );
+         if (Buffer == NULL) {                   // Out of memory?
+            OsEnable();
+            return SYSERR;
+         }
+         ChainInit(&Buffer->Link, Buffer);
          Buffer->Size = Anchor->Size;            // Set buffer size in buf.
          Buffer->AnchorIndex = Anchor->Index;    // Save index into anchor tab.
          memcpy(Buffer->Id, OS_BUFFER_ID, sizeof(Buffer->Id));
@@ -144,8 +160,16 @@ int  OsBuffAlloc(void **RetBuffer, USHORT Size)
       // until one becomes available...
       //----------------------------------------------------------------------
 
+      if (BufferEvent == 0 &&          // First to wait makes event group.
+          (BufferEvent = OsEventCreate(0)) == SYSERR) {
+         BufferEvent = 0;
+         OsEnable();
+         return SYSERR;
+      }
+
       Anchor->WaitCount++;             // Indicate a task is waiting.
-      OsEventWait(Anchor->Event);      // Wait until a buffer is free.
+      OsEventWait(BufferEvent,         // Wait until a buffer is free.
+                  BuffFlag(Anchor), OS_EVENT_ANY | OS_EVENT_CLEAR, NULL);
       Anchor->WaitCount--;             // Indicate a task is not waiting.
    }
 
@@ -175,18 +199,48 @@ int  OsBuffFree(void *PassBuffer)
    Buffer = (BUFFER *) ((char*)PassBuffer -
                         (char*) (((BUFFER*)(0))->Buffer));
 
-   Anchor = &BufferAnchor[Buffer->AnchorIndex];  // Get buff anchor table entry.
-
    if ( memcmp(Buffer->Id, OS_BUFFER_ID, sizeof(Buffer->Id)) != 0)
       return OS_BUFFER_BAD;            // Something wrong with buffer.
 
+   Anchor = &BufferAnchor[Buffer->AnchorIndex - 1];  // Get buff anchor entry.
+
    OsDisable();                        // Disable interrupts.
 
    Unchain(&Anchor->Alloc,  &Buffer->Link);   // Unchain from allocate chain.
    ChainPush(&Anchor->Free, &Buffer->Link);   // Chain into free chain.
+   Anchor->AllocCount--;
+   Anchor->FreeCount++;
+
+   if (Anchor->WaitCount)              // Wake everyone waiting for one.
+      OsEventSet(BufferEvent, BuffFlag(Anchor));
 
    OsEnable();                         // Re-enable interrupts.
 
    return SYSOK;
 }
-
\ No newline at end of file
+
+
+//----------------------------------------------------------------------------
+// OsBuffGive() -- Make Pid the owner of a buffer the current process owns,
+// holding Length bytes of data. OsMsgSendBuff() uses it to pass a buffer on
+// without copying it. Needs no lock: only the owner changes the buffer...
+//----------------------------------------------------------------------------
+
+int  OsBuffGive(void *PassBuffer, HANDLE Pid, int Length)
+{
+   BUFFER*        Buffer;
+
+   Buffer = (BUFFER *) ((char*)PassBuffer -
+                        (char*) (((BUFFER*)(0))->Buffer));
+
+   if ( memcmp(Buffer->Id, OS_BUFFER_ID, sizeof(Buffer->Id)) != 0 ||
+        Buffer->Pid != CurrPid ||      // Only the owner may give it away.
+        Length < 0 || Length > Buffer->Size)
+      return SYSERR;
+
+   Buffer->Pid  = Pid;                 // New owner.
+   Buffer->Head = 0;                   // Data is all of the message.
+   Buffer->Tail = Length;
+
+   return SYSOK;
+}
@@ -11,7 +11,13 @@
 /*             Title:  Chain functions.                                      */
 /*                                                                           */
 /*       Description:  OsChain() and OsUnchain() will manage a doubly linked */
-/*                     list of chain elements.                               */
+/*                     list of chain elements. PrioChain(), PrioPush(),      */
+/*                     PrioUnchain() and PrioFirst() manage a priority queue */
+/*                     made of one chain per priority level plus a bitmap of */
+/*                     levels.                                               */
+/*                     WaitChain(), WaitUnchain(), WaitFirst() and WaitPop() */
+/*                     manage the wait queue of a semaphore or lock, which   */
+/*                     is a plain chain or a priority queue.                 */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
@@ -77,4 +83,155 @@ void *Unchain( ANCHOR  *Anchor,
 }
 
 
-
\ No newline at end of file
+/*---------------------------------------------------------------------------*/
+/* PrioChain() -- Queue a LINK at the end of its priority level...           */
+/*---------------------------------------------------------------------------*/
+
+void PrioChain( PRIOQ   *Queue,
+                LINK    *New,
+                int      Prio)
+{
+   ChainQueue(&Queue->Level[Prio], New);
+   Queue->Map |= (ULONG) 1 << Prio;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PrioPush() -- Put a LINK at the front of its priority level...            */
+/*---------------------------------------------------------------------------*/
+
+void PrioPush(  PRIOQ   *Queue,
+                LINK    *New,
+                int      Prio)
+{
+   ChainPush(&Queue->Level[Prio], New);
+   Queue->Map |= (ULONG) 1 << Prio;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PrioUnchain() -- Unlink a LINK from its priority level...                 */
+/*---------------------------------------------------------------------------*/
+
+void *PrioUnchain( PRIOQ   *Queue,
+                   LINK    *Link,
+                   int      Prio)
+{
+   void *Element;
+
+   Element = Unchain(&Queue->Level[Prio], Link);
+
+   if (Queue->Level[Prio].First == NULL)     /* Level now empty?             */
+      Queue->Map &= ~((ULONG) 1 << Prio);
+
+   return Element;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PrioFirst() -- Return first element of highest non-empty priority...      */
+/*---------------------------------------------------------------------------*/
+
+void *PrioFirst( PRIOQ   *Queue )
+{
+   if (Queue->Map == 0)
+      return NULL;
+
+   return ChainFirst(&Queue->Level[PrioHigh(Queue->Map)]);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PrioHigh() -- Return number of highest bit set in a (non-zero) map...     */
+/*---------------------------------------------------------------------------*/
+
+int  PrioHigh( ULONG Map )
+{
+#if defined(__GNUC__)
+   return (int) (sizeof(ULONG) * 8 - 1) - __builtin_clzl(Map);
+#else
+   int   n = 0;
+
+   if (Map & 0xffff0000L) { n += 16;  Map >>= 16; }
+   if (Map & 0xff00)      { n +=  8;  Map >>=  8; }
+   if (Map & 0xf0)        { n +=  4;  Map >>=  4; }
+   if (Map & 0x0c)        { n +=  2;  Map >>=  2; }
+   if (Map & 0x02)        { n +=  1;             }
+
+   return n;
+#endif
+}
+
+
+
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitChain() -- Queue a waiter at the end of a wait queue, or of its       */
+/* priority level if the queue is by priority...                             */
+/*---------------------------------------------------------------------------*/
+
+void WaitChain( WAITQ   *Queue,
+                LINK    *New,
+                int      Prio)
+{
+   if (Queue->Prio)
+      PrioChain(Queue->Prio, New, Prio);
+   else
+      ChainQueue(&Queue->Fifo, New);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitUnchain() -- Unlink a waiter queued at Prio from a wait queue...      */
+/*---------------------------------------------------------------------------*/
+
+void *WaitUnchain( WAITQ   *Queue,
+                   LINK    *Link,
+                   int      Prio)
+{
+   if (Queue->Prio)
+      return PrioUnchain(Queue->Prio, Link, Prio);
+
+   return Unchain(&Queue->Fifo, Link);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitFirst() -- Return waiter that is next, NULL if none...                */
+/*---------------------------------------------------------------------------*/
+
+void *WaitFirst( WAITQ   *Queue )
+{
+   if (Queue->Prio)
+      return PrioFirst(Queue->Prio);
+
+   return ChainFirst(&Queue->Fifo);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitPop() -- Unlink and return waiter that is next, NULL if none...       */
+/*---------------------------------------------------------------------------*/
+
+void *WaitPop( WAITQ   *Queue )
+{
+   int   Prio;
+
+   if (Queue->Prio == NULL)
+      return ChainPop(&Queue->Fifo);
+
+   if (Queue->Prio->Map == 0)
+      return NULL;
+
+   Prio = PrioHigh(Queue->Prio->Map);
+   return PrioUnchain(Queue->Prio, Queue->Prio->Level[Prio].First, Prio);
+}
@@ -45,6 +45,38 @@ typedef struct Anchor ANCHOR;
 
 
 
+/*---------------------------------------------------------------------------*/
+/* Priority queue. One FIFO chain per priority level, plus a bitmap with a   */
+/* bit set for each level that has something chained on it...               */
+/*---------------------------------------------------------------------------*/
+
+#ifndef  NPRIO
+#define  NPRIO        32               /* Number of priority levels (<= 32). */
+#endif
+
+struct PrioQueue {
+   ULONG         Map;                  /* Bit n set if Level[n] not empty.   */
+   struct Anchor Level[NPRIO];         /* FIFO chain for each priority.      */
+};
+
+typedef struct PrioQueue PRIOQ;
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Wait queue of a semaphore or lock. Waiters are kept in order of arrival,  */
+/* or by priority (still FIFO within a level) if Prio is set...              */
+/*---------------------------------------------------------------------------*/
+
+struct WaitQueue {
+   struct Anchor     Fifo;             /* Waiters in order of arrival.       */
+   struct PrioQueue *Prio;             /* Waiters by priority, or NULL.      */
+};
+
+typedef struct WaitQueue WAITQ;
+
+
+
 /*---------------------------------------------------------------------------*/
 /* Useful macros for chain manipulation and traversing...                    */
 /*---------------------------------------------------------------------------*/
@@ -62,6 +94,12 @@ typedef struct Anchor ANCHOR;
 
 #define ChainPop(a)      ((a)->First == NULL ? NULL : Unchain((a), (a)->First))
 
+#define PrioQueueInit(q)    (memset((q), 0, sizeof(PRIOQ)))
+#define PrioEmpty(q)        ((q)->Map == 0)
+
+#define WaitEmpty(q)        ((q)->Prio ? PrioEmpty((q)->Prio)                 \
+                                       : (q)->Fifo.First == NULL)
+
 
 
 /*---------------------------------------------------------------------------*/
@@ -74,4 +112,31 @@ void    Chain(      ANCHOR  *Anchor,
 
 void   *Unchain(    ANCHOR  *Anchor,
                     LINK    *Link );
-
\ No newline at end of file
+
+void    PrioChain(  PRIOQ   *Queue,
+                    LINK    *New,
+                    int      Prio);
+
+void    PrioPush(   PRIOQ   *Queue,
+                    LINK    *New,
+                    int      Prio);
+
+void   *PrioUnchain(PRIOQ   *Queue,
+                    LINK    *Link,
+                    int      Prio);
+
+void   *PrioFirst(  PRIOQ   *Queue);
+
+int     PrioHigh(   ULONG    Map);
+
+void    WaitChain(  WAITQ   *Queue,
+                    LINK    *New,
+                    int      Prio);
+
+void   *WaitUnchain(WAITQ   *Queue,
+                    LINK    *Link,
+                    int      Prio);
+
+void   *WaitFirst(  WAITQ   *Queue);
+
+void   *WaitPop(    WAITQ   *Queue);
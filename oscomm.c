@@ -38,6 +38,7 @@
 
 struct Port {
    struct Port  *Next;                 /* Next Port using same INT.          */
+   DEVICE       *Device;               /* Device opened on port.             */
    USHORT        Addr;                 /* 8250 Base I/O port address.        */
    USHORT        Int;                  /* Interrupt number.                  */
 
@@ -419,6 +420,7 @@ static void ProcessInt(int Int)
                   OsResume(Port->RecvPid);
                   Port->Flags &= ~FLAG_RECVER_WAITING;
                }
+               OsDevReady(Port->Device);  /* And any OsWaitAny/All().    */
 
                /*------------------------------------------------------------*/
                /* Handle XON/XOFF and RTS flow control...                    */
@@ -479,6 +481,7 @@ int   CommOpen(DEVICE *Device, int Options)
    Port = (PORT *) OsAlloc(sizeof(PORT)); /* Get new port structure.         */
 
    ((PORT *) Device->Misc) = Port;     /* Save connection to Port thru Dev.  */
+   Port->Device = Device;              /* And back, for OsDevReady().        */
 
    Port->Addr  = DeviceTypeTable[Device->Type].Port1;
    Port->Int   = DeviceTypeTable[Device->Type].Int;
@@ -690,8 +693,11 @@ int  CommRecv(DEVICE *Device, char *Buffer, int Length)
       /*---------------------------------------------------------------------*/
       if (Length > 0) {
          Port->Flags |= FLAG_RECVER_WAITING;
-         Port->SendPid = OsGetPid();
-         OsSuspend( Port->SendPid );   /* Wait until more comes in.          */
+         Port->RecvPid = OsGetPid();   /* Interrupt resumes this one.        */
+         if (OsSuspendTimeout(Device->Timeout) == SYSTIMEOUT) {
+            Port->Flags &= ~FLAG_RECVER_WAITING;
+            break;                     /* Return what we have so far.        */
+         }                             /* Else more came in.                 */
       }
 
       if ((Port->Options & OPTION_TERM_CHAR) && c == Port->TermChar)
@@ -724,6 +730,17 @@ int  CommRecv(DEVICE *Device, char *Buffer, int Length)
 
 
 
+/*---------------------------------------------------------------------------*/
+/* Count of received bytes a read would get without waiting...               */
+/*---------------------------------------------------------------------------*/
+
+int  CommPoll(DEVICE *Device)
+{
+   return ((PORT *) Device->Misc)->RecvCnt;
+}
+
+
+
 /*---------------------------------------------------------------------------*/
 /* Device control...                                                         */
 /*---------------------------------------------------------------------------*/
@@ -937,4 +954,3 @@ static int  CommCheckErrors(PORT *Port)
 }
 
 
-
\ No newline at end of file
@@ -59,4 +59,3 @@
 #define MODEM_RI            0x02
 #define MODEM_DCD           0x01
 
-
\ No newline at end of file
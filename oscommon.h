@@ -51,8 +51,11 @@ typedef void        (*ROUTINE)( void );
 /* Important definitions...                                                  */
 /*---------------------------------------------------------------------------*/
 
+#if defined(OS_HOSTED)
+#define MIN_STACK_SIZE  16384          /* Host C library needs more stack.   */
+#else
 #define MIN_STACK_SIZE  256
+#endif
 
 
 
-
\ No newline at end of file
@@ -27,24 +27,35 @@
 
 struct DeviceType DeviceTypeTable[] = {
 
+#if !defined(OS_HOSTED)                /* No 8250 ports on the host.         */
    {"PORT1",  0x3f8,  0,  4,  0,  0},
    {"PORT2",  0x2f8,  0,  3,  0,  0},
    {"PORT3",  0x3e8,  0,  4,  0,  0},
    {"PORT4",  0x2e8,  0,  3,  0,  0},
+#endif
    {NULL,         0,  0,  0,  0,  0}
 };
 
+#if !defined(OS_HOSTED)
 extern CommOpen(    DEVICE *Device, int options);
 extern CommClose(   DEVICE *Device);
 extern CommRecv(    DEVICE *Device, char *Buffer, int Length);
 extern CommSend(    DEVICE *Device, char *Buffer, int Length);
 extern CommControl( DEVICE *Device, int Function, long Value);
+extern CommPoll(    DEVICE *Device);
+#endif
+
+#define  END_OF_TABLE  ((int (*)(int)) -1)  /* Marks end of driver table.    */
 
 
 struct DeviceDriver DeviceDriverTable[] = {
 
-   {NULL, NULL, CommOpen, CommClose, CommRecv, CommSend, CommControl, NULL},
-   {-1,   -1,   NULL,     NULL,      NULL,     NULL,     NULL,        NULL}
+#if !defined(OS_HOSTED)
+   {NULL, NULL, CommOpen, CommClose, CommRecv, CommSend, CommControl, NULL,
+    CommPoll},
+#endif
+   {END_OF_TABLE, END_OF_TABLE, NULL, NULL, NULL, NULL,  NULL,        NULL,
+    NULL}
 };
 
 
@@ -55,18 +66,48 @@ void        *DeviceAnchor = NULL;      /* Device handle manager anchor.      */
 /* Process related variables...                                              */
 /*---------------------------------------------------------------------------*/
 
-ANCHOR       ReadyAnchor;              /* Chain of ready processes.          */
 ANCHOR       KilledAnchor;             /* Chain of killed processes.         */
 void        *ProcessAnchor = NULL;     /* Process handle manager anchor.     */
 int          NumProc;                  /* Handle to currently active process.*/
+
+#if defined(OS_SMP)
+CPU          CpuTable[NCPU];           /* Ready queue, current proc per CPU. */
+int          NumCpu = 1;               /* CPUs running, the first is main.   */
+volatile int KernelLock;               /* Kernel lock, see OsDisable().      */
+#else
+PRIOQ        ReadyQueue;               /* Ready processes by priority.       */
 HANDLE       CurrPid;                  /* Handle to currently executing proc.*/
+PROCESS     *CurrProc;                 /* Process structure of CurrPid.      */
+#endif
 
 
 /*---------------------------------------------------------------------------*/
 /* Interrupt enable/disable variables...                                     */
 /*---------------------------------------------------------------------------*/
 
+#if !defined(OS_SMP)
 int          DisableCount;             /* Nested level of interrupts diabled.*/
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+/* Preemption (time slicing) variables...                                    */
+/*---------------------------------------------------------------------------*/
+
+int          Quantum[NPRIO];           /* Time slice in ticks per priority.  */
+#if !defined(OS_SMP)
+int          SliceTicks;               /* Ticks left in current time slice.  */
+int          Resched;                  /* Reschedule requested by an isr.    */
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+/* Process recycling variables...                                            */
+/*---------------------------------------------------------------------------*/
+
+ANCHOR       ProcPool[NPOOL];          /* Dead processes with stacks, by size*/
+int          PoolCount[NPOOL];         /* Count in each pool.                */
+int          PoolMax[NPOOL];           /* Limit of each pool.                */
 
 
 /*---------------------------------------------------------------------------*/
@@ -74,6 +115,18 @@ int          DisableCount;             /* Nested level of interrupts diabled.*/
 /*---------------------------------------------------------------------------*/
 
 void        *SemaphoreAnchor = NULL;   /* Semaphore handle manager anchor.   */
+void        *EventGroupAnchor = NULL;  /* Event flag group handle anchor.    */
+void        *PortAnchor = NULL;        /* Message port handle anchor.        */
+ANCHOR       PortNames;                /* All message ports.                 */
+
+
+/*---------------------------------------------------------------------------*/
+/* Lock related variables...                                                 */
+/*---------------------------------------------------------------------------*/
+
+ANCHOR       LockHash[NLOCKHASH];      /* Turnstiles by lock address.        */
+int          LockInherit = OS_INHERIT; /* Lock owners inherit priority.      */
+int          LockSpin = OS_LOCKSPIN;   /* Spins before waiting for a lock.   */
 
 
 /*---------------------------------------------------------------------------*/
@@ -83,4 +136,3 @@ void        *SemaphoreAnchor = NULL;   /* Semaphore handle manager anchor.   */
 ANCHOR       EventAnchor;              /* Chain of events for sleeping pids. */
 ULONG        Seconds;                  /* Time of day in seconds.            */
 USHORT       Millisecs;                /* Fraction of a second.              */
-
\ No newline at end of file
@@ -20,6 +20,7 @@
 /*                     OsWrite()   - Write to a device.                      */
 /*                     OsControl() - Control a device.                       */
 /*                     OsSeek()    - Seek on a device.                       */
+/*                     OsDevReady() - Wake OsWaitAny/All() on a device.      */
 /*                                                                           */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
@@ -76,6 +77,7 @@ HANDLE  OsOpen(char *Name, int  Options)
    Device = OsAlloc(sizeof(DEVICE));   /* Get a device structure.            */
    Device->Type   = DeviceTypeNbr;     /* Index into device type table.      */
    Device->Driver = DeviceType->Driver;/* Index into device driver table.    */
+   Device->Timeout = -1L;              /* Reads wait as long as it takes.    */
 
    /*------------------------------------------------------------------------*/
    /* Get device instance number (handle) by registering with                */
@@ -112,24 +114,47 @@ int   OsClose(HANDLE Handle)
 {
    DEVICEDRIVER *DeviceDriver;
    DEVICE       *Device;
-   int           rc;
+   int           rc = SYSOK;
 
 
-   if ((Device = (DEVICE *) OsHandDestroy(DeviceAnchor, Handle)) == NULL)
+   if ((Device = (DEVICE *) OsHandProtect(DeviceAnchor, Handle)) == NULL)
       return SYSERR;                   /* File number not found.             */
 
+   if (OsHandRetire(DeviceAnchor, Handle, OsFree) != SYSOK) {
+      OsHandUnprotect(DeviceAnchor, Handle);
+      return SYSERR;                   /* Someone else closed it first.      */
+   }
+
    DeviceDriver = &DeviceDriverTable[Device->Driver];
 
    if (DeviceDriver->Close != NULL)    /* Is there a close routine?          */
       rc = (*DeviceDriver->Close)(Device);
 
-   OsFree(Device);                     /* Device structure.                  */
+   OsDisable();
+   OsDevReady(Device);                 /* OsWaitAny/All() find it closed.    */
+   OsEnable();
+
+   OsHandUnprotect(DeviceAnchor, Handle);   /* Device structure is freed     */
+                                            /* when reads etc. are done.     */
 
    return rc;                          /* Return with close return code.     */
 }
 
 
 
+/*---------------------------------------------------------------------------*/
+/* OsDevReady() -- Called disabled by a driver, often from its interrupt     */
+/* routine, when a read that had to wait may not have to any more...         */
+/*---------------------------------------------------------------------------*/
+
+void  OsDevReady(DEVICE *Device)
+{
+   if (ChainFirst(&Device->Watchers))  /* Anyone in OsWaitAny/All()?         */
+      OsWatchWake(&Device->Watchers);
+}
+
+
+
 /*---------------------------------------------------------------------------*/
 /* OsRead() -- Read from device. Return actual nbr of bytes read...          */
 /*---------------------------------------------------------------------------*/
@@ -138,7 +163,7 @@ int   OsRead(HANDLE Handle, char *Buffer, int Length)
 {
    DEVICEDRIVER *DeviceDriver;
    DEVICE       *Device;
-   int           rc;
+   int           rc = SYSERR;
 
    if ((Device = (DEVICE *) OsHandProtect(DeviceAnchor, Handle)) == NULL)
       return SYSERR;                   /* Handle number not found.           */
@@ -163,7 +188,7 @@ int   OsWrite(HANDLE Handle, char *Buffer, int Length)
 {
    DEVICEDRIVER *DeviceDriver;
    DEVICE       *Device;
-   int           rc;
+   int           rc = SYSERR;
 
    if ((Device = (DEVICE *) OsHandProtect(DeviceAnchor, Handle)) == NULL)
       return SYSERR;                   /* Handle number not found.           */
@@ -188,7 +213,7 @@ int   OsSeek(HANDLE Handle, long Position)
 {
    DEVICEDRIVER *DeviceDriver;
    DEVICE       *Device;
-   int           rc;
+   int           rc = SYSERR;
 
    if ((Device = (DEVICE *) OsHandProtect(DeviceAnchor, Handle)) == NULL)
       return SYSERR;                   /* File number not found.             */
@@ -213,14 +238,17 @@ int   OsControl(HANDLE Handle, int Function, long Value)
 {
    DEVICEDRIVER *DeviceDriver;
    DEVICE       *Device;
-   int           rc;
+   int           rc = SYSERR;
 
    if ((Device = (DEVICE *) OsHandProtect(DeviceAnchor, Handle)) == NULL)
       return SYSERR;                   /* File number not found.             */
 
    DeviceDriver = &DeviceDriverTable[Device->Driver];
 
-   if (DeviceDriver->Control != NULL)
+   if (Function == OS_SET_TIMEOUT) {   /* Same for every device, driver's    */
+      Device->Timeout = Value;         /* Read() waits this long at most.    */
+      rc = SYSOK;
+   } else if (DeviceDriver->Control != NULL)
       rc = (*DeviceDriver->Control)(Device, Function, Value);
 
    OsHandUnprotect(DeviceAnchor, Device->Handle);
@@ -277,4 +305,3 @@ int   OsDevTerm(void)
 
    return SYSOK;                       /* Return ok.                         */
 }
-
\ No newline at end of file
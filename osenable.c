@@ -16,6 +16,9 @@
 /*                     OsDisable() will disable interrupts and keep count    */
 /*                     disablers.                                            */
 /*                                                                           */
+/*                     In an OS_SMP build disabling also takes the kernel    */
+/*                     lock, which is released when the count drops to zero. */
+/*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
 /*              Date:  04/23/94                                              */
@@ -23,6 +26,7 @@
 /*---------------------------------------------------------------------------*/
 
 #include "oskernel.h"
+#include "osatomic.h"
 
 
 
@@ -35,6 +39,9 @@ void OsEnable( void )
 
 {
    if (!--DisableCount) {              /* If count is down to zero...        */
+#if defined(OS_SMP)
+      OsKernelUnlock();                /* .. let other CPUs into kernel.     */
+#endif
       enable();                        /* .. enable interrupts.              */
    }
 }
@@ -50,7 +57,37 @@ void OsDisable( void )
 
 {
    disable();                          /* Disable interrupts.                */
+#if defined(OS_SMP)
+   if (DisableCount++ == 0)            /* First one in on this CPU...        */
+      OsKernelLock();                  /* .. keep other CPUs out of kernel.  */
+#else
    DisableCount++;                     /* Keep count of callers.             */
+#endif
+}
+
+
+
+#if defined(OS_SMP)
+/*---------------------------------------------------------------------------*/
+/* OsKernelLock() -- Spin until we own the kernel...                         */
+/*---------------------------------------------------------------------------*/
+
+void OsKernelLock( void )
+{
+   while (__atomic_exchange_n(&KernelLock, 1, __ATOMIC_ACQUIRE))
+      while (KernelLock)               /* Wait without hammering the line.   */
+         OsSpinPause();
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsKernelUnlock() -- Release the kernel...                                 */
+/*---------------------------------------------------------------------------*/
+
+void OsKernelUnlock( void )
+{
+   __atomic_store_n(&KernelLock, 0, __ATOMIC_RELEASE);
 }
+#endif
 
-
\ No newline at end of file
@@ -0,0 +1,267 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSEVENT.C                                             */
+/*                                                                           */
+/*             Title:  Create, delete and manage event flag groups.          */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsEventCreate() - Creates an event flag group.        */
+/*                     OsEventDelete() - Deletes an event flag group.        */
+/*                     OsEventSet()    - Sets flags, wakes waiters.          */
+/*                     OsEventClear()  - Clears flags.                       */
+/*                     OsEventWait()   - Waits for flags.                    */
+/*                     OsEventWaitTimeout() - Waits, for a while at most.    */
+/*                     OsEventCancel() - Takes a waiter off its group.       */
+/*                                                                           */
+/*                     A group is a word of 32 flags, referenced by handle.  */
+/*                     A process waits until any (OS_EVENT_ANY) or all       */
+/*                     (OS_EVENT_ALL) flags of its mask are set, and may ask */
+/*                     for them to be cleared when they are (OS_EVENT_CLEAR).*/
+/*                     Setting flags readies every waiter they satisfy in    */
+/*                     one pass over the waiters, and only then clears what  */
+/*                     they asked to clear, so all of them see the flags.    */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+
+
+#define  EventMatch(f, w)    ((w)->Options & OS_EVENT_ALL ?                  \
+                              ((f) & (w)->Mask) == (w)->Mask :               \
+                              ((f) & (w)->Mask) != 0)
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventCreate() -- Create a new event flag group, set its flags...        */
+/*---------------------------------------------------------------------------*/
+
+HANDLE   OsEventCreate(ULONG Flags)
+{
+   HANDLE      Event;                  /* New event group handle.            */
+   EVENTGROUP *Group;                  /* Pointer to new event group.        */
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Group = (EVENTGROUP *) OsAlloc(sizeof(EVENTGROUP))) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return (SYSERR);                 /* Can not allocate any more.         */
+   }
+
+   if ((Event = OsHandCreate(&EventGroupAnchor, (void *) Group)) == SYSERR) {
+      OsFree(Group);                   /* Can not use group struct.          */
+      OsEnable();                      /* Enable interrupts.                 */
+      return (SYSERR);                 /* Can not allocate any more.         */
+   }
+
+   Group->Flags = Flags;               /* Set flags.                         */
+
+   OsHandUnprotect(EventGroupAnchor, Event);   /* Unprotect resource.        */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return Event;                       /* Return with new group handle.      */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventDelete() -- Destroy an event flag group. Its waiters get SYSERR... */
+/*---------------------------------------------------------------------------*/
+
+int   OsEventDelete(HANDLE Event)
+{
+   EVENTGROUP *Group;
+   EVENTWAIT  *W;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Group = (EVENTGROUP *) OsHandDestroy(EventGroupAnchor, Event))
+       == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   while ((W = ChainPop( &Group->Waiters )) != NULL) {
+      W->On = NULL;                    /* Waiter finds group is gone.        */
+      W->Rc = SYSERR;
+      OsReady(W->Proc->Pid);
+   }
+
+   OsFree(Group);                      /* Free group structure.              */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventSet() -- Set flags, and ready all waiters they satisfy...          */
+/*---------------------------------------------------------------------------*/
+
+int   OsEventSet(HANDLE Event, ULONG Flags)
+{
+   EVENTGROUP *Group;
+   EVENTWAIT  *W, *Next;
+   ULONG       Clear = 0;              /* Flags waiters asked to clear.      */
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Group = (EVENTGROUP *) OsHandFind(EventGroupAnchor, Event)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   Group->Flags |= Flags;
+
+   for (W = ChainFirst( &Group->Waiters ); W; W = Next) {
+      Next = ChainNext( &W->Link );
+      if (EventMatch(Group->Flags, W)) {
+         Unchain( &Group->Waiters, &W->Link );
+         W->On    = NULL;
+         W->Flags = Group->Flags;      /* What it saw.                       */
+         W->Rc    = SYSOK;
+         if (W->Options & OS_EVENT_CLEAR)
+            Clear |= W->Mask;
+         OsReady(W->Proc->Pid);
+      }
+   }
+
+   Group->Flags &= ~Clear;             /* After all have seen them.          */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventClear() -- Clear flags...                                          */
+/*---------------------------------------------------------------------------*/
+
+int   OsEventClear(HANDLE Event, ULONG Flags)
+{
+   EVENTGROUP *Group;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Group = (EVENTGROUP *) OsHandFind(EventGroupAnchor, Event)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   Group->Flags &= ~Flags;
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventWait() -- Wait until the flags in Mask are set: any of them, or    */
+/* all with OS_EVENT_ALL. Puts the flag word that satisfied it in *Flags     */
+/* (if not NULL)...                                                          */
+/*---------------------------------------------------------------------------*/
+
+int   OsEventWait(HANDLE Event, ULONG Mask, int Options, ULONG *Flags)
+{
+   return OsEventWaitTimeout(Event, Mask, Options, Flags, -1L);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventWaitTimeout() -- Same as OsEventWait(), but give up after Hundreds */
+/* of a second (0 to not wait, -1 to wait forever). Returns SYSTIMEOUT if    */
+/* it gave up...                                                             */
+/*---------------------------------------------------------------------------*/
+
+int   OsEventWaitTimeout(HANDLE Event, ULONG Mask, int Options, ULONG *Flags,
+                         long Hundreds)
+{
+   EVENTGROUP *Group;
+   EVENTWAIT   W;                      /* On our stack, we are blocked while */
+   PROCESS    *P;                      /* it is in use.                      */
+   int         rc;
+
+   W.Mask    = Mask;
+   W.Options = Options;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Group = (EVENTGROUP *) OsHandFind(EventGroupAnchor, Event)) == NULL ||
+       Mask == 0) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   if (EventMatch(Group->Flags, &W)) { /* Already set, no need to wait.      */
+      W.Flags = Group->Flags;
+      if (Options & OS_EVENT_CLEAR)
+         Group->Flags &= ~Mask;
+      rc = SYSOK;
+
+   } else if (Hundreds == 0) {         /* Would have to wait, but can't.     */
+      W.Flags = Group->Flags;
+      rc = SYSTIMEOUT;
+
+   } else if (OsTimerStart( CurrProc, Hundreds ) != SYSOK) {
+      rc = SYSERR;                     /* No timer, so we can't wait.        */
+
+   } else {
+      P = CurrProc;
+      ChainInit( &W.Link, &W );
+      W.On   = &Group->Waiters;
+      W.Proc = P;
+      W.Rc   = SYSERR;
+      ChainQueue( W.On, &W.Link );     /* Queue onto group.                  */
+      P->EventWait = &W;
+
+      PrioUnchain( ReadyQ(P), &P->Link, P->Prio);  /* Off ready queue.  */
+      P->State = PREVENT;              /* State is now waiting for flags.    */
+      OsSched();                       /* Now, let others run.               */
+      rc = OsTimerStop( P );
+
+      P->EventWait = NULL;
+      if (rc == SYSOK)
+         rc = W.Rc;                    /* SYSERR if group was deleted.       */
+      else if ((Group = OsHandFind(EventGroupAnchor, Event)) != NULL)
+         W.Flags = Group->Flags;       /* Timed out, tell what there was.    */
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+
+   if (Flags && rc != SYSERR)
+      *Flags = W.Flags;
+
+   return rc;                          /* Return SYSOK or SYSTIMEOUT.        */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsEventCancel() -- Called disabled. Take a process off the group it       */
+/* waits on...                                                               */
+/*---------------------------------------------------------------------------*/
+
+void  OsEventCancel(PROCESS *P)
+{
+   EVENTWAIT  *W;
+
+   if ((W = P->EventWait) != NULL && W->On != NULL) {
+      Unchain( W->On, &W->Link );
+      W->On = NULL;
+   }
+}
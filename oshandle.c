@@ -12,10 +12,38 @@
 /*                                                                           */
 /*       Description:  This module contains:                                 */
 /*                                                                           */
-/*                     OsHandCreate  - Allocate a new handle.                */
-/*                     OsHandDestroy - Destroy handle.                       */
-/*                     OsHandEnqueue - Enqueue a resource given handle.      */
-/*                     OsHandDequeue - Dequeue a resource given handle.      */
+/*                     OsHandCreate    - Allocate a new handle.              */
+/*                     OsHandDestroy   - Destroy handle.                     */
+/*                     OsHandRetire    - Destroy handle, free resource later.*/
+/*                     OsHandProtect   - Protect handle, return resource.    */
+/*                     OsHandUnprotect - Unprotect handle.                   */
+/*                     OsHandFind      - Find resource of handle.            */
+/*                                                                           */
+/*                     Lookups take no lock. The reference (generation), use */
+/*                     count and a dying flag of a handle share one word:    */
+/*                     find reads the resource between two reads of it and   */
+/*                     retries if the handle was destroyed meanwhile;        */
+/*                     protect and unprotect change the use count with       */
+/*                     compare-and-swap. Create and destroy still run        */
+/*                     disabled, since they share the free chains.           */
+/*                                                                           */
+/*                     A handle is a generation over an index. With 64 bit   */
+/*                     handles (LP64 hosts) the generation has 31 bits and   */
+/*                     the index 24: a top table of 256 tables of 256        */
+/*                     segments of 256 handles, each allocated when first    */
+/*                     needed. With 32 bit handles the generation has 15     */
+/*                     bits, the index 16, and there is one table. The top   */
+/*                     bit is never set; lock words use it (oslock.c). Free  */
+/*                     handles are kept per segment, last freed first, and   */
+/*                     the segments that have any are stacked the same way,  */
+/*                     so a handle just freed is the next one used.          */
+/*                                                                           */
+/*                     Destroy waits for those protecting the handle to      */
+/*                     unprotect it. Retire does not wait: the handle can    */
+/*                     not be found or protected from then on, and the last  */
+/*                     unprotect frees the resource and the handle. Those    */
+/*                     already protecting it are all the readers that could  */
+/*                     still see it, so that ends the grace period.          */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
@@ -23,7 +51,34 @@
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
+#include <limits.h>
+
 #include "oskernel.h"
+#include "osatomic.h"
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Handle format...                                                          */
+/*---------------------------------------------------------------------------*/
+
+#if ULONG_MAX > 0xFFFFFFFFUL
+#define  HAND_GENSHIFT  32             /* Generation above bit 32,           */
+#define  HAND_INDEXBITS 24             /* 16M handles of each kind.          */
+#else
+#define  HAND_GENSHIFT  16             /* Generation above bit 16,           */
+#define  HAND_INDEXBITS 16             /* 64K handles of each kind.          */
+#endif
+
+#define  HAND_GENMAX    ((ULONG) -1 >> (HAND_GENSHIFT + 1))  /* Never used,  */
+                                                         /* so a handle is   */
+                                                         /* never SYSERR,    */
+                                                         /* nor has top bit. */
+#define  HAND_INDEX(h)  ((h) & (((ULONG) 1 << HAND_INDEXBITS) - 1))
+#define  HAND_BAD(h)    ((h) & ~(HAND_GENMAX << HAND_GENSHIFT) &          \
+                         ~(((ULONG) 1 << HAND_INDEXBITS) - 1))
+
+#define  HAND_NTABLE    (1 << (HAND_INDEXBITS - 16))     /* Top level size.  */
 
 
 
@@ -32,33 +87,55 @@
 /*---------------------------------------------------------------------------*/
 
 struct HandleElement {
-   USHORT   Reference;                 /* Handle create reference number.    */
-   USHORT   Number;                    /* Handle number.                     */
+   ULONG    State;                     /* Generation, dying flag, use count. */
    void    *Resource;                  /* Pointer to resource or free chain. */
    HANDLE   Pid;                       /* Pid of destroyer, if waiting.      */
-   USHORT   Use;                       /* Count of users of handle.          */
+   int    (*Free)(void *);             /* Frees resource, if retired.        */
+   ULONG    Index;                     /* Handle index.                      */
 };
 
 
 struct HandleSegment {
-   struct HandleSegment *Next;         /* Next segment in chain.             */
+   struct HandleSegment *Next;         /* Next segment with free handles.    */
+   struct HandleElement *Free;         /* Free handles of this segment.      */
    struct HandleElement  Handles[256]; /* Handles in segment.                */
 };
 
 
-struct HandleAnchor {
-   USHORT HanCount;                    /* Count of allocated handles.        */
-   USHORT SegCount;                    /* Count of allocated segments.       */
-   struct HandleElement *Free;         /* Chain of free handles.             */
+struct HandleTable {
    struct HandleSegment *Segments[256];/* Pointers to segments.              */
 };
 
 
+struct HandleAnchor {
+   ULONG                 SegCount;     /* Count of allocated segments.       */
+   struct HandleSegment *Avail;        /* Segments that have free handles.   */
+   struct HandleTable   *Tables[HAND_NTABLE];  /* Pointers to tables.        */
+};
+
+
+/*---------------------------------------------------------------------------*/
+/* Fields of HandleElement.State. Use is 0 while the handle is free...       */
+/*---------------------------------------------------------------------------*/
+
+#define  HAND_REF(s)    ((s) >> HAND_GENSHIFT)   /* Generation of handle.    */
+#define  HAND_DYING     0x8000L        /* Destroy waits for users to finish. */
+#define  HAND_USE(s)    ((s) & 0x7fffL)          /* Count of users.          */
+#define  HAND_MAXUSE    0x7fffL
+
+
 
 /*---------------------------------------------------------------------------*/
 /* Local routines...                                                         */
 /*---------------------------------------------------------------------------*/
 
+static struct HandleSegment *HandSegment( struct HandleAnchor *Anchor,
+                                          ULONG Index );
+static struct HandleElement *HandElement( void *A, HANDLE Nbr );
+static int                   HandGrow(    struct HandleAnchor *Anchor );
+static void                 *HandFree(    struct HandleAnchor *Anchor,
+                                          struct HandleElement *Handle,
+                                          ULONG State );
 
 
 
@@ -71,48 +148,45 @@ HANDLE OsHandCreate(void **A, void *Resource)
    struct HandleAnchor  *Anchor;
    struct HandleSegment *Segment;
    struct HandleElement *Handle;
-   int                   i;
 
    OsDisable();                        /* Disable interrupts.                */
 
    /*------------------------------------------------------------------------*/
    /* Check to see if Anchor has been allocated yet...                       */
    /*------------------------------------------------------------------------*/
-   if ((Anchor = (struct HandleAnchor *) *A) == NULL)
-      Anchor = (struct HandleAnchor *)*A = OsAlloc(sizeof(struct HandleAnchor));
+   if ((Anchor = (struct HandleAnchor *) *A) == NULL) {
+      if ((Anchor = OsAlloc(sizeof(struct HandleAnchor))) == NULL) {
+         OsEnable();
+         return SYSERR;
+      }
+      OsAtomicStore(A, (void *) Anchor);
+   }
 
    /*------------------------------------------------------------------------*/
-   /* See if a handle can be allocated off of free chain. If not, then need  */
-   /* to allocate another segment full of handles, preformat them, then      */
-   /* allocate one of the new handles...                                     */
+   /* Take a handle off the free chain of the segment that last had one      */
+   /* freed. If no segment has any, add another segment full of handles...   */
    /*------------------------------------------------------------------------*/
-   if ( (Handle = Anchor->Free) == NULL) {
-
-      if (Anchor->SegCount < 256) {
-         Segment = OsAlloc(sizeof(struct HandleSegment));
-         Anchor->Segments[Anchor->SegCount++] = Segment;
-         for (i = 0; i < 256; i++ ) {
-            Segment->Handles[i].Number    = Anchor->HanCount++;
-            Segment->Handles[i].Reference = 1;
-            (struct HandleElement *)(Segment->Handles[i].Resource) =
-                                                                Anchor->Free;
-            Anchor->Free = &(Segment->Handles[i]);
-         }
-         Handle = Anchor->Free;
-
-      } else
-         return SYSERR;                /* Can not allocate another segment.  */
+   if (Anchor->Avail == NULL && HandGrow(Anchor) != SYSOK) {
+      OsEnable();
+      return SYSERR;                   /* Can not allocate another segment.  */
    }
 
+   Segment = Anchor->Avail;
+   Handle  = Segment->Free;
+
+   if ((Segment->Free = (struct HandleElement *) Handle->Resource) == NULL)
+      Anchor->Avail = Segment->Next;   /* That was its last free handle.     */
+
    /*------------------------------------------------------------------------*/
-   /* Now, we have a handle. So set it up and pass it back...                */
+   /* Now, we have a handle. So set it up and publish it...                  */
    /*------------------------------------------------------------------------*/
-   Anchor->Free = (struct HandleElement *) Handle->Resource;
    Handle->Resource = Resource;
-   Handle->Use = 2;                    /* Indicate in use and protected.     */
+   Handle->Free     = NULL;
+   OsAtomicStore(&Handle->State,       /* Indicate in use and protected.     */
+                 (Handle->State & ~(HAND_DYING | HAND_MAXUSE)) | 2);
 
    OsEnable();
-   return ((ULONG)Handle->Number | ((ULONG)Handle->Reference << 16));
+   return (HAND_REF(Handle->State) << HAND_GENSHIFT) | Handle->Index;
 }
 
 
@@ -123,106 +197,138 @@ HANDLE OsHandCreate(void **A, void *Resource)
 
 void *OsHandDestroy(void *A, HANDLE  Nbr)
 {
-   struct HandleAnchor  *Anchor;
-   struct HandleSegment *Segment;
+   struct HandleAnchor  *Anchor = (struct HandleAnchor *) A;
    struct HandleElement *Handle;
    void                 *Resource;
+   ULONG                 State;
 
 
-   if ((Anchor = (struct HandleAnchor *) A) == NULL)
+   if ((Handle = HandElement(A, Nbr)) == NULL)
       return NULL;
 
    OsDisable();                        /* Disable interrupts.                */
 
-   if ((Segment = Anchor->Segments[(Nbr >> 8) & 0xff]) != NULL) {
-      Handle = &(Segment->Handles[Nbr & 0xff]);
-      if (Handle->Reference == Nbr >> 16 &&      /* Reference match?         */
-          Handle->Use       >  0) {              /* Not being free'd?        */
-
-         if (Handle->Use-- > 0) {      /* Increment use count.               */
-            Handle->Pid = CurrPid;     /* Get our Pid.
-            OsSuspend(CurrPid);        /* Wait until all are finished.       */
-         } else {
-            Handle->Reference++;       /* Bump up reference count.           */
-         }
-         Resource = Handle->Resource;  /* Save resource.                     */
-         (struct HandleElement *) Handle->Resource = Anchor->Free;
-         Anchor->Free = Handle;        /* Chain on free chain.               */
+   State = OsAtomicLoad(&Handle->State);
+   do {
+      if (HAND_REF(State) != HAND_REF(Nbr) ||         /* Reference match?    */
+          HAND_USE(State) == 0 ||                     /* Not being free'd?   */
+          (State & HAND_DYING)) {
          OsEnable();                   /* Enable interrupts.                 */
-         return Resource;              /* Return destroyed ok.               */
-
+         return NULL;                  /* Return, handle not found.          */
       }
+   } while (!OsAtomicCas(&Handle->State, &State, (State | HAND_DYING) - 1));
+
+   if (HAND_USE(State) > 1) {          /* Still protected by others?         */
+      Handle->Pid = CurrPid;           /* Get our Pid.                       */
+      OsSuspend(CurrPid);              /* Wait until all are finished.       */
    }
 
+   Resource = HandFree(Anchor, Handle, State);
+
    OsEnable();                         /* Enable interrupts.                 */
-   return NULL;                        /* Return, handle not found.          */
+   return Resource;                    /* Return destroyed ok.               */
 }
 
 
 
 /*---------------------------------------------------------------------------*/
-/* OsHandProtect() -- Protect a handle from being destroyed...               */
+/* OsHandRetire() -- Destroy a handle without waiting. Free(Resource) is     */
+/* called, disabled, when no one protects it any more: now, or by the last   */
+/* OsHandUnprotect()...                                                      */
 /*---------------------------------------------------------------------------*/
 
-void  *OsHandProtect(void *A, HANDLE  Nbr)
+int   OsHandRetire(void *A, HANDLE  Nbr, int (*Free)(void *))
 {
+   struct HandleAnchor  *Anchor = (struct HandleAnchor *) A;
    struct HandleElement *Handle;
-   struct HandleSegment *Segment;
-   struct HandleAnchor  *Anchor;
+   ULONG                 State;
 
 
-   if ((Anchor = (struct HandleAnchor *) A) == NULL)
-      return NULL;
+   if ((Handle = HandElement(A, Nbr)) == NULL)
+      return SYSERR;
 
    OsDisable();                        /* Disable interrupts.                */
 
-   if ((Segment = Anchor->Segments[(Nbr >> 8) & 0xff]) != NULL) {
-      Handle = &(Segment->Handles[Nbr & 0xff]);
-      if (Handle->Reference == Nbr >> 16 &&   /* Reference match?         */
-          Handle->Use       != 0xffff    &&   /* Not max use count?       */
-          Handle->Use       >  0) {           /* Not being free'd?        */
-         Handle->Use++;             /* Increment use count.               */
-         OsEnable();                /* Enable interrupts.                 */
-         return Handle->Resource;   /* Return with resource.              */
-      }
+   State = OsAtomicLoad(&Handle->State);
+   if (HAND_REF(State) != HAND_REF(Nbr) ||            /* Reference match?    */
+       HAND_USE(State) == 0 ||                        /* Not being free'd?   */
+       (State & HAND_DYING)) {
+      OsEnable();
+      return SYSERR;                   /* Return, handle not found.          */
    }
+
+   Handle->Free = Free;                /* Before anyone can see it dying.    */
+
+   while (!OsAtomicCas(&Handle->State, &State, (State | HAND_DYING) - 1))
+      ;                                /* Only use count changes meanwhile.  */
+
+   if (HAND_USE(State) == 1)           /* No one else has it, free it now.   */
+      (*Free)(HandFree(Anchor, Handle, State));
+
    OsEnable();                         /* Enable interrupts.                 */
-   return NULL;                        /* Return, handle not valid.          */
+   return SYSOK;
 }
 
 
 
 /*---------------------------------------------------------------------------*/
-/* OsHandUnprotect() -- Unprotect a handle from being destroyed...           */
+/* OsHandProtect() -- Protect a handle from being destroyed...               */
 /*---------------------------------------------------------------------------*/
 
-int  OsHandUnprotect(void *A, HANDLE  Nbr)
+void  *OsHandProtect(void *A, HANDLE  Nbr)
 {
    struct HandleElement *Handle;
-   struct HandleSegment *Segment;
-   struct HandleAnchor  *Anchor;
+   ULONG                 State;
 
 
-   if ((Anchor = (struct HandleAnchor *) A) == NULL)
+   if ((Handle = HandElement(A, Nbr)) == NULL)
       return NULL;
 
-   OsDisable();                        /* Disable interrupts.                */
+   State = OsAtomicLoad(&Handle->State);
+   do {
+      if (HAND_REF(State) != HAND_REF(Nbr)   ||       /* Reference match?    */
+          HAND_USE(State) == HAND_MAXUSE     ||       /* Not max use count?  */
+          HAND_USE(State) == 0               ||       /* Not being free'd?   */
+          (State & HAND_DYING))                       /* Not being destroyed?*/
+         return NULL;                  /* Return, handle not valid.          */
+   } while (!OsAtomicCas(&Handle->State, &State, State + 1));
 
-   if ((Segment = Anchor->Segments[(Nbr >> 8) & 0xff]) != NULL) {
-      Handle = &(Segment->Handles[Nbr & 0xff]);
-      if (Handle->Reference == Nbr >> 16 &&   /* Reference match?         */
-          Handle->Use       >  0) {           /* Not being free'd?        */
-         if (Handle->Use-- == 0) {  /* Increment use count.               */
-            OsResume(Handle->Pid);  /* If zero, then unlock destroyer.    */
-            Handle->Reference++;    /* Bump up reference count.           */
-         }
-         OsEnable();                /* Enable interrupts.                 */
-         return SYSOK;              /* Return, handle unprotected.        */
-      }
+   return Handle->Resource;            /* Can't change while we protect it.  */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHandUnprotect() -- Unprotect a handle from being destroyed...           */
+/*---------------------------------------------------------------------------*/
+
+int  OsHandUnprotect(void *A, HANDLE  Nbr)
+{
+   struct HandleElement *Handle;
+   ULONG                 State;
+
+
+   if ((Handle = HandElement(A, Nbr)) == NULL)
+      return SYSERR;
+
+   State = OsAtomicLoad(&Handle->State);
+   do {
+      if (HAND_REF(State) != HAND_REF(Nbr) ||         /* Reference match?    */
+          HAND_USE(State) == 0)                       /* Not being free'd?   */
+         return SYSERR;                /* Return, handle not found.          */
+   } while (!OsAtomicCas(&Handle->State, &State, State - 1));
+
+   if (HAND_USE(State) == 1 &&         /* If last user, then unlock          */
+       (State & HAND_DYING)) {         /* destroyer, or free if retired.     */
+      OsDisable();                     /* Destroyer is suspended by now.     */
+      if (Handle->Free)
+         (*Handle->Free)(HandFree((struct HandleAnchor *) A, Handle, State));
+      else
+         OsResume(Handle->Pid);
+      OsEnable();
    }
 
-   OsEnable();                         /* Enable interrupts.                 */
-   return SYSERR;                      /* Return, handle not found.          */
+   return SYSOK;                       /* Return, handle unprotected.        */
 }
 
 
@@ -234,25 +340,133 @@ int  OsHandUnprotect(void *A, HANDLE  Nbr)
 void  *OsHandFind(void *A, HANDLE  Nbr)
 {
    struct HandleElement *Handle;
-   struct HandleSegment *Segment;
-   struct HandleAnchor  *Anchor;
+   ULONG                 State;
+   void                 *Resource;
 
 
-   if ((Anchor = (struct HandleAnchor *) A) == NULL)
+   if ((Handle = HandElement(A, Nbr)) == NULL)
       return NULL;
 
-   OsDisable();                        /* Disable interrupts.                */
+   do {
+      State = OsAtomicLoad(&Handle->State);
+      if (HAND_REF(State) != HAND_REF(Nbr) ||         /* Reference match?    */
+          HAND_USE(State) == 0 ||                     /* Not being free'd?   */
+          (State & HAND_DYING))                       /* Not being destroyed?*/
+         return NULL;                  /* Return, handle not found.          */
+      Resource = OsAtomicLoad(&Handle->Resource);
+   } while (HAND_REF(OsAtomicLoad(&Handle->State)) != HAND_REF(State));
 
-   if ((Segment = Anchor->Segments[(Nbr >> 8) & 0xff]) != NULL) {
-      Handle = &(Segment->Handles[Nbr & 0xff]);
-      if (Handle->Reference == Nbr >> 16 &&   /* Reference match?         */
-          Handle->Use       >  0) {           /* Not being free'd?        */
-         OsEnable();                /* Enable interrupts.                 */
-         return Handle->Resource;   /* Return with resource.              */
-      }
+   return Resource;                    /* Return with resource.              */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HandSegment() -- Locate segment holding a handle index, NULL if it was    */
+/* never allocated...                                                        */
+/*---------------------------------------------------------------------------*/
+
+static struct HandleSegment *HandSegment( struct HandleAnchor *Anchor,
+                                          ULONG Index )
+{
+   struct HandleTable   *Table;
+
+   if ((Table = OsAtomicLoad(&Anchor->Tables[Index >> 16])) == NULL)
+      return NULL;
+
+   return OsAtomicLoad(&Table->Segments[(Index >> 8) & 0xff]);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HandElement() -- Locate element of a handle, NULL if it can't be one...   */
+/*---------------------------------------------------------------------------*/
+
+static struct HandleElement *HandElement( void *A, HANDLE Nbr )
+{
+   struct HandleSegment *Segment;
+
+   if (A == NULL || HAND_BAD(Nbr) ||
+       (Segment = HandSegment((struct HandleAnchor *) A,
+                              HAND_INDEX(Nbr))) == NULL)
+      return NULL;
+
+   return &(Segment->Handles[Nbr & 0xff]);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HandGrow() -- Called disabled. Add a segment of free handles, and a table */
+/* for it if this is the first segment of the table...                       */
+/*---------------------------------------------------------------------------*/
+
+static int HandGrow( struct HandleAnchor *Anchor )
+{
+   struct HandleTable   *Table;
+   struct HandleSegment *Segment;
+   ULONG                 Index;
+   int                   i;
+
+   if (Anchor->SegCount >= (ULONG) HAND_NTABLE * 256)
+      return SYSERR;                   /* Handle space is full.              */
+
+   Index = Anchor->SegCount << 8;      /* First handle index of segment.     */
+
+   if ((Table = Anchor->Tables[Index >> 16]) == NULL) {
+      if ((Table = OsAlloc(sizeof(struct HandleTable))) == NULL)
+         return SYSERR;
+      OsAtomicStore(&Anchor->Tables[Index >> 16], Table);
    }
 
-   OsEnable();                         /* Enable interrupts.                 */
-   return NULL;                        /* Return, handle not found.          */
+   if ((Segment = OsAlloc(sizeof(struct HandleSegment))) == NULL)
+      return SYSERR;
+
+   for (i = 255; i >= 0; i--) {        /* Lowest handle is first free.       */
+      Segment->Handles[i].Index    = Index + i;
+      Segment->Handles[i].State    = (ULONG) 1 << HAND_GENSHIFT;
+      Segment->Handles[i].Resource = (void *) Segment->Free;
+      Segment->Free = &(Segment->Handles[i]);
+   }
+
+   OsAtomicStore(&Table->Segments[(Index >> 8) & 0xff], Segment);
+   Anchor->SegCount++;
+
+   Segment->Next = Anchor->Avail;
+   Anchor->Avail = Segment;
+
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HandFree() -- Called disabled, when no one uses a dying handle any more.  */
+/* Unpublish it, put it on its segment's free chain, return its resource...  */
+/*---------------------------------------------------------------------------*/
+
+static void *HandFree( struct HandleAnchor *Anchor,
+                       struct HandleElement *Handle, ULONG State )
+{
+   struct HandleSegment *Segment;
+   void                 *Resource;
+   ULONG                 Ref;
+
+   if ((Ref = HAND_REF(State) + 1) == HAND_GENMAX)   /* Bump up generation,  */
+      Ref = 1;                         /*   never make a zero handle.        */
+   Handle->Pid = 0;
+   Resource = Handle->Resource;        /* Save resource.                     */
+   OsAtomicStore(&Handle->State, Ref << HAND_GENSHIFT);  /* Unpublish.       */
+
+   Segment = HandSegment(Anchor, Handle->Index);
+   if (Segment->Free == NULL) {        /* Segment has free handles again.    */
+      Segment->Next = Anchor->Avail;
+      Anchor->Avail = Segment;
+   }
+   OsAtomicStore(&Handle->Resource,    /* Release, so OsHandFind() can't see */
+                 (void *) Segment->Free);   /* it before the unpublish.      */
+   Segment->Free    = Handle;          /* Chain on free chain.               */
+
+   return Resource;
 }
-
\ No newline at end of file
@@ -0,0 +1,525 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSHOST.C                                              */
+/*                                                                           */
+/*             Title:  Hosted (Linux user space) machine support.            */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsHostInit()     - Install signals, start timer.      */
+/*                     OsHostTerm()     - Stop timer, restore signals.       */
+/*                     OsHostDispatch() - Deliver pending interrupts.        */
+/*                     OsHostClock()    - Read time of day from the host.    */
+/*                     OsHostFrame()    - Build a new process' context.      */
+/*                     OsHostStart()    - Run a new process.                 */
+/*                     OsHostIdle()     - Sleep, tickless, until interrupt.  */
+/*                     OsHostCpuStart() - Start a CPU thread (SMP).          */
+/*                     OsHostCpuInit()  - Start a CPU's timer (SMP).         */
+/*                     OsHostKick()     - Interrupt another CPU (SMP).       */
+/*                     OsSwitch()       - Switch context (ucontext only).    */
+/*                     getvect()        - Get interrupt vector.              */
+/*                     setvect()        - Set interrupt vector.              */
+/*                                                                           */
+/*                     The host timer (SIGALRM) plays the part of the PC     */
+/*                     timer interrupt on vector 08h. Contexts are switched  */
+/*                     by OsSwitch() in OSSWITCH.S on x86-64 and AArch64,    */
+/*                     or with the ucontext routines on other hosts and when */
+/*                     HOST_UCONTEXT is defined.                             */
+/*                                                                           */
+/*                     With OS_SMP each CPU is a host thread with its own    */
+/*                     timer, and CPUs kick each other with HOST_KICKSIG.    */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#if defined(OS_SMP)
+#define  _GNU_SOURCE                   /* For gettid().                      */
+#endif
+
+#include <sys/time.h>
+#include <errno.h>
+
+#include "oskernel.h"
+
+#if defined(OS_SMP)
+#include <pthread.h>
+#include <unistd.h>
+
+#ifndef  sigev_notify_thread_id
+#define  sigev_notify_thread_id  _sigev_un._tid
+#endif
+#endif
+
+#if defined(HOST_UCONTEXT)
+#include <ucontext.h>
+#endif
+
+
+
+#if defined(HOST_UCONTEXT)
+/*---------------------------------------------------------------------------*/
+/* Initial frame placed at the top of a new process' stack...                */
+/*---------------------------------------------------------------------------*/
+
+struct HostFrame {
+   ucontext_t      Context;            /* Saved context of process.          */
+   void          (*ProcAddr)(char *);  /* Procedure address.                 */
+   char           *Data;               /* Argument passed to new process.    */
+};
+
+typedef struct HostFrame HOSTFRAME;
+
+#else
+/*---------------------------------------------------------------------------*/
+/* Initial frame popped by OsSwitch() in OSSWITCH.S. Sizes are in longs...   */
+/*---------------------------------------------------------------------------*/
+
+#if defined(__x86_64__)
+#define  FRAME_SIZE   8                /* Control words, 6 regs, return.     */
+#define  FRAME_CTRL   0                /* MXCSR and x87 control word.        */
+#define  FRAME_PROC   4                /* R12.                               */
+#define  FRAME_DATA   3                /* R13.                               */
+#define  FRAME_RET    7                /* Return address.                    */
+#define  FRAME_INIT   0x037F00001F80UL /* Default x87 CW and MXCSR.          */
+#else
+#define  FRAME_SIZE   20               /* X19-X30, D8-D15.                   */
+#define  FRAME_PROC   0                /* X19.                               */
+#define  FRAME_DATA   1                /* X20.                               */
+#define  FRAME_RET    11               /* X30 (link register).               */
+#endif
+
+extern void OsHostEntry( void );       /* Entry stub in OSSWITCH.S.          */
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Static local data...                                                      */
+/*---------------------------------------------------------------------------*/
+
+#if !defined(OS_SMP)
+volatile sig_atomic_t  HostIntMask;    /* Interrupts are disabled.           */
+volatile sig_atomic_t  HostIntPending; /* Interrupts held pending.           */
+#endif
+
+static HOSTVECT          Vector[HOST_NVECT];    /* Interrupt vector table.   */
+static struct sigaction  OldAlarm;     /* Prior SIGALRM action.              */
+
+#if defined(OS_SMP)
+static pthread_t         Thread[NCPU]; /* Host thread running each CPU.      */
+static timer_t           CpuTimer[NCPU];  /* Tick timer of each CPU.         */
+#endif
+
+
+static void  HostNull(   void );       /* Default interrupt routine.         */
+static void  HostSignal( int Sig );    /* SIGALRM/HOST_KICKSIG handler.      */
+static int   HostTimer(  long First, long Interval);  /* Set tick timer.     */
+#if defined(HOST_UCONTEXT)
+static void  HostStart(  unsigned int Hi, unsigned int Lo);
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostInit() -- Install signal handler and start the host timer...        */
+/*---------------------------------------------------------------------------*/
+
+int   OsHostInit( void )
+{
+   struct sigaction  Action;
+   int               i;
+
+   for (i = 0; i < HOST_NVECT; i++)    /* Point vectors at null routine.     */
+      if (Vector[i] == NULL)
+         Vector[i] = HostNull;
+
+   memset(&Action, 0, sizeof(Action));
+   Action.sa_handler = HostSignal;
+   Action.sa_flags   = SA_RESTART |    /* Don't break host system calls.     */
+                       SA_NODEFER;     /* We may switch away in handler.     */
+   sigemptyset(&Action.sa_mask);
+
+   if (sigaction(SIGALRM, &Action, &OldAlarm) != 0)
+      return SYSERR;
+
+#if defined(OS_SMP)
+   if (sigaction(HOST_KICKSIG, &Action, NULL) != 0)
+      return SYSERR;
+
+   Thread[0] = pthread_self();         /* Main line is CPU 0.                */
+   return OsHostCpuInit(0);
+#endif
+
+   return HostTimer(HOST_TICK, HOST_TICK);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostTerm() -- Stop the host timer and restore signal handler. With      */
+/* OS_SMP the other CPU threads keep running, and a kick or tick already on  */
+/* its way to one would kill the program under the default action, so the   */
+/* signals are ignored instead...                                            */
+/*---------------------------------------------------------------------------*/
+
+int   OsHostTerm( void )
+{
+#if defined(OS_SMP)
+   struct sigaction  Action;
+   int               i;
+
+   memset(&Action, 0, sizeof(Action));
+   Action.sa_handler = SIG_IGN;
+   sigemptyset(&Action.sa_mask);
+   sigaction(HOST_KICKSIG, &Action, NULL);
+   sigaction(SIGALRM, &Action, NULL);
+
+   for (i = 0; i < NumCpu; i++)        /* Stop every CPU's tick.             */
+      timer_delete(CpuTimer[i]);
+#else
+   struct itimerval  Timer;
+
+   memset(&Timer, 0, sizeof(Timer));
+   setitimer(ITIMER_REAL, &Timer, NULL);
+   sigaction(SIGALRM, &OldAlarm, NULL);
+#endif
+
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostDispatch() -- Deliver interrupts that came in while disabled...     */
+/*---------------------------------------------------------------------------*/
+
+void  OsHostDispatch( void )
+{
+   int   Pend;
+
+   while ((Pend = __atomic_exchange_n(&HostIntPending, 0,
+                                      __ATOMIC_SEQ_CST)) != 0) {
+      HostIntMask = 1;                 /* Run isr disabled, like hardware.   */
+      if (Pend & HOST_PEND_TIMER)
+         (*Vector[HOST_TIMER])();
+      if (Pend & HOST_PEND_KICK)
+         (*Vector[HOST_KICK])();
+      HostIntMask = 0;
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostClock() -- Get time of day from the host clock...                   */
+/*---------------------------------------------------------------------------*/
+
+void  OsHostClock( ULONG *Secs, USHORT *Msecs )
+{
+   struct timespec   Now;
+
+   clock_gettime(CLOCK_REALTIME, &Now);
+
+   *Secs  = (ULONG)  Now.tv_sec;
+   *Msecs = (USHORT) (Now.tv_nsec / 1000000L);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostFrame() -- Build initial context at top of a new process' stack.    */
+/* Returns the value to keep in PROCESS.Stack. With no stack given, return   */
+/* a place to save the context of the INIT (main line) process...            */
+/*---------------------------------------------------------------------------*/
+
+#if defined(HOST_UCONTEXT)
+BYTE *OsHostFrame( BYTE *Base, int Size, void *ProcAddr, void *Data )
+{
+   HOSTFRAME   *Frame;
+   ULONG        Addr;
+
+   if (Base == NULL)                   /* INIT process runs on host stack.   */
+      return (BYTE *) calloc(1, sizeof(ucontext_t));
+
+   Addr  = (ULONG) (Base + Size - sizeof(HOSTFRAME));
+   Addr &= ~15UL;                      /* Align frame to 16 bytes.           */
+   Frame = (HOSTFRAME *) Addr;
+
+   Frame->ProcAddr = (void (*)(char *)) ProcAddr;
+   Frame->Data     = (char *) Data;
+
+   getcontext(&Frame->Context);
+   Frame->Context.uc_stack.ss_sp   = Base;
+   Frame->Context.uc_stack.ss_size = (BYTE *) Frame - Base;
+   Frame->Context.uc_link          = NULL;
+
+   makecontext(&Frame->Context, (void (*)(void)) HostStart, 2,
+               (unsigned int) ((unsigned long long) Addr >> 32),
+               (unsigned int) ((ULONG) Frame));
+
+   return (BYTE *) &Frame->Context;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSwitch() -- Switch context from one process to another...               */
+/*---------------------------------------------------------------------------*/
+
+void  OsSwitch( BYTE **Stack1, BYTE **Stack2 )
+{
+   swapcontext((ucontext_t *) *Stack1, (ucontext_t *) *Stack2);
+}
+
+#else
+BYTE *OsHostFrame( BYTE *Base, int Size, void *ProcAddr, void *Data )
+{
+   ULONG       *Frame;
+
+   if (Base == NULL)                   /* INIT process runs on host stack.   */
+      return NULL;                     /* OsSwitch() fills in its Stack.     */
+
+   Frame  = (ULONG *) (((ULONG) (Base + Size)) & ~15UL);
+   Frame -= FRAME_SIZE;                /* Top of stack is 16 byte aligned.   */
+   memset(Frame, 0, FRAME_SIZE * sizeof(ULONG));
+
+#if defined(__x86_64__)
+   Frame[FRAME_CTRL] = FRAME_INIT;
+#endif
+   Frame[FRAME_PROC] = (ULONG) ProcAddr;
+   Frame[FRAME_DATA] = (ULONG) Data;
+   Frame[FRAME_RET]  = (ULONG) OsHostEntry;
+
+   return (BYTE *) Frame;
+}
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* getvect()/setvect() -- Get and set interrupt vectors...                   */
+/*---------------------------------------------------------------------------*/
+
+HOSTVECT getvect( int Nbr )
+{
+   return Vector[Nbr] != NULL ? Vector[Nbr] : HostNull;
+}
+
+
+void  setvect( int Nbr, HOSTVECT Isr )
+{
+   Vector[Nbr] = Isr;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostIdle() -- Sleep until a signal comes in. Called disabled; a signal  */
+/* that arrives first is already pending, so we don't sleep through it.      */
+/* The periodic tick is stopped while we sleep: the timer fires once when    */
+/* the next sleeper is due, Wait millisecs from now, or never if Wait is -1. */
+/*---------------------------------------------------------------------------*/
+
+void  OsHostIdle( long Wait )
+{
+   sigset_t    Block;
+   sigset_t    Old;
+
+   if (Wait == 0)                      /* Sleeper already due.               */
+      return;
+
+   sigemptyset(&Block);
+   sigaddset(&Block, SIGALRM);
+   sigaddset(&Block, HOST_KICKSIG);
+   sigprocmask(SIG_BLOCK, &Block, &Old);
+
+   if (!HostIntPending) {              /* Nothing yet, wait for a signal.    */
+      HostTimer(Wait > 0 ? Wait : 0, 0);
+      sigsuspend(&Old);
+      HostTimer(HOST_TICK, HOST_TICK); /* Back to ticking.                   */
+   }
+
+   sigprocmask(SIG_SETMASK, &Old, NULL);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HostTimer() -- Set tick timer of this CPU to fire First millisecs from    */
+/* now and every Interval after that. Zero First stops it...                 */
+/*---------------------------------------------------------------------------*/
+
+static int HostTimer( long First, long Interval )
+{
+#if defined(OS_SMP)
+   struct itimerspec Spec;
+
+   Spec.it_value.tv_sec     = First / 1000;
+   Spec.it_value.tv_nsec    = (First % 1000) * 1000000L;
+   Spec.it_interval.tv_sec  = Interval / 1000;
+   Spec.it_interval.tv_nsec = (Interval % 1000) * 1000000L;
+
+   return timer_settime(CpuTimer[OsCpu()->Id], 0, &Spec, NULL) == 0 ?
+          SYSOK : SYSERR;
+#else
+   struct itimerval  Timer;
+
+   Timer.it_value.tv_sec     = First / 1000;
+   Timer.it_value.tv_usec    = (First % 1000) * 1000L;
+   Timer.it_interval.tv_sec  = Interval / 1000;
+   Timer.it_interval.tv_usec = (Interval % 1000) * 1000L;
+
+   return setitimer(ITIMER_REAL, &Timer, NULL) == 0 ? SYSOK : SYSERR;
+#endif
+}
+
+
+
+#if defined(OS_SMP)
+/*---------------------------------------------------------------------------*/
+/* OsHostCpuStart() -- Start host thread to run a CPU. The thread starts     */
+/* with signals blocked; OsHostCpuInit() opens them once it knows its CPU... */
+/*---------------------------------------------------------------------------*/
+
+static void *HostCpu( void *Arg )
+{
+   OsSmpCpu((int) (long) Arg);         /* Does not return.                   */
+   return NULL;
+}
+
+
+int   OsHostCpuStart( int Cpu )
+{
+   sigset_t    Block;
+   sigset_t    Old;
+   int         rc;
+
+   sigemptyset(&Block);
+   sigaddset(&Block, SIGALRM);
+   sigaddset(&Block, HOST_KICKSIG);
+   pthread_sigmask(SIG_BLOCK, &Block, &Old);
+
+   rc = pthread_create(&Thread[Cpu], NULL, HostCpu, (void *) (long) Cpu);
+
+   pthread_sigmask(SIG_SETMASK, &Old, NULL);
+
+   return rc == 0 ? SYSOK : SYSERR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostCpuInit() -- Start tick timer aimed at the calling thread...        */
+/*---------------------------------------------------------------------------*/
+
+int   OsHostCpuInit( int Cpu )
+{
+   struct sigevent   Event;
+   sigset_t          Open;
+
+   memset(&Event, 0, sizeof(Event));
+   Event.sigev_notify           = SIGEV_THREAD_ID;
+   Event.sigev_signo            = SIGALRM;
+   Event.sigev_notify_thread_id = gettid();
+
+   if (timer_create(CLOCK_MONOTONIC, &Event, &CpuTimer[Cpu]) != 0)
+      return SYSERR;
+
+   if (HostTimer(HOST_TICK, HOST_TICK) != SYSOK)
+      return SYSERR;
+
+   sigemptyset(&Open);
+   sigaddset(&Open, SIGALRM);
+   sigaddset(&Open, HOST_KICKSIG);
+   pthread_sigmask(SIG_UNBLOCK, &Open, NULL);
+
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostKick() -- Interrupt another CPU...                                  */
+/*---------------------------------------------------------------------------*/
+
+void  OsHostKick( int Cpu )
+{
+   pthread_kill(Thread[Cpu], HOST_KICKSIG);
+}
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HostSignal() -- Signal handler. Run the isr for the signal, or hold it    */
+/* pending if interrupts are disabled...                                     */
+/*---------------------------------------------------------------------------*/
+
+static void HostSignal( int Sig )
+{
+   int   Err = errno;                  /* Process may be switched out here.  */
+   int   Bit = (Sig == HOST_KICKSIG) ? HOST_PEND_KICK : HOST_PEND_TIMER;
+
+   if (HostIntMask) {                  /* Interrupts disabled?               */
+      __atomic_fetch_or(&HostIntPending, Bit, __ATOMIC_SEQ_CST);
+      errno = Err;                     /* Deliver later from enable().       */
+      return;
+   }
+
+   HostIntMask = 1;                    /* Run isr disabled, like hardware.   */
+   (*Vector[Bit == HOST_PEND_KICK ? HOST_KICK : HOST_TIMER])();
+   HostIntMask = 0;
+
+   if (HostIntPending)                 /* Another came in during isr?        */
+      OsHostDispatch();
+
+   errno = Err;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHostStart() -- First code run by a new process. Call procedure, then    */
+/* kill process if it returns...                                             */
+/*---------------------------------------------------------------------------*/
+
+void  OsHostStart( void (*ProcAddr)(char *), char *Data )
+{
+   DisableCount = 1;                   /* Still inside OsSched()'s disable.  */
+   OsEnable();                         /* New process runs enabled.          */
+
+   (*ProcAddr)(Data);                  /* Run the process.                   */
+
+   OsReturn();                         /* Kill it when it returns.           */
+}
+
+
+#if defined(HOST_UCONTEXT)
+static void HostStart( unsigned int Hi, unsigned int Lo )
+{
+   HOSTFRAME   *Frame;
+
+   Frame = (HOSTFRAME *) (ULONG) (((unsigned long long) Hi << 32) | Lo);
+
+   OsHostStart(Frame->ProcAddr, Frame->Data);
+}
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* HostNull() -- Default routine for unused interrupt vectors...             */
+/*---------------------------------------------------------------------------*/
+
+static void HostNull( void )
+{
+}
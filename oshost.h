@@ -0,0 +1,128 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSHOST.H                                              */
+/*                                                                           */
+/*             Title:  Hosted (Linux user space) target definitions.         */
+/*                                                                           */
+/*       Description:  When the kernel is built with OS_HOSTED it runs as a  */
+/*                     green thread runtime inside a single Linux process.   */
+/*                     This file supplies what the real mode build gets from */
+/*                     DOS.H: enable()/disable(), getvect()/setvect() and    */
+/*                     the interrupt/far keywords. Interrupts are emulated   */
+/*                     with host signals that are held pending while the     */
+/*                     kernel has "interrupts" disabled. With OS_SMP each    */
+/*                     CPU (host thread) has its own interrupt flag.         */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include <signal.h>
+
+
+/*---------------------------------------------------------------------------*/
+/* Real mode keywords that mean nothing on the host...                       */
+/*---------------------------------------------------------------------------*/
+
+#define  interrupt
+#define  far
+
+
+/*---------------------------------------------------------------------------*/
+/* Configuration options...                                                  */
+/*---------------------------------------------------------------------------*/
+
+#ifndef  HOST_TICK
+#define  HOST_TICK    10               /* Timer tick period in millisecs.    */
+#endif
+
+#define  HOST_NVECT   256              /* Number of interrupt vectors.       */
+#define  HOST_TIMER   0x08             /* Vector driven by the host timer.   */
+#define  HOST_KICK    0x60             /* Vector for CPU to CPU kicks (SMP). */
+
+#define  HOST_KICKSIG SIGUSR2          /* Host signal that carries a kick.   */
+
+#define  HOST_PEND_TIMER  0x01         /* HostIntPending bits.               */
+#define  HOST_PEND_KICK   0x02
+
+#if !defined(__x86_64__) && !defined(__aarch64__) && !defined(HOST_UCONTEXT)
+#define  HOST_UCONTEXT                 /* No OSSWITCH.S for this host.       */
+#endif
+
+
+/*---------------------------------------------------------------------------*/
+/* Emulated interrupt flag. HostIntMask is set while interrupts are          */
+/* disabled; a signal arriving then is recorded in HostIntPending and        */
+/* delivered by enable()...                                                  */
+/*---------------------------------------------------------------------------*/
+
+#if defined(OS_SMP)
+struct HostInt {
+   volatile sig_atomic_t  Mask;        /* Interrupts are disabled.           */
+   volatile sig_atomic_t  Pending;     /* Interrupts held pending.           */
+};
+
+struct HostInt *OsHostInt( void );     /* Flag of CPU we are running on.     */
+
+#define  HostIntMask     (OsHostInt()->Mask)
+#define  HostIntPending  (OsHostInt()->Pending)
+#else
+extern volatile sig_atomic_t  HostIntMask;    /* Interrupts are disabled.    */
+extern volatile sig_atomic_t  HostIntPending; /* Interrupts held pending.    */
+#endif
+
+void      OsHostDispatch( void );      /* Deliver pending interrupts.        */
+
+static __inline__ void disable( void )
+{
+   HostIntMask = 1;
+   __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static __inline__ void enable( void )
+{
+   __atomic_signal_fence(__ATOMIC_SEQ_CST);
+   HostIntMask = 0;
+   if (HostIntPending)                 /* Anything arrive while disabled?    */
+      OsHostDispatch();
+}
+
+
+/*---------------------------------------------------------------------------*/
+/* Interrupt vectors...                                                      */
+/*---------------------------------------------------------------------------*/
+
+typedef void (*HOSTVECT)( void );
+
+HOSTVECT  getvect(      int Vector);                /* Get vector routine.   */
+void      setvect(      int Vector, HOSTVECT Isr);  /* Set vector routine.   */
+
+
+/*---------------------------------------------------------------------------*/
+/* Host support routines...                                                  */
+/*---------------------------------------------------------------------------*/
+
+int       OsHostInit(   void );        /* Install signals and start timer.   */
+int       OsHostTerm(   void );        /* Stop timer and restore signals.    */
+void      OsHostClock(  ULONG *Secs, USHORT *Msecs);  /* Read host clock.    */
+BYTE     *OsHostFrame(  BYTE *Base,    /* Build initial context for process. */
+                        int   Size,
+                        void *ProcAddr,
+                        void *Data);
+void      OsHostStart(  void (*ProcAddr)(char *),     /* Run a new process.  */
+                        char *Data);
+void      OsHostIdle(   long Wait);    /* Sleep until signal or Wait millisec*/
+
+#if defined(OS_SMP)
+int       OsHostCpuStart( int Cpu);    /* Start host thread for a CPU.       */
+int       OsHostCpuInit(  int Cpu);    /* Start timer of calling CPU.        */
+void      OsHostKick(     int Cpu);    /* Interrupt another CPU.             */
+#endif
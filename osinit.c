@@ -32,6 +32,7 @@ int  OsInit( void )
 {
    HANDLE   Pid;                       /* Stores new process id.             */
    PROCESS *pptr;                      /* Pointer to process table entry.    */
+   int      i;
 
 
    OsDisable();                        /* Disable interrupts.                */
@@ -41,6 +42,11 @@ int  OsInit( void )
    /* Initialize fields...                                                   */
    /*------------------------------------------------------------------------*/
 
+   for (i = 0; i < NPRIO; i++)         /* Default time slice per priority.   */
+      Quantum[i] = OS_QUANTUM;
+
+   for (i = 0; i < NPOOL; i++)         /* Default process pool limits.       */
+      PoolMax[i] = OS_POOLMAX;
 
 
    /*------------------------------------------------------------------------*/
@@ -66,14 +72,21 @@ int  OsInit( void )
    pptr->Pid    = Pid;                 /* Process id of this process.        */
    pptr->State  = PRREADY;             /* Start it in ready state.           */
    strncpy(pptr->Name, "INIT", PNMLEN);      /* Process' name.               */
-   pptr->Prio   = -32767;              /* Process priority. Lowest possible. */
+   pptr->Prio   = 0;                   /* Process priority. Lowest possible. */
    pptr->Base   = NULL;                /* Base (bottom) of stack.            */
    pptr->StkLen = 0;                   /* Size of stack.                     */
-   Chain( &ReadyAnchor, NULL, &pptr->Link);   /* Put on ready queue.         */
-   CurrPid = Pid;                      /* Set current process id number.     */
+#if defined(OS_HOSTED)
+   pptr->Stack  = OsHostFrame(NULL, 0, NULL, NULL); /* Save area for context.*/
+#endif
+   PrioChain( &ReadyQueue, &pptr->Link, pptr->Prio);  /* On ready queue.   */
+   CurrPid  = Pid;                     /* Set current process id number.     */
+   CurrProc = pptr;                    /* And its process structure.         */
 
    OsHandUnprotect( ProcessAnchor, Pid);  /* Unprotect ?                     */
 
+#if defined(OS_HOSTED)
+   OsHostInit();                       /* Start host signals and timer.      */
+#endif
    OsSleepInit();                      /* Initialize sleep functions.        */
    OsDevInit();                        /* Initialize device functions.       */
 
@@ -94,7 +107,9 @@ int  OsTerm( void )
 {
    OsSleepTerm();                      /* Terminate sleep functions.         */
    OsDevTerm();                        /* Terminate device functions.        */
+#if defined(OS_HOSTED)
+   OsHostTerm();                       /* Stop host signals and timer.       */
+#endif
 
    return(SYSOK);
 }
-
\ No newline at end of file
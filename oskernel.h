@@ -31,6 +31,14 @@
 #include "oschain.h"
 #include "os.h"
 
+#if defined(OS_HOSTED)
+#include "oshost.h"                    /* Hosted target machine support.     */
+#endif
+
+#if defined(OS_SMP) && !defined(OS_HOSTED)
+#error OS_SMP is only supported by the hosted (OS_HOSTED) build
+#endif
+
 
 
 /*---------------------------------------------------------------------------*/
@@ -41,6 +49,47 @@
 #define  NMSG         12               /* Set maximum messages queable.      */
 #endif
 
+#ifndef  OS_QUANTUM
+#define  OS_QUANTUM   0                /* Default time slice in ticks, or 0  */
+#endif                                 /* for no preemption (cooperative).   */
+
+#ifndef  NCPU
+#define  NCPU         32               /* Maximum CPUs in an OS_SMP build.   */
+#endif
+
+#ifndef  NPOOL
+#define  NPOOL        7                /* Stack size classes pooled, each    */
+#endif                                 /* twice the last from MIN_STACK_SIZE.*/
+
+#ifndef  OS_POOLMAX
+#define  OS_POOLMAX   8                /* Default killed procs kept, per     */
+#endif                                 /* class, for reuse by OsCreate().    */
+
+#ifndef  OS_INHERIT
+#define  OS_INHERIT   1                /* Lock owners inherit priority of    */
+#endif                                 /* waiters, 0 to turn off.            */
+
+#ifndef  OS_LOCKSPIN
+#define  OS_LOCKSPIN  1000             /* OS_SMP: times to look at a lock    */
+#endif                                 /* held by a running owner before     */
+                                       /* waiting, 0 to always wait.         */
+
+#ifndef  NLOCKHASH
+#define  NLOCKHASH    32               /* Buckets to find lock turnstiles.   */
+#endif
+
+#ifndef  NWAIT
+#define  NWAIT        16               /* Most objects for OsWaitAny/All().  */
+#endif
+
+#ifndef  OS_MSGINLINE
+#define  OS_MSGINLINE 64               /* Messages this short are copied     */
+#endif                                 /* into the MESSAGE itself.           */
+
+#ifndef  NMSGSLAB
+#define  NMSGSLAB     64               /* MESSAGEs the pool gets at a time.  */
+#endif
+
 
 
 /*---------------------------------------------------------------------------*/
@@ -57,6 +106,10 @@
 #define  PRLOCK         8              /* Process is waiting for LOCK.       */
 #define  PRSLEEP        9              /* Process is SLEEPING.               */
 #define  PRWAKING      10              /* Process is waking up.              */
+#define  PRMULTI       11              /* Process is in OsWaitAny/All().     */
+#define  PREVENT       12              /* Process waits on EVENT flags.      */
+#define  PRPORT        13              /* Process waits to receive on PORT.  */
+#define  PRCALL        14              /* Process waits for reply to CALL.   */
 
 
 
@@ -65,6 +118,7 @@
 /*---------------------------------------------------------------------------*/
 
 #define  PNMLEN      9                 /* Length of process "name".          */
+#define  PORTNMLEN   17                /* Length of port name.               */
 #define  NULLPROC    0                 /* ID of the null process.            */
 
 
@@ -77,16 +131,31 @@ struct Process {
    HANDLE          Pid;                /* Process ID of this process.        */
    char            State;              /* Process state: PRCURR, etc.        */
    short           Prio;               /* Process priority.                  */
+   short           BasePrio;           /* Priority not counting inheritance. */
    BYTE           *Base;               /* Lower base of run time stack.      */
    BYTE           *Stack;              /* Saved stack pointer.               */
-   USHORT          StkLen;             /* Stack length.                      */
+   ULONG           StkLen;             /* Stack length.                      */
    char            Name[PNMLEN];       /* Process name.                      */
    short           Flags;              /* Process flags.                     */
    int             Disable;            /* Disable nest count.                */
    HANDLE          Sem;                /* Semaphore if process waiting.      */
    ANCHOR          Msgs;               /* Messages semt to process.          */
    BYTE            MsgCount;           /* Messages presently queued.         */
-   HANDLE          Lock;               /* Wait chain for lock.               */
+   HANDLE         *Lock;               /* Lock process is waiting for.       */
+   ANCHOR          Held;               /* Turnstiles of locks held.          */
+   short           Cpu;                /* CPU whose ready queue it is on.    */
+   struct Event   *Timer;              /* Sleep or timeout event, if any.    */
+   HANDLE         *Sending;            /* Pid word of message it waits on.   */
+   struct Watch   *Watch;              /* Watches of OsWaitAny/All().        */
+   short           Watches;            /* How many.                          */
+   struct EventWait *EventWait;        /* Its wait on event flags, if any.   */
+   struct MsgBox  *Box;                /* Mailbox ring, or NULL for Msgs.    */
+   struct PortWait *PortWait;          /* Its wait on a port, if any.        */
+   LINK            CallLink;           /* Chain of callers of Server.        */
+   HANDLE          Server;             /* Process it calls, until replied.   */
+   ANCHOR          Callers;            /* Processes calling it, to reply to. */
+   HANDLE          Caller;             /* Sender of call last received.      */
+   struct Message *Reply;              /* Reply to its call.                 */
 };
 
 
@@ -98,6 +167,10 @@ typedef struct Process PROCESS;        /* Alternate for process struct.      */
 /*---------------------------------------------------------------------------*/
 
 #define PROCESS_CANT_KILL      0x80    /* Can not kill this process.         */
+#define PROCESS_KILLED         0x40    /* Kill when it next schedules (SMP). */
+#define PROCESS_STOPPED        0x20    /* Suspend when next schedules (SMP). */
+#define PROCESS_TIMEDOUT       0x10    /* Timer ended its wait.              */
+#define PROCESS_WATCHMSG       0x08    /* OsWaitAny/All() includes messages. */
 
 
 
@@ -108,13 +181,71 @@ typedef struct Process PROCESS;        /* Alternate for process struct.      */
 
 struct Semaphore {
    int            Count;               /* Semaphore count.                   */
-   ANCHOR         WaitList;            /* Chain of waiting processes.        */
+   WAITQ          WaitList;            /* Queue of waiting processes.        */
+   ANCHOR         Watchers;            /* Watches of OsWaitAny/All().        */
 };
 
 typedef struct Semaphore SEMAPHORE;    /* Alternate for semaphore struct.    */
 
 
 
+/*---------------------------------------------------------------------------*/
+/* Event flag group, and a process's wait on one (on its stack)...           */
+/*---------------------------------------------------------------------------*/
+
+struct EventGroup {
+   ULONG          Flags;               /* Flag word.                         */
+   ANCHOR         Waiters;             /* EVENTWAITs of waiting processes.   */
+};
+
+typedef struct EventGroup EVENTGROUP;  /* Alternate for event group struct.  */
+
+
+struct EventWait {
+   LINK           Link;                /* Chain of waiters on group.         */
+   ANCHOR        *On;                  /* Group's chain, NULL when off it.   */
+   struct Process *Proc;               /* Process waiting.                   */
+   ULONG          Mask;                /* Flags it waits for.                */
+   int            Options;             /* OS_EVENT_ALL, OS_EVENT_CLEAR.      */
+   ULONG          Flags;               /* Flag word that satisfied it.       */
+   int            Rc;                  /* SYSOK, or SYSERR if group deleted. */
+};
+
+typedef struct EventWait EVENTWAIT;    /* Alternate for event wait struct.   */
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Turnstile, queue of processes waiting for a lock...                       */
+/*---------------------------------------------------------------------------*/
+
+struct Turnstile {
+   LINK           Link;                /* Chain in lock hash bucket.         */
+   LINK           Held;                /* Chain of locks held by owner.      */
+   HANDLE        *Lock;                /* Lock word it belongs to.           */
+   WAITQ          Waiters;             /* Processes waiting, first is next.  */
+};
+
+typedef struct Turnstile TURNSTILE;    /* Alternate for turnstile struct.    */
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Watch, one object a process waits on in OsWaitAny/All(). Any change       */
+/* that may make the object ready readies the watching process, which then  */
+/* looks at all its objects again...                                         */
+/*---------------------------------------------------------------------------*/
+
+struct Watch {
+   LINK           Link;                /* Chain of watchers of object.       */
+   ANCHOR        *On;                  /* Chain it is on, NULL when none.    */
+   struct Process *Proc;               /* Process watching.                  */
+};
+
+typedef struct Watch WATCH;            /* Alternate for watch struct.        */
+
+
+
 /*---------------------------------------------------------------------------*/
 /* Event structure...                                                        */
 /*---------------------------------------------------------------------------*/
@@ -134,17 +265,95 @@ typedef struct Event EVENT;            /* Alternate for event structure.     */
 /* Message structure...                                                      */
 /*---------------------------------------------------------------------------*/
 
+#define  MSG_HDR      8                /* Tag before copied data, keeping    */
+                                       /* the data aligned.                  */
+
 struct Message {
    LINK           Link;                /* Link of messages.                  */
    BYTE          *Data;                /* Pointer to message.                */
    USHORT         Length;              /* Length of message.                 */
    HANDLE         Pid;                 /* Pid if process is waiting.         */
+   HANDLE         Call;                /* Pid of caller waiting for a reply. */
+   BYTE           Inline[MSG_HDR + OS_MSGINLINE];  /* Tag, then short data.  */
 };
 
 typedef struct Message MESSAGE;        /* Alternate for message struct.      */
 
 
 
+/*---------------------------------------------------------------------------*/
+/* Mailbox ring of a process made by OsCreateMbox(). Senders take slots in   */
+/* turn by compare-and-swap on Tail; a slot's Seq says whether it is free    */
+/* for the position (Seq == position) or filled (Seq == position + 1)...     */
+/*---------------------------------------------------------------------------*/
+
+typedef struct MsgSlot {
+   ULONG          Seq;                 /* Position it is free for, +1 full.  */
+   struct MsgBox *Box;                 /* Mailbox it is in.                  */
+   BYTE          *Data;                /* Pointer to message.                */
+   USHORT         Length;              /* Length of message.                 */
+   HANDLE         Pid;                 /* Sender waiting for it, if any.     */
+   HANDLE         Call;                /* Caller waiting for a reply, if any.*/
+   BYTE           Inline[MSG_HDR + OS_MSGINLINE];  /* Tag, then short data.  */
+} MSGSLOT;
+
+#define  MBOX_COPY     0               /* OsMboxSend(): copy into the slot,  */
+#define  MBOX_HEAP     1               /* data is a heap copy (MSG_COPY_ID), */
+#define  MBOX_BUFF     2               /* or a pool buffer to give away.     */
+#define  MBOX_CALL     0x10            /* Or'ed in: sender waits for reply.  */
+
+#define  BOX_DEAD      0x80000000L     /* Held: mailbox reaped.              */
+
+typedef struct MsgBox {
+   ULONG          Tail;                /* Next position senders fill.        */
+   ULONG          Head;                /* Next position receiver takes.      */
+   ULONG          Mask;                /* Slots - 1, slots a power of 2.     */
+   ULONG          Held;                /* Inline slots receiver has, and     */
+                                       /* BOX_DEAD once it is reaped.        */
+   ULONG          Full;                /* Senders waiting for room,          */
+   HANDLE         Room;                /* on this semaphore.                 */
+   FASTSEM        Avail;               /* Messages filled, receiver waits.   */
+   ULONG          Watch;               /* Receiver is in OsWaitAny/All().    */
+   MSGSLOT        Slot[1];             /* Slots, Mask + 1 of them.           */
+} MSGBOX;
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Message port. Receivers wait on a PORTQ, of the port itself, or of their  */
+/* membership for a broadcast port, in order of arrival...                   */
+/*---------------------------------------------------------------------------*/
+
+typedef struct PortQueue {
+   ANCHOR         Msgs;                /* MESSAGEs no one took yet.          */
+   ANCHOR         Waiters;             /* PORTWAITs of waiting receivers.    */
+} PORTQ;
+
+typedef struct PortMember {            /* Process that joined a port.        */
+   LINK           Link;                /* Chain of members of port.          */
+   HANDLE         Pid;                 /* Member process.                    */
+   PORTQ          Q;                   /* Its copies of broadcasts.          */
+} PORTMEMBER;
+
+typedef struct Port {
+   LINK           Link;                /* Chain of all ports, PortNames.     */
+   HANDLE         Handle;              /* Port handle.                       */
+   char           Name[PORTNMLEN];     /* Port name, "" if none.             */
+   int            Options;             /* OS_PORT_BALANCE or _BROADCAST.     */
+   PORTQ          Q;                   /* Messages and receivers, balanced.  */
+   ANCHOR         Members;             /* PORTMEMBERs, broadcast.            */
+} PORT;
+
+typedef struct PortWait {              /* Receiver's wait, on its stack.     */
+   LINK           Link;                /* Chain of waiters on queue.         */
+   ANCHOR        *On;                  /* Queue's chain, NULL when off it.   */
+   struct Process *Proc;               /* Process waiting.                   */
+   MESSAGE       *Msg;                 /* Message handed to it.              */
+   int            Rc;                  /* SYSOK, or SYSERR if port deleted.  */
+} PORTWAIT;
+
+
+
 /*---------------------------------------------------------------------------*/
 /* Device structure for opened device instance...                            */
 /*---------------------------------------------------------------------------*/
@@ -154,6 +363,8 @@ struct Device {
    int      Type;                      /* Device type number.                */
    int      Driver;                    /* Device driver number.              */
    void    *Misc;                      /* Miscellanious data (or pointer to).*/
+   long     Timeout;                   /* Read timeout, hundredths, or -1.   */
+   ANCHOR   Watchers;                  /* Watches of OsWaitAny/All().        */
 };
 
 typedef struct Device DEVICE;
@@ -192,6 +403,7 @@ struct DeviceDriver {
    int    (*Write)(   DEVICE *Device, char *Buffer, int Length);
    int    (*Control)( DEVICE *Device, int Function, long Value);
    int    (*Seek)(    DEVICE *Device, long Position);
+   int    (*Poll)(    DEVICE *Device); /* > 0 if Read() would not wait.      */
 };
 
 typedef struct DeviceDriver DEVICEDRIVER;
@@ -200,19 +412,85 @@ extern struct DeviceDriver DeviceDriverTable[];
 
 
 
+#if defined(OS_SMP)
+/*---------------------------------------------------------------------------*/
+/* Per CPU state for OS_SMP builds. Each CPU is a host thread running jOS    */
+/* processes from its own ready queue. The kernel is serialized by one lock  */
+/* taken by OsDisable(), so everything else stays global...                  */
+/*---------------------------------------------------------------------------*/
+
+struct Cpu {
+   struct HostInt  Int;                /* Emulated interrupt flag.           */
+   int             Id;                 /* CPU number.                        */
+   HANDLE          Curr;               /* Process running on this CPU.       */
+   struct Process *Proc;               /* Its process structure.             */
+   int             Prio;               /* Its priority (0 when idle).        */
+   int             Disable;            /* OsDisable nest count.              */
+   int             Slice;              /* Ticks left in time slice.          */
+   int             Preempt;            /* Reschedule at end of isr.          */
+   PRIOQ           Ready;              /* Ready processes by priority.       */
+};
+
+typedef struct Cpu CPU;
+
+extern CPU        CpuTable[NCPU];      /* Per CPU state.                     */
+extern int        NumCpu;              /* Number of CPUs running.            */
+extern volatile int KernelLock;        /* Held while any CPU is disabled.    */
+
+CPU      *OsCpu(        void );        /* State of CPU we are running on.    */
+
+#define   CurrPid       (OsCpu()->Curr)
+#define   CurrProc      (OsCpu()->Proc)
+#define   DisableCount  (OsCpu()->Disable)
+#define   SliceTicks    (OsCpu()->Slice)
+#define   Resched       (OsCpu()->Preempt)
+#define   ReadyQueue    (OsCpu()->Ready)
+
+#define   ReadyQ(p)     (&CpuTable[(p)->Cpu].Ready)   /* Queue holding proc. */
+#define   OsRunning(p)  (CpuTable[(p)->Cpu].Curr == (p)->Pid)
+
+#else
+
+#define   ReadyQ(p)     (&ReadyQueue)
+#define   OsRunning(p)  ((p)->Pid == CurrPid)
+
+#endif
+
+
+
 /*---------------------------------------------------------------------------*/
 /* external definitions in CONFIG.C...                                       */
 /*---------------------------------------------------------------------------*/
 
-extern ANCHOR     ReadyAnchor;         /* Anchor of ready processes.         */
 extern ANCHOR     KilledAnchor;        /* Anchor of killed processes.        */
 extern void      *ProcessAnchor;       /* Handle anchor for process handles. */
 extern int        NumProc;             /* Currently active processes.        */
+
+#if !defined(OS_SMP)
+extern PRIOQ      ReadyQueue;          /* Ready processes by priority.       */
 extern HANDLE     CurrPid;             /* Currently executing process.       */
+extern PROCESS   *CurrProc;            /* Its process structure.             */
 
 extern int        DisableCount;        /* Count of OsDisable nestings.       */
 
+extern int        SliceTicks;          /* Ticks left in current time slice.  */
+extern int        Resched;             /* Reschedule at end of isr.          */
+#endif
+
+extern int        Quantum[NPRIO];      /* Time slice in ticks per priority.  */
+
+extern ANCHOR     ProcPool[NPOOL];     /* Killed processes kept for reuse.   */
+extern int        PoolCount[NPOOL];    /* Processes in each pool.            */
+extern int        PoolMax[NPOOL];      /* Most to keep in each pool.         */
+
 extern void      *SemaphoreAnchor;     /* Handle anchor for sem handles.     */
+extern void      *EventGroupAnchor;    /* Handle anchor for event groups.    */
+extern void      *PortAnchor;          /* Handle anchor for message ports.   */
+extern ANCHOR     PortNames;           /* All ports, to find them by name.   */
+
+extern ANCHOR     LockHash[NLOCKHASH]; /* Turnstiles of locks waited for.    */
+extern int        LockInherit;         /* Priority inheritance on for locks. */
+extern int        LockSpin;            /* Spins on a running owner (SMP).    */
 
 extern ANCHOR     EventAnchor;         /* Anchor of sleep events.            */
 extern ULONG      Seconds;             /* Date in seconds.                   */
@@ -230,19 +508,67 @@ void      OsSwitch(     BYTE **Stack1, BYTE **Stack2); /* Switch context.    */
 int       OsSleepInit(  void );        /* Initialize Sleep functions.        */
 int       OsSleepTerm(  void );        /* Terminate Sleep functions.         */
 int       OsSleepCheck( void );        /* Check for expired sleepers.        */
+long      OsSleepNext(  void );        /* Millisecs until next sleeper, or -1*/
 int       OsReady(      HANDLE  Pid);  /* Make process ready to run.         */
 int       OsDevInit(    void );        /* Initialize device functions.       */
 int       OsDevTerm(    void );        /* Terminate device functions.        */
 void     *OsHandFind(   void *A, HANDLE  Nbr);    /* Find handle, rtn resrce.*/
+void      OsLockKill(   PROCESS *p);   /* Clean up locks of killed process.  */
+void      OsLockCancel( PROCESS *p);   /* Take process off lock it waits for.*/
+void      OsSemCancel(  PROCESS *p);   /* Take process off semaphore.        */
+int       OsTimerStart( PROCESS *p, long Hundreds);  /* Time out a wait.     */
+int       OsTimerStop(  PROCESS *p);   /* SYSTIMEOUT if it timed out.        */
+int       OsSuspendTimeout( long Hundreds);  /* Suspend self a while.        */
+void      OsWatchWake(  ANCHOR *Watchers);  /* Ready processes watching.     */
+void      OsWatchCancel( PROCESS *p);  /* Take down watches of process.      */
+void      OsDevReady(   DEVICE *Device);    /* Device may be ready, called   */
+                                            /* disabled by drivers.          */
+void      OsEventCancel( PROCESS *p);  /* Take process off its event group.  */
+void      OsMsgDrop(    MESSAGE *Msg); /* Free message never received.       */
+int       OsMsgReady(   PROCESS *p);   /* True if it has a message.          */
+MESSAGE  *OsMsgMake(    void *Data, int Length);  /* Copy into a message.    */
+void      OsMsgDone(    MESSAGE *Msg); /* Free message once received.        */
+void      OsPortCancel( PROCESS *p);   /* Take process off port it waits on. */
+void      OsMsgCallKill( PROCESS *p);  /* End calls of a killed process.     */
+int       OsHandoff(    PROCESS *p);   /* Switch straight to a waiting proc. */
+MSGBOX   *OsMboxCreate( int Slots );   /* Make a mailbox ring.               */
+int       OsMboxSend(   PROCESS *p, void *Data, int Length, int How,
+                        long Hundreds);     /* Send to a mailbox ring.       */
+int       OsMboxRecv(   MSGBOX *Box, void **Data, int *Length, int Max,
+                        long Hundreds);     /* Receive from a ring.          */
+int       OsMboxFree(   void *Data);   /* Free data received inline.         */
+int       OsMboxReady(  MSGBOX *Box);  /* True if a message is filled.       */
+void      OsMboxWatch(  MSGBOX *Box, int On);  /* OsWaitAny/All() on it.     */
+void      OsMboxKill(   MSGBOX *Box);  /* Its process is killed.             */
+void      OsMboxDelete( MSGBOX *Box);  /* Its process is reaped, free it.    */
+int       OsBuffGive(   void *Buffer, HANDLE Pid, int Length);  /* Pass on   */
+                                            /* a pool buffer, no copy.       */
+
+#if defined(OS_SMP)
+void      OsKernelLock(   void );      /* Take kernel lock.                  */
+void      OsKernelUnlock( void );      /* Release kernel lock.               */
+void      OsSmpCpu(       int Cpu);    /* Run a CPU, called by its thread.   */
+void      OsSmpKick(      int Cpu);    /* Make a CPU reschedule.             */
+void      OsSmpReady(     PROCESS *p); /* Get a CPU to run a readied proc.   */
+void      OsSmpSteal(     void );      /* Take ready work from other CPUs.   */
+void      OsSmpIdle(      void );      /* Let go of kernel, wait for work.   */
+void      OsSmpPending(   void );      /* Kill or suspend asked by other CPU.*/
+#endif
 
 
 /*---------------------------------------------------------------------------*/
-/* Definitions for interrupt service routines...                             */
+/* Definitions for interrupt service routines. If the isr interrupted an     */
+/* enabled process and asked for a reschedule, preempt it on the way out...  */
 /*---------------------------------------------------------------------------*/
 
+#if defined(OS_SMP)
+#define   OsIntEnter()     OsDisable()
+#define   OsIntExit()      ((DisableCount == 1 && Resched ? OsSched() : 0), \
+                            OsEnable())
+#else
 #define   OsIntEnter()     (DisableCount++)
-#define   OsIntExit()      (DisableCount--)
+#define   OsIntExit()      (--DisableCount == 0 && Resched ? OsSched() : 0)
+#endif
 
 
 
-
\ No newline at end of file
@@ -12,9 +12,36 @@
 /*                                                                           */
 /*       Description:  This module contains:                                 */
 /*                                                                           */
-/*                     OsLock()    - Lock a resource.                        */
-/*                     OsUnlock()  - Unlock a resource.                      */
+/*                     OsLock()     - Lock a resource.                       */
+/*                     OsLockTimeout() - Lock, waiting a while at most.      */
+/*                     OsUnlock()   - Unlock a resource.                     */
+/*                     OsLockKill() - Clean up locks of a killed process.    */
+/*                     OsLockCancel() - Take a waiter off its lock.          */
+/*                     OsLockOrder() - Set the order waiters get the lock.   */
 /*                                                                           */
+/*                     The lock word holds the Pid of its owner, or 0, and   */
+/*                     the LOCK_PRIO bit if OsLockOrder() set OS_ORDER_PRIO  */
+/*                     (a handle never has that bit set), so the order goes  */
+/*                     away with the lock word itself. When a process has to */
+/*                     wait, a turnstile is hung off the lock (found by      */
+/*                     hashing its address) to queue the waiters, and is     */
+/*                     chained to the owner's Held list. Unlock hands the    */
+/*                     lock to the first waiter: the first to come, or the   */
+/*                     most urgent if OsLockOrder() set OS_ORDER_PRIO for    */
+/*                     the lock.                                             */
+/*                                                                           */
+/*                     Priority inheritance: an owner runs at the priority   */
+/*                     of its most urgent waiter, following the chain when   */
+/*                     the owner itself waits for another lock, and drops    */
+/*                     back when it unlocks. LockInherit turns this off.     */
+/*                                                                           */
+/*                     Adaptive (OS_SMP): an owner running on another CPU    */
+/*                     will likely unlock soon, so a process that finds the  */
+/*                     lock taken first spins, up to LockSpin times, while   */
+/*                     the owner runs, and takes it if it comes free. Only   */
+/*                     then does it wait on the turnstile. The lock word is  */
+/*                     taken with a compare-and-swap so spinners outside     */
+/*                     the kernel and OsLock() inside it can't both win.     */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
@@ -23,8 +50,25 @@
 /*---------------------------------------------------------------------------*/
 
 #include "oskernel.h"
+#include "osatomic.h"
+
+
+#define  LockBucket(l)  (((ULONG) (l) >> 2) % NLOCKHASH)
+#define  LockHashOf(l)  (&LockHash[LockBucket(l)])
+
+#define  LOCK_PRIO      (~((HANDLE) -1 >> 1))   /* Lock word: waiters go by  */
+                                                /* priority.                 */
+#define  LockOwner(w)   ((w) & ~LOCK_PRIO)      /* Pid in a lock word.       */
 
 
+static TURNSTILE *LockFind(   HANDLE *Lock);
+static void       LockDrop(   TURNSTILE *Ts);
+static PROCESS   *LockPass(   TURNSTILE *Ts);
+static void       LockUpdate( PROCESS *pptr);
+static void       LockPrio(   PROCESS *pptr, int Prio);
+#if defined(OS_SMP)
+static int        LockSpinOn( HANDLE *Lock);
+#endif
 
 
 
@@ -33,39 +77,93 @@
 /*---------------------------------------------------------------------------*/
 
 int   OsLock(HANDLE *Lock)
+{
+   return OsLockTimeout(Lock, -1L);    /* Wait as long as it takes.          */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsLockTimeout() -- Lock a resource, but give up after Hundreds of a       */
+/* second (0 to not wait, -1 to wait forever). Returns SYSTIMEOUT if it      */
+/* gave up...                                                                */
+/*---------------------------------------------------------------------------*/
+
+int   OsLockTimeout(HANDLE *Lock, long Hundreds)
 {
    PROCESS   *Process;
-   PROCESS   *Process2;
+   PROCESS   *Owner;
+   TURNSTILE *Ts;
+   HANDLE     Held;
+   int        rc;
 
-   OsDisable();                        /* Disable interrupts.                */
+#if defined(OS_SMP)
+   if (LockSpin && Hundreds != 0 && LockSpinOn(Lock))
+      return (SYSOK);                  /* Owner let go while we spun.        */
+#endif
 
-   Process = (PROCESS *) OsHandProtect(ProcessAnchor, CurrPid);
+   OsDisable();                        /* Disable interrupts.                */
 
-   if (*Lock == 0) {
-      *Lock = Process->Pid;
-      OsHandUnprotect(ProcessAnchor, CurrPid);
+   Held = OsAtomicLoad(Lock) & LOCK_PRIO;
+   if (OsAtomicCas(Lock, &Held, CurrPid | Held)) {   /* Free, take it.       */
       OsEnable();
       return (SYSOK);
    }
 
-   if ((Process2 = (PROCESS *) OsHandProtect(ProcessAnchor, *Lock)) == NULL)  {
-      OsHandUnprotect(ProcessAnchor, CurrPid);
+   if ((Held = LockOwner(Held)) == CurrPid ||   /* Would wait for ourself,   */
+       (Owner = (PROCESS *) OsHandFind(ProcessAnchor, Held)) == NULL)  {
+      OsEnable();                      /* owner is gone?                     */
+      return (SYSERR);
+   }
+
+   if (Hundreds == 0) {                /* Would have to wait, but can't.     */
+      OsEnable();
+      return (SYSTIMEOUT);
+   }
+
+   Process = CurrProc;
+
+   if (OsTimerStart(Process, Hundreds) != SYSOK) {  /* Give up when due.     */
       OsEnable();
       return (SYSERR);
    }
 
-   Process->Lock  = 0;                 /* Just to make sure.                 */
-   Process2->Lock = CurrPid;           /* Chain.                             */
+   /*------------------------------------------------------------------------*/
+   /* First waiter puts a turnstile on the lock...                           */
+   /*------------------------------------------------------------------------*/
+
+   if ((Ts = LockFind(Lock)) == NULL) {
+      if ((Ts = (TURNSTILE *) OsAlloc(sizeof(TURNSTILE))) == NULL) {
+         OsTimerStop(Process);
+         OsEnable();
+         return (SYSERR);
+      }
+      if ((*Lock & LOCK_PRIO) &&       /* Waiters go by priority?            */
+          (Ts->Waiters.Prio = (PRIOQ *) OsAlloc(sizeof(PRIOQ))) == NULL) {
+         OsFree(Ts);
+         OsTimerStop(Process);
+         OsEnable();
+         return (SYSERR);
+      }
+      ChainInit(&Ts->Link, Ts);
+      ChainInit(&Ts->Held, Ts);
+      Ts->Lock = Lock;
+      ChainQueue(LockHashOf(Lock), &Ts->Link);
+      ChainQueue(&Owner->Held,     &Ts->Held);
+   }
 
-   OsHandUnprotect(ProcessAnchor, *Lock);     /* Unlock processes.           */
-   OsHandUnprotect(ProcessAnchor, CurrPid);
+   PrioUnchain(ReadyQ(Process), &Process->Link, Process->Prio);
+   Process->State = PRLOCK;            /* Wait our turn on the turnstile.    */
+   Process->Lock  = Lock;
+   WaitChain(&Ts->Waiters, &Process->Link, Process->Prio);
 
-   *Lock = CurrPid;                    /* We are last process to wait.       */
+   LockUpdate(Owner);                  /* Lend owner our priority.           */
 
-   OsSuspend(CurrPid);                 /* Make us wait until our turn.       */
+   OsSched();                          /* Back when lock is handed to us.    */
+   rc = OsTimerStop(Process);
 
    OsEnable();                         /* Enable interrupts.                 */
-   return SYSOK;                       /* Return                             */
+   return rc;                          /* Return SYSOK or SYSTIMEOUT.        */
 }
 
 
@@ -77,28 +175,289 @@ int   OsLock(HANDLE *Lock)
 int   OsUnlock(HANDLE *Lock)
 {
    PROCESS   *Process;
+   PROCESS   *Next;
+   TURNSTILE *Ts;
+   int        Prio;
 
    OsDisable();                        /* Disable interrupts.                */
 
-   Process = (PROCESS *) OsHandProtect(ProcessAnchor, CurrPid);
+   if (LockOwner(*Lock) != CurrPid) {  /* Are we the one that locked it?     */
+      OsEnable();
+      return SYSERR;                   /* No, error then!                    */
+   }
 
-   if (Process->Lock == 0) {           /* If no waiters on lock...           */
+   if ((Ts = LockFind(Lock)) == NULL) {   /* If no waiters on lock...        */
+      OsAtomicStore(Lock, *Lock & LOCK_PRIO);   /* Clear, no one waited.     */
+      OsEnable();
+      return SYSOK;
+   }
 
-      if (*Lock != Process->Pid) {     /* Are we the one that locked it?     */
-         OsHandUnprotect(ProcessAnchor, CurrPid);
-         OsEnable();
-         return SYSERR;                /* No, error then!                    */
-      }
+   Process = CurrProc;
+   Prio    = Process->Prio;
 
-      *Lock = 0;                       /* Clear, no one was waiting.         */
+   Unchain(&Process->Held, &Ts->Held);
+   Next = LockPass(Ts);                /* Hand lock to next waiter.          */
+   LockUpdate(Process);                /* Give back any borrowed priority.   */
 
-   } else {
+   if (Process->Prio < Prio ||         /* Let more urgent processes run.     */
+       Process->Prio < Next->Prio)
+      OsSched();
 
-      OsResume(Process->Lock);         /* Resume next waiter.                */
-      Process->Lock = 0;               /* Clear chain pointer.               */
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return, no errors.                 */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsLockKill() -- Called by OsKill(). Take a process off the lock it waits  */
+/* for, and hand locks it holds that others wait for to the next waiter...   */
+/*---------------------------------------------------------------------------*/
+
+void  OsLockKill( PROCESS *pptr )
+{
+   TURNSTILE *Ts;
+
+   if (pptr->State == PRLOCK)
+      OsLockCancel(pptr);
+
+   while ((Ts = ChainPop(&pptr->Held)) != NULL)
+      LockPass(Ts);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsLockCancel() -- Called disabled, for a process waiting for a lock that  */
+/* is killed or timed out. Take it off the turnstile, and take back the      */
+/* priority it lent the owner...                                             */
+/*---------------------------------------------------------------------------*/
+
+void  OsLockCancel( PROCESS *pptr )
+{
+   TURNSTILE *Ts;
+   PROCESS   *Owner;
+
+   if ((Ts = LockFind(pptr->Lock)) == NULL)
+      return;
+
+   WaitUnchain(&Ts->Waiters, &pptr->Link, pptr->Prio);
+   pptr->Lock = NULL;
+   Owner = (PROCESS *) OsHandFind(ProcessAnchor, LockOwner(*Ts->Lock));
+   if (WaitEmpty(&Ts->Waiters)) {      /* Last waiter?                       */
+      if (Owner)
+         Unchain(&Owner->Held, &Ts->Held);
+      LockDrop(Ts);
+   }
+   if (Owner)
+      LockUpdate(Owner);               /* May no longer need our priority.   */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsLockOrder() -- Set the order waiters get a lock: OS_ORDER_FIFO (the     */
+/* default) or OS_ORDER_PRIO. Only while no one waits. The order is kept in  */
+/* the lock word, so a lock word set to zero is FIFO again...                */
+/*---------------------------------------------------------------------------*/
+
+int   OsLockOrder(HANDLE *Lock, int Order)
+{
+   HANDLE     Word;
+
+   if (Order != OS_ORDER_FIFO && Order != OS_ORDER_PRIO)
+      return SYSERR;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if (LockFind(Lock) != NULL) {       /* Would have to reorder waiters.     */
+      OsEnable();
+      return SYSERR;
    }
 
+   Word = OsAtomicLoad(Lock);          /* A spinner may take it meanwhile.   */
+   while (!OsAtomicCas(Lock, &Word, Order == OS_ORDER_PRIO ?
+                       Word | LOCK_PRIO : Word & ~LOCK_PRIO))
+      ;
+
    OsEnable();                         /* Enable interrupts.                 */
-   return SYSOK;                       /* Return, no errors.                 */
+   return SYSOK;
+}
+
+
+
+#if defined(OS_SMP)
+/*---------------------------------------------------------------------------*/
+/* LockSpinOn() -- Spin while the owner of a lock runs on another CPU, and   */
+/* take the lock if it comes free. False if it didn't in LockSpin looks.     */
+/* We hold neither the kernel nor the owner's handle, so the owner may be    */
+/* killed and freed meanwhile: look for its Pid on the CPUs, never at its    */
+/* PROCESS...                                                                */
+/*---------------------------------------------------------------------------*/
+
+static int LockSpinOn( HANDLE *Lock )
+{
+   HANDLE     Held;
+   int        i, c;
+
+   for (i = 0; i < LockSpin; i++) {
+      if (LockOwner(Held = OsAtomicLoad(Lock)) == 0) {
+         if (OsAtomicCas(Lock, &Held, CurrPid | Held))
+            return True;
+         continue;                     /* Someone beat us to it.             */
+      }
+
+      if ((Held = LockOwner(Held)) == CurrPid)   /* Ours, the slow path      */
+         return False;                           /* will say so.             */
+
+      for (c = 0; c < NumCpu; c++)     /* Owner running?                     */
+         if (OsAtomicLoad(&CpuTable[c].Curr) == Held)
+            break;
+      if (c == NumCpu)                 /* No, or gone: wait for it instead.  */
+         return False;
+
+      OsSpinPause();
+   }
+
+   return False;
+}
+#endif
+
+
+
+/*---------------------------------------------------------------------------*/
+/* LockFind() -- Find turnstile of a lock, NULL if no one waits for it...    */
+/*---------------------------------------------------------------------------*/
+
+static TURNSTILE *LockFind( HANDLE *Lock )
+{
+   TURNSTILE *Ts;
+
+   for (Ts = ChainFirst(LockHashOf(Lock)); Ts; Ts = ChainNext(&Ts->Link))
+      if (Ts->Lock == Lock)
+         return Ts;
+
+   return NULL;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* LockDrop() -- Free a turnstile no one waits on any more...                */
+/*---------------------------------------------------------------------------*/
+
+static void LockDrop( TURNSTILE *Ts )
+{
+   Unchain(LockHashOf(Ts->Lock), &Ts->Link);
+   if (Ts->Waiters.Prio)
+      OsFree(Ts->Waiters.Prio);
+   OsFree(Ts);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* LockPass() -- Make first waiter on a turnstile the owner of its lock and  */
+/* ready it. The turnstile goes with it, or is freed if no one else waits... */
+/*---------------------------------------------------------------------------*/
+
+static PROCESS *LockPass( TURNSTILE *Ts )
+{
+   PROCESS   *Next;
+
+   Next       = (PROCESS *) WaitPop(&Ts->Waiters);
+   Next->Lock = NULL;
+   *Ts->Lock  = Next->Pid | (*Ts->Lock & LOCK_PRIO);   /* New owner.         */
+
+   OsReady(Next->Pid);
+
+   if (!WaitEmpty(&Ts->Waiters)) {
+      ChainQueue(&Next->Held, &Ts->Held);
+      LockUpdate(Next);                /* Inherits from those still waiting. */
+   } else
+      LockDrop(Ts);
+
+   return Next;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* LockUpdate() -- Set priority of a process to the higher of its own and    */
+/* that of everyone waiting for locks it holds. If it changed and the        */
+/* process waits for a lock too, pass the change on to that lock's owner...  */
+/*---------------------------------------------------------------------------*/
+
+static void LockUpdate( PROCESS *pptr )
+{
+   TURNSTILE *Ts;
+   PROCESS   *Waiter;
+   int        Prio;
+
+   while (pptr) {
+      Prio = pptr->BasePrio;
+
+      if (LockInherit)
+         for (Ts = ChainFirst(&pptr->Held); Ts; Ts = ChainNext(&Ts->Held)) {
+            if (Ts->Waiters.Prio) {    /* First is the most urgent.          */
+               Waiter = WaitFirst(&Ts->Waiters);
+               if (Waiter->Prio > Prio)
+                  Prio = Waiter->Prio;
+            } else
+               for (Waiter = ChainFirst(&Ts->Waiters.Fifo); Waiter;
+                    Waiter = ChainNext(&Waiter->Link))
+                  if (Waiter->Prio > Prio)
+                     Prio = Waiter->Prio;
+         }
+
+      if (Prio == pptr->Prio)          /* No change, nothing to pass on.     */
+         break;
+
+      LockPrio(pptr, Prio);
+
+      if (pptr->State != PRLOCK)
+         break;
+
+      pptr = (PROCESS *) OsHandFind(ProcessAnchor, LockOwner(*pptr->Lock));
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* LockPrio() -- Change priority of a process, moving it to its new level if */
+/* it is on a ready queue...                                                 */
+/*---------------------------------------------------------------------------*/
+
+static void LockPrio( PROCESS *pptr, int Prio )
+{
+   SEMAPHORE *S;
+   TURNSTILE *Ts;
+   WAITQ     *Q = NULL;
+
+   if (pptr->State != PRREADY && pptr->State != PRCURR) {
+      if (pptr->State == PRWAIT &&     /* Waiting in priority order?         */
+          (S = (SEMAPHORE *) OsHandFind(SemaphoreAnchor, pptr->Sem)) != NULL)
+         Q = &S->WaitList;
+      else if (pptr->State == PRLOCK && (Ts = LockFind(pptr->Lock)) != NULL)
+         Q = &Ts->Waiters;
+
+      if (Q && Q->Prio) {              /* Move to its new level.             */
+         WaitUnchain(Q, &pptr->Link, pptr->Prio);
+         WaitChain(  Q, &pptr->Link, Prio);
+      }
+      pptr->Prio = Prio;
+      return;
+   }
+
+   PrioUnchain(ReadyQ(pptr), &pptr->Link, pptr->Prio);
+   pptr->Prio = Prio;
+   PrioChain(  ReadyQ(pptr), &pptr->Link, pptr->Prio);
+
+#if defined(OS_SMP)
+   if (pptr->State == PRCURR)
+      CpuTable[pptr->Cpu].Prio = Prio; /* Others look at this to kick it.    */
+   else
+      OsSmpReady(pptr);                /* Get a CPU to run it sooner.        */
+#endif
 }
-
\ No newline at end of file
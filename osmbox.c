@@ -0,0 +1,557 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSMBOX.C                                              */
+/*                                                                           */
+/*             Title:  Lock-free mailbox rings.                              */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsMboxCreate() - Make a mailbox ring.                 */
+/*                     OsMboxSend()   - Put a message in a ring.             */
+/*                     OsMboxRecv()   - Take messages out of a ring.         */
+/*                     OsMboxFree()   - Give back a slot held by receiver.   */
+/*                     OsMboxReady()  - See if a message is waiting.         */
+/*                     OsMboxWatch()  - Receiver is in OsWaitAny/All().      */
+/*                     OsMboxKill()   - Ready senders of a killed process.   */
+/*                     OsMboxDelete() - Free the ring of a reaped process.   */
+/*                                                                           */
+/*                     A process made by OsCreateMbox() gets its messages    */
+/*                     in a ring of slots rather than on its Msgs chain.     */
+/*                     Many senders, one receiver: a sender takes the slot   */
+/*                     at Tail by compare-and-swap, fills it and marks it    */
+/*                     filled, with interrupts off on its own CPU only so    */
+/*                     the receiver never waits long on a slot being         */
+/*                     filled. Then it counts the message in Avail, a fast   */
+/*                     semaphore, so it enters the kernel only when the      */
+/*                     receiver waits there. Short messages are copied into  */
+/*                     the slot, which the receiver holds until OsMsgFree(). */
+/*                                                                           */
+/*                     A sender finding the ring full counts itself in Full  */
+/*                     and waits on Room; giving back a slot posts Room if   */
+/*                     Full says anyone waits. Each looks after writing its  */
+/*                     own word, with a fence between, so one of them always */
+/*                     sees the other. A receiver in OsWaitAny/All() sets    */
+/*                     Watch the same way for senders to ready it.           */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+#include "osatomic.h"
+
+
+#define  MSG_RING_ID   "MSGR"          /* Tag before data copied to a slot.  */
+
+#define  SlotInline(s) ((s)->Data == (s)->Inline + MSG_HDR)
+
+
+static MSGSLOT *BoxReserve( MSGBOX *Box );
+static int      BoxRoom(    PROCESS *P, MSGBOX *Box );
+static void     BoxRelease( MSGBOX *Box, MSGSLOT *Slot );
+static void     BoxWake(    MSGBOX *Box, int Freed );
+static int      BoxCount(   MSGBOX *Box, long Hundreds );
+static int      BoxMore(    MSGBOX *Box, int Max );
+static void     BoxPut(     MSGBOX *Box );
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxCreate() -- Make a mailbox ring of Slots slots, rounded up to a     */
+/* power of 2. NULL if out of memory...                                      */
+/*---------------------------------------------------------------------------*/
+
+MSGBOX *OsMboxCreate( int Slots )
+{
+   MSGBOX   *Box;
+   ULONG     n, i;
+
+   for (n = 2; n < (ULONG) Slots; n <<= 1)
+      ;
+
+   if ((Box = OsAlloc(sizeof(MSGBOX) + (n - 1) * sizeof(MSGSLOT))) == NULL)
+      return NULL;
+
+   if ((Box->Room = OsSemCreate(0)) == SYSERR) {
+      OsFree(Box);
+      return NULL;
+   }
+   if (OsFastSemCreate(&Box->Avail, 0) == SYSERR) {
+      OsSemDelete(Box->Room);
+      OsFree(Box);
+      return NULL;
+   }
+
+   Box->Mask = n - 1;
+   for (i = 0; i < n; i++) {
+      Box->Slot[i].Seq = i;            /* Free for the first time round.     */
+      Box->Slot[i].Box = Box;
+   }
+
+   return Box;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxSend() -- Put a message in the ring of process P, which the caller  */
+/* protects. How says what Data is (MBOX_COPY, _HEAP or _BUFF), with         */
+/* MBOX_CALL if the sender will wait for a reply. Waits for room if the ring */
+/* is full, and unless Hundreds is 0 waits that long at most (-1 forever)    */
+/* for it to be received, as OsMsgSendTimeout(). On SYSERR a heap copy is    */
+/* freed and a buffer is still the caller's; on SYSTIMEOUT the message stays */
+/* in the ring...                                                            */
+/*---------------------------------------------------------------------------*/
+
+int   OsMboxSend( PROCESS *P, void *Data, int Length, int How, long Hundreds )
+{
+   MSGBOX   *Box = P->Box;
+   MSGSLOT  *Slot;
+   PROCESS  *Sender;
+   HANDLE    Call = How & MBOX_CALL ? CurrPid : 0;
+   int       Wait = Hundreds != 0;
+   int       On;
+   int       rc = SYSOK;
+
+   How &= ~MBOX_CALL;
+
+   for (;;) {
+      if (P->State == PRKILL) {        /* No one will receive it.            */
+         if (How == MBOX_HEAP)
+            OsMsgFree(Data);
+         return SYSERR;
+      }
+
+      if (Wait) {                      /* Stay in the kernel until we wait,  */
+         OsDisable();                  /* so receiver can't ready us first.  */
+         if (OsTimerStart(CurrProc, Hundreds) != SYSOK) {
+            OsEnable();                /* No timer, so we can't wait.        */
+            if (How == MBOX_HEAP)
+               OsMsgFree(Data);
+            return SYSERR;
+         }
+      }
+      else
+         AtomicOff(On);
+
+      if ((Slot = BoxReserve(Box)) != NULL)
+         break;
+
+      if (Wait) {
+         OsTimerStop(CurrProc);        /* Only times the wait to be taken.   */
+         OsEnable();
+      }
+      else
+         AtomicOn(On);
+
+      if (BoxRoom(P, Box) != SYSOK) {  /* Full, wait for a slot to free up.  */
+         if (How == MBOX_HEAP)
+            OsMsgFree(Data);
+         return SYSERR;
+      }
+   }
+
+   /*------------------------------------------------------------------------*/
+   /* Fill the slot and mark it filled, this CPU can't switch meanwhile...   */
+   /*------------------------------------------------------------------------*/
+   if (How == MBOX_COPY) {
+      memcpy(Slot->Inline + MSG_HDR - 4, MSG_RING_ID, 4);
+      Slot->Data = Slot->Inline + MSG_HDR;
+      memcpy(Slot->Data, Data, Length);
+   }
+   else {
+      if (How == MBOX_BUFF)            /* Checked by caller, can't fail.     */
+         OsBuffGive(Data, P->Pid, Length);
+      Slot->Data = Data;
+   }
+   Slot->Length = Length;
+   Slot->Pid    = Wait ? CurrPid : 0;
+   Slot->Call   = Call;
+   OsAtomicStore(&Slot->Seq, Slot->Seq + 1);
+
+   if (!Wait)
+      AtomicOn(On);
+
+   OsFastPost(&Box->Avail);            /* Count it, ready a waiting receiver.*/
+
+   OsAtomicFence();
+   if (OsAtomicLoad(&Box->Watch)) {    /* Receiver in OsWaitAny/All()?       */
+      OsDisable();
+      if (P->State == PRMULTI && (P->Flags & PROCESS_WATCHMSG))
+         OsReady(P->Pid);
+      OsEnable();
+   }
+
+   if (Wait) {
+      if (P->State != PRKILL) {        /* Receiver readies us on taking it.  */
+         Sender = CurrProc;
+         Sender->Sending = &Slot->Pid; /* For a timeout to take it back.     */
+         PrioUnchain( ReadyQ(Sender), &Sender->Link, Sender->Prio);
+         Sender->State = PRSEND;
+         OsSched();
+      }
+      rc = OsTimerStop(CurrProc);      /* SYSTIMEOUT if not taken in time.   */
+      OsEnable();
+   }
+
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxRecv() -- Take up to Max messages from the ring of the current      */
+/* process, waiting Hundreds of a second at most (0 to not wait, -1 to wait  */
+/* forever) for the first. A call ends the batch, so OsMsgCaller() is the    */
+/* caller of the last. Returns how many, 0 if none came in time...           */
+/*---------------------------------------------------------------------------*/
+
+int   OsMboxRecv( MSGBOX *Box, void **Data, int *Length, int Max,
+                  long Hundreds )
+{
+   MSGSLOT  *Slot;
+   HANDLE    Pid;
+   int       n, i, Freed = 0, Woke = False;
+   int       rc;
+
+   if ((rc = BoxCount(Box, Hundreds)) != SYSOK)
+      return rc == SYSTIMEOUT ? 0 : rc;
+   n = 1 + BoxMore(Box, Max - 1);      /* And any more already counted.      */
+
+   for (i = 0; i < n; i++) {
+      Slot = &Box->Slot[Box->Head & Box->Mask];
+
+#if defined(OS_SMP)
+      while (OsAtomicLoad(&Slot->Seq) != Box->Head + 1)
+         OsSpinPause();                /* Its sender is just filling it.     */
+#endif
+
+      Box->Head++;
+      Data[i]   = Slot->Data;
+      Length[i] = Slot->Length;
+      CurrProc->Caller = Slot->Call;   /* Who to reply to, if a call.        */
+
+      if (Slot->Call && i < n - 1) {   /* Leave the rest for the next time.  */
+         OsAtomicAdd((ULONG *) &Box->Avail.Count, n - i - 1);
+         n = i + 1;
+      }
+
+      if (Slot->Pid) {                 /* Sender waits for us to take it,    */
+         if (!Woke) {                  /* unless its time ran out and its    */
+            OsDisable();               /* timer took it back meanwhile.      */
+            Woke = True;
+         }
+         if ((Pid = Slot->Pid) != 0) {
+            Slot->Pid = 0;
+            OsReady(Pid);
+         }
+      }
+
+      if (SlotInline(Slot))            /* Held until OsMsgFree().            */
+         OsAtomicAdd(&Box->Held, 1);
+      else {
+         OsAtomicStore(&Slot->Seq, Slot->Seq + Box->Mask);
+         Freed++;
+      }
+   }
+
+   BoxWake(Box, Freed);                /* One pass for senders out of room.  */
+
+   if (Woke)
+      OsEnable();
+
+   return n;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxFree() -- Give back the slot of data received inline. SYSERR if     */
+/* the data is not in a slot...                                              */
+/*---------------------------------------------------------------------------*/
+
+int   OsMboxFree( void *Data )
+{
+   BYTE     *Tag = (BYTE *) Data - 4;
+   MSGSLOT  *Slot;
+
+   if (memcmp(Tag, MSG_RING_ID, 4) != 0)
+      return SYSERR;
+
+   memset(Tag, 0, 4);                  /* Catch freeing it twice.            */
+   Slot = (MSGSLOT *) ((BYTE *) Data - MSG_HDR -
+                       (BYTE *) (((MSGSLOT *)(0))->Inline));
+
+   BoxRelease(Slot->Box, Slot);
+   BoxPut(Slot->Box);
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxReady() -- True if a message is in the ring...                      */
+/*---------------------------------------------------------------------------*/
+
+int   OsMboxReady( MSGBOX *Box )
+{
+   return (long) OsAtomicLoad((ULONG *) &Box->Avail.Count) > 0;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxWatch() -- Called disabled. Tell senders the receiver is, or is no  */
+/* longer, in OsWaitAny/All(). After turning it on the caller looks at the   */
+/* ring before it waits...                                                   */
+/*---------------------------------------------------------------------------*/
+
+void  OsMboxWatch( MSGBOX *Box, int On )
+{
+   OsAtomicStore(&Box->Watch, (ULONG) On);
+   OsAtomicFence();
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxKill() -- Called disabled. The process of a ring is killed: ready   */
+/* senders waiting for it to take their messages, or for room...             */
+/*---------------------------------------------------------------------------*/
+
+void  OsMboxKill( MSGBOX *Box )
+{
+   MSGSLOT  *Slot;
+   ULONG     Pos;
+
+   for (Pos = Box->Head; ; Pos++) {
+      Slot = &Box->Slot[Pos & Box->Mask];
+      if (OsAtomicLoad(&Slot->Seq) != Pos + 1)
+         break;
+      if (Slot->Pid) {
+         OsReady(Slot->Pid);
+         Slot->Pid = 0;
+      }
+   }
+
+   OsSemDelete(Box->Room);             /* Senders waiting for room find the  */
+   OsFastSemDelete(&Box->Avail);       /* process killed.                    */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMboxDelete() -- Called disabled, when no one protects the Pid of the    */
+/* process any more. Free messages still in the ring, and the ring once the  */
+/* slots the receiver held are given back...                                 */
+/*---------------------------------------------------------------------------*/
+
+void  OsMboxDelete( MSGBOX *Box )
+{
+   MSGSLOT  *Slot;
+
+   for (;;) {
+      Slot = &Box->Slot[Box->Head & Box->Mask];
+      if (OsAtomicLoad(&Slot->Seq) != Box->Head + 1)
+         break;
+      Box->Head++;
+      if (!SlotInline(Slot))
+         OsMsgFree(Slot->Data);
+   }
+
+   if (OsAtomicAdd(&Box->Held, BOX_DEAD) == BOX_DEAD)
+      OsFree(Box);                     /* Else last OsMsgFree() frees it.    */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxReserve() -- Called with interrupts off. Take the slot at Tail, or     */
+/* NULL if it is not free: the ring is full...                               */
+/*---------------------------------------------------------------------------*/
+
+static MSGSLOT *BoxReserve( MSGBOX *Box )
+{
+   MSGSLOT  *Slot;
+   ULONG     Pos, Seq;
+
+   Pos = OsAtomicLoad(&Box->Tail);
+   for (;;) {
+      Slot = &Box->Slot[Pos & Box->Mask];
+      Seq  = OsAtomicLoad(&Slot->Seq);
+      if (Seq == Pos) {
+         if (OsAtomicCas(&Box->Tail, &Pos, Pos + 1))
+            return Slot;               /* Else Pos is the new Tail.          */
+      }
+      else if ((long) (Seq - Pos) < 0)
+         return NULL;                  /* Not received, or still held.       */
+      else
+         Pos = OsAtomicLoad(&Box->Tail);    /* Another sender took it.       */
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxRoom() -- Wait until a slot is given back, unless one was since the    */
+/* caller found the ring full. SYSERR if the process is killed...            */
+/*---------------------------------------------------------------------------*/
+
+static int BoxRoom( PROCESS *P, MSGBOX *Box )
+{
+   MSGSLOT  *Slot;
+   ULONG     Full;
+   int       rc = SYSOK;
+
+   OsAtomicAdd(&Box->Full, 1);
+   OsAtomicFence();
+
+   Slot = &Box->Slot[OsAtomicLoad(&Box->Tail) & Box->Mask];
+   if ((long) (OsAtomicLoad(&Slot->Seq) - OsAtomicLoad(&Box->Tail)) < 0)
+      rc = OsWait(Box->Room);          /* Still full.                        */
+   else {
+      Full = OsAtomicLoad(&Box->Full); /* Room now, take back our count,     */
+      do {                             /* unless a post already has it.      */
+         if (Full == 0) {
+            rc = OsWait(Box->Room);
+            break;
+         }
+      } while (!OsAtomicCas(&Box->Full, &Full, Full - 1));
+   }
+
+   return rc == SYSOK && P->State != PRKILL ? SYSOK : SYSERR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxRelease() -- Free a slot the receiver is done with, for the sender one */
+/* time round the ring later, and post Room if a sender waits for it...      */
+/*---------------------------------------------------------------------------*/
+
+static void BoxRelease( MSGBOX *Box, MSGSLOT *Slot )
+{
+   OsAtomicStore(&Slot->Seq, Slot->Seq + Box->Mask);
+   BoxWake(Box, 1);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxWake() -- Freed slots were just given back: post Room once for each    */
+/* sender waiting for one, up to Freed...                                    */
+/*---------------------------------------------------------------------------*/
+
+static void BoxWake( MSGBOX *Box, int Freed )
+{
+   ULONG     Full;
+   int       Posts = 0;
+
+   if (Freed == 0)
+      return;
+
+   OsAtomicFence();
+
+   Full = OsAtomicLoad(&Box->Full);
+   while (Full > 0 && Posts < Freed)
+      if (OsAtomicCas(&Box->Full, &Full, Full - 1)) {
+         Posts++;
+         Full--;
+      }
+
+   if (Posts == 0)
+      return;
+
+   OsDisable();                        /* Ready them all in one go.          */
+   while (Posts-- > 0)
+      OsPost(Box->Room);
+   OsEnable();
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxCount() -- Take one from the count of filled messages, waiting         */
+/* Hundreds of a second at most for one...                                   */
+/*---------------------------------------------------------------------------*/
+
+static int BoxCount( MSGBOX *Box, long Hundreds )
+{
+   ULONG    *Count = (ULONG *) &Box->Avail.Count;
+   ULONG     Old;
+   int       rc;
+
+   if (Hundreds == 0) {                /* Take one only if there is one.     */
+      Old = OsAtomicLoad(Count);
+      do {
+         if ((long) Old <= 0)
+            return SYSTIMEOUT;
+      } while (!OsAtomicCas(Count, &Old, Old - 1));
+      return SYSOK;
+   }
+
+   if ((long) OsAtomicAdd(Count, -1) >= 0)
+      return SYSOK;                    /* Had one, no need to wait.          */
+
+   if ((rc = OsWaitTimeout(Box->Avail.Sem, Hundreds)) == SYSOK)
+      return SYSOK;                    /* A sender posted one.               */
+
+   /*------------------------------------------------------------------------*/
+   /* Timed out, or no timer. Give back what we took, unless a sender        */
+   /* already counted a message against it and is posting: then that post    */
+   /* is ours...                                                             */
+   /*------------------------------------------------------------------------*/
+   Old = OsAtomicLoad(Count);
+   do {
+      if ((long) Old >= 0) {
+         OsWait(Box->Avail.Sem);
+         return SYSOK;
+      }
+   } while (!OsAtomicCas(Count, &Old, Old + 1));
+
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxMore() -- Take up to Max more from the count of filled messages,       */
+/* without waiting. Returns how many...                                      */
+/*---------------------------------------------------------------------------*/
+
+static int BoxMore( MSGBOX *Box, int Max )
+{
+   ULONG    *Count = (ULONG *) &Box->Avail.Count;
+   ULONG     Old;
+   int       n;
+
+   Old = OsAtomicLoad(Count);
+   do {
+      if ((long) Old <= 0 || Max <= 0)
+         return 0;
+      n = (long) Old < Max ? (int) Old : Max;
+   } while (!OsAtomicCas(Count, &Old, Old - n));
+
+   return n;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxPut() -- The receiver gave back a slot it held; free the ring if that  */
+/* was the last one of a reaped process...                                   */
+/*---------------------------------------------------------------------------*/
+
+static void BoxPut( MSGBOX *Box )
+{
+   if (OsAtomicAdd(&Box->Held, -1) == BOX_DEAD)
+      OsFree(Box);
+}
@@ -32,7 +32,13 @@
 
 void *OsAlloc(int Length)
 {
-   return calloc(Length, 1);           /* Return                             */
+   void  *p;
+
+   OsDisable();                        /* Heap is not reentrant.             */
+   p = calloc(Length, 1);
+   OsEnable();
+
+   return p;                           /* Return                             */
 }
 
 
@@ -43,8 +49,8 @@ void *OsAlloc(int Length)
 
 int   OsFree(void *p)
 {
-
+   OsDisable();                        /* Heap is not reentrant.             */
    free(p);                            /* Free memory block.                 */
+   OsEnable();
    return SYSOK;                       /* Return, no errors.                 */
 }
-
\ No newline at end of file
@@ -13,7 +13,50 @@
 /*       Description:  This module contains:                                 */
 /*                                                                           */
 /*                     OsMsgSend()    - Send a message to a process.         */
+/*                     OsMsgSendTimeout() - Send, waiting a while at most.   */
+/*                     OsMsgSendBatch() - Send several messages at once.     */
+/*                     OsMsgSendBuff() - Send a buffer, without copying it.  */
+/*                     OsMsgCall()    - Send, and wait for the reply.        */
+/*                     OsMsgReply()   - Reply to a call.                     */
+/*                     OsMsgCaller()  - Who sent the call last received.     */
 /*                     OsMsgRecv()    - Receive a message.                   */
+/*                     OsMsgRecvTimeout() - Receive, waiting a while at most.*/
+/*                     OsMsgRecvBuff() - Receive, without copying it.        */
+/*                     OsMsgRecvBatch() - Receive several messages at once.  */
+/*                     OsMsgFree()    - Free data from OsMsgRecvBuff().      */
+/*                     OsMsgStats()   - Get message pool counts.             */
+/*                     OsMsgDrop()    - Free a message never received.       */
+/*                     OsMsgReady()   - See if a process has a message.      */
+/*                     OsMsgMake()    - Copy data into a new message.        */
+/*                     OsMsgDone()    - Free a message once received.        */
+/*                     OsMsgCallKill() - End calls of a killed process.      */
+/*                                                                           */
+/*                     OsMsgSend() copies the data, tagged just before it:   */
+/*                     up to OS_MSGINLINE bytes into the MESSAGE itself      */
+/*                     (MSG_INLINE_ID), more into a heap block of its own    */
+/*                     (MSG_COPY_ID). A buffer from OsBuffAlloc() sent with  */
+/*                     OsMsgSendBuff() is not copied: it goes to the         */
+/*                     receiver. OsMsgRecvBuff() and OsMsgRecvBatch() hand   */
+/*                     back any of them as it is, to be freed with           */
+/*                     OsMsgFree(), which tells them apart by the tag; an    */
+/*                     inline message stays out of the pool until then.      */
+/*                     OsMsgRecv() and OsMsgRecvTimeout() still hand back a  */
+/*                     plain block to free with OsFree(): a heap copy is     */
+/*                     moved down over its tag, anything else is copied out  */
+/*                     and freed at once.                                    */
+/*                                                                           */
+/*                     MESSAGEs come from a pool that grows NMSGSLAB at a    */
+/*                     time and never shrinks, so a short message costs the  */
+/*                     sender no heap calls once the pool is big enough.     */
+/*                                                                           */
+/*                     A process made by OsCreateMbox() gets its messages    */
+/*                     in a lock-free ring instead, see osmbox.c. The same   */
+/*                     rules hold for what each receive call hands back.     */
+/*                                                                           */
+/*                     OsMsgCaller() names the sender of the call last       */
+/*                     received, so a batch receive stops after a call:      */
+/*                     only the last message of a batch can be one, and it   */
+/*                     is the one OsMsgCaller() answers for.                 */
 /*                                                                           */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
@@ -25,6 +68,29 @@
 #include "oskernel.h"
 
 
+#define  MSG_COPY_ID   "MSGC"          /* Tag before data copied to heap.    */
+#define  MSG_INLINE_ID "MSGI"          /* Tag before data copied inline.     */
+
+#define  MsgInline(m)  ((m)->Data == (m)->Inline + MSG_HDR)
+
+
+static void     MsgChain( PROCESS *Process, MESSAGE *Msg );
+static int      MsgQueue( PROCESS *Process, MESSAGE *Msg, long Hundreds );
+static int      MsgRecv(  void **Data, int *Length, long Hundreds );
+static int      MsgTake( PROCESS *Process, void **Data, int *Length, int Max );
+static int      MsgToBox( PROCESS *P, void *Data, int Length, int Call,
+                          long Hundreds );
+static void     MsgCallOn( PROCESS *Server );
+static int      MsgReplied( void **Reply, int *ReplyLength );
+static int      MsgPlain( void **Data, int Length );
+static MESSAGE *MsgGet( void );
+static void     MsgPut( MESSAGE *Msg );
+
+static BYTE    *MsgCopy( void *Data, int Length );
+static PROCESS *MsgBox( HANDLE Pid );
+
+static ANCHOR   MsgPool;               /* Free MESSAGEs.                     */
+static MSGSTATS MsgStats;
 
 
 
@@ -33,9 +99,82 @@
 /*---------------------------------------------------------------------------*/
 
 int   OsMsgSend(HANDLE Pid, void *Data, int Length, int Wait)
+{
+   return OsMsgSendTimeout(Pid, Data, Length, Wait == True ? -1L : 0L);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgSendTimeout() -- Send a message to a process, and wait Hundreds of a */
+/* second at most (-1 forever) for it to be received; 0 waits only if the    */
+/* process has too many. Returns SYSTIMEOUT if it was not received in time:  */
+/* it stays queued for the process to receive later...                       */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgSendTimeout(HANDLE Pid, void *Data, int Length, long Hundreds)
 {
    MESSAGE   *Msg;
    PROCESS   *Process;
+   int        rc;
+
+   if ((Process = MsgBox(Pid)) != NULL) {   /* Mailbox ring, no kernel lock. */
+      rc = MsgToBox(Process, Data, Length, 0, Hundreds);
+      OsHandUnprotect(ProcessAnchor, Pid);
+      return rc;
+   }
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Process = (PROCESS *) OsHandFind(ProcessAnchor, Pid)) == NULL)  {
+      OsEnable();
+      return(SYSERR);
+   }
+
+   if (Hundreds != 0 && OsTimerStart(CurrProc, Hundreds) != SYSOK) {
+      OsEnable();                      /* No timer, so we can't wait.        */
+      return(SYSERR);
+   }
+
+   if ((Msg = OsMsgMake(Data, Length)) == NULL) {  /* Out of memory.         */
+      OsTimerStop(CurrProc);
+      OsEnable();
+      return(SYSERR);
+   }
+
+   MsgChain(Process, Msg);
+   rc = MsgQueue(Process, Msg, Hundreds);
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;                          /* Return                             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgSendBatch() -- Send Count messages to a process, looking it up and   */
+/* readying it once for all of them. With Wait, or if the process then has   */
+/* too many, wait once until the last is received. Returns how many were     */
+/* sent, in order, or SYSERR if none...                                      */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgSendBatch(HANDLE Pid, void **Data, int *Length, int Count, int Wait)
+{
+   MESSAGE   *Msg = NULL;
+   PROCESS   *Process;
+   int        n;
+
+   if (Count < 1)
+      return(SYSERR);
+
+   if ((Process = MsgBox(Pid)) != NULL) {   /* Mailbox ring, no kernel lock. */
+      for (n = 0; n < Count; n++)
+         if (MsgToBox(Process, Data[n], Length[n], 0,
+                      Wait == True && n == Count - 1 ? -1L : 0L) != SYSOK)
+            break;
+      OsHandUnprotect(ProcessAnchor, Pid);
+      return n ? n : SYSERR;
+   }
 
    OsDisable();                        /* Disable interrupts.                */
 
@@ -44,27 +183,317 @@ int   OsMsgSend(HANDLE Pid, void *Data, int Length, int Wait)
       return(SYSERR);
    }
 
-   Msg = OsAlloc( sizeof(MESSAGE));    /* Get another message structure.     */
-   Msg->Data = OsAlloc(Length);        /* Get memory for message.            */
+   for (n = 0; n < Count; n++) {       /* Queue all we can.                  */
+      if ((Msg = OsMsgMake(Data[n], Length[n])) == NULL)
+         break;
+      MsgChain(Process, Msg);
+   }
+
+   if (n == 0) {                       /* Out of memory for the first.       */
+      OsEnable();
+      return(SYSERR);
+   }
+
+   MsgQueue(Process, Msg, Wait == True ? -1L : 0L);   /* Wait on the last.   */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return n;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgSendBuff() -- Send Length bytes of a buffer from OsBuffAlloc() to a  */
+/* process without copying them. The buffer is the receiver's now, the       */
+/* sender must not touch it again...                                         */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgSendBuff(HANDLE Pid, void *Buffer, int Length, int Wait)
+{
+   MESSAGE   *Msg;
+   PROCESS   *Process;
+   int        rc;
+
+   if ((Process = MsgBox(Pid)) != NULL) {   /* Mailbox ring, no kernel lock. */
+      rc = OsBuffGive(Buffer, CurrPid, Length) == SYSOK ?  /* Ours to give?  */
+           OsMboxSend(Process, Buffer, Length, MBOX_BUFF,
+                      Wait == True ? -1L : 0L) : SYSERR;
+      OsHandUnprotect(ProcessAnchor, Pid);
+      return rc;
+   }
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Process = (PROCESS *) OsHandFind(ProcessAnchor, Pid)) == NULL ||
+       (Msg = MsgGet()) == NULL) {
+      OsEnable();
+      return(SYSERR);
+   }
+
+   if (OsBuffGive(Buffer, Pid, Length) != SYSOK) {
+      MsgPut(Msg);                     /* Not ours to give, or too short.    */
+      OsEnable();
+      return(SYSERR);                  /* Buffer is still the sender's.      */
+   }
+
+   Msg->Data = Buffer;                 /* The buffer itself, no copy.        */
+   Msg->Length = Length;
+
+   MsgChain(Process, Msg);
+   rc = MsgQueue(Process, Msg, Wait == True ? -1L : 0L);   /* No timer.      */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgCall() -- Send a message to a process and wait for its reply, put    */
+/* in *Reply and *ReplyLength and freed with OsMsgFree(). If the process     */
+/* waits in OsMsgRecv(), or is ready, we switch straight to it, and it runs  */
+/* on the rest of our time slice. SYSERR if it is killed before it replies.. */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgCall(HANDLE Pid, void *Data, int Length, void **Reply,
+                int *ReplyLength)
+{
+   MESSAGE   *Msg;
+   PROCESS   *Process;
+   PROCESS   *Caller;
+
+   if (Pid == CurrPid)                 /* Would wait for ourselves forever.  */
+      return(SYSERR);
+
+   if ((Process = MsgBox(Pid)) != NULL) {   /* Mailbox ring, no kernel lock. */
+      OsDisable();
+      MsgCallOn(Process);              /* Before it can reply.               */
+      OsEnable();
+      if (MsgToBox(Process, Data, Length, MBOX_CALL, 0L) != SYSOK) {
+         OsDisable();
+         OsMsgCallKill(CurrProc);      /* Take the call back.                */
+         OsEnable();
+         OsHandUnprotect(ProcessAnchor, Pid);
+         return(SYSERR);
+      }
+
+      OsDisable();
+      Caller = CurrProc;
+      if (Caller->Reply == NULL && Caller->Server) {   /* Not replied yet?   */
+         PrioUnchain( ReadyQ(Caller), &Caller->Link, Caller->Prio);
+         Caller->State = PRCALL;       /* Say we wait for the reply.         */
+         if (Process->State == PRREADY)   /* Readied by the ring, run it.    */
+            OsHandoff(Process);
+         else
+            OsSched();
+      }
+      OsHandUnprotect(ProcessAnchor, Pid);
+      return MsgReplied(Reply, ReplyLength);
+   }
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Process = (PROCESS *) OsHandFind(ProcessAnchor, Pid)) == NULL ||
+       (Msg = OsMsgMake(Data, Length)) == NULL) {
+      OsEnable();
+      return(SYSERR);
+   }
+
+   Msg->Call = CurrPid;
+   MsgChain(Process, Msg);
+   MsgCallOn(Process);
+
+   Caller = CurrProc;
+   PrioUnchain( ReadyQ(Caller), &Caller->Link, Caller->Prio);   /* Off ready.*/
+   Caller->State = PRCALL;             /* Say we wait for the reply.         */
+
+   if (Process->State == PRRECV ||     /* Waiting for it, or ready to get to */
+       Process->State == PRREADY)      /* it: run it right now.              */
+      OsHandoff(Process);
+   else {
+      if (Process->State == PRMULTI && (Process->Flags & PROCESS_WATCHMSG))
+         OsReady(Process->Pid);
+      OsSched();                       /* Let someone else run.              */
+   }
+
+   return MsgReplied(Reply, ReplyLength);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgReply() -- Reply to process Pid, waiting in OsMsgCall() for us. If   */
+/* nothing more urgent is ready, switch straight back to it...               */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgReply(HANDLE Pid, void *Data, int Length)
+{
+   MESSAGE   *Msg;
+   PROCESS   *Caller;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Caller = (PROCESS *) OsHandFind(ProcessAnchor, Pid)) == NULL ||
+       Caller->Server != CurrPid ||    /* Not calling us.                    */
+       (Msg = OsMsgMake(Data, Length)) == NULL) {
+      OsEnable();
+      return(SYSERR);
+   }
+
+   Unchain(&CurrProc->Callers, &Caller->CallLink);
+   Caller->Server = 0;
+   Caller->Reply  = Msg;
+
+   if (Caller->State == PRCALL)        /* Waiting for it, run it right now.  */
+      OsHandoff(Caller);
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgCaller() -- Pid of the process that sent the message last received   */
+/* with OsMsgCall(), to reply to; 0 if it was not a call...                  */
+/*---------------------------------------------------------------------------*/
+
+HANDLE OsMsgCaller(void)
+{
+   return CurrProc->Caller;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgReady() -- Called disabled. True if a process has a message...       */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgReady(PROCESS *p)
+{
+   return p->Box ? OsMboxReady(p->Box) : p->MsgCount > 0;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgCallKill() -- Called disabled. Process p is killed: take back its    */
+/* call, with its reply if one came, and end the calls of processes waiting  */
+/* for it to reply with SYSERR...                                            */
+/*---------------------------------------------------------------------------*/
+
+void  OsMsgCallKill(PROCESS *p)
+{
+   PROCESS   *Server;
+   PROCESS   *Caller;
+
+   if (p->Server) {
+      if ((Server = (PROCESS *) OsHandFind(ProcessAnchor, p->Server)) != NULL)
+         Unchain(&Server->Callers, &p->CallLink);
+      p->Server = 0;
+   }
+
+   if (p->Reply) {
+      OsMsgDrop(p->Reply);
+      p->Reply = NULL;
+   }
+
+   while ((Caller = ChainPop(&p->Callers)) != NULL) {
+      Caller->Server = 0;              /* No reply will come.                */
+      if (Caller->State == PRCALL)
+         OsReady(Caller->Pid);
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgMake() -- Called disabled. Get a MESSAGE holding a copy of Data,     */
+/* inline if it is short. NULL if out of memory...                           */
+/*---------------------------------------------------------------------------*/
+
+MESSAGE *OsMsgMake(void *Data, int Length)
+{
+   MESSAGE   *Msg;
+   BYTE      *Copy;
+
+   if ((Msg = MsgGet()) == NULL)       /* Get another message structure.     */
+      return NULL;
+
+   if (Length <= OS_MSGINLINE) {       /* Short, keep data in the message.   */
+      Copy = Msg->Inline + MSG_HDR;
+      memcpy(Copy - 4, MSG_INLINE_ID, 4);
+      memcpy(Copy, Data, Length);
+      MsgStats.Inline++;
+   }
+   else if ((Copy = MsgCopy(Data, Length)) != NULL)
+      MsgStats.Heap++;
+   else {
+      MsgPut(Msg);
+      return NULL;
+   }
+
+   Msg->Data = Copy;
    Msg->Length = Length;               /* Save length of message.            */
-   memcpy(Msg->Data, Data, Length);    /* Copy data to safe place.           */
+   return Msg;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgDone() -- Called disabled. A message was received; put it back       */
+/* unless its data is inline, which the receiver gives back with             */
+/* OsMsgFree()...                                                            */
+/*---------------------------------------------------------------------------*/
+
+void  OsMsgDone(MESSAGE *Msg)
+{
+   if (!MsgInline(Msg))
+      MsgPut(Msg);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgChain() -- Called disabled. Queue a message to a process...            */
+/*---------------------------------------------------------------------------*/
+
+static void MsgChain( PROCESS *Process, MESSAGE *Msg )
+{
    ChainInit(&Msg->Link, Msg);         /* Initialize link fields.            */
    ChainQueue(&Process->Msgs, &Msg->Link);  /* Queue up message.             */
    Process->MsgCount++;
+}
 
-   if (Process->State == PRRECV)       /* Is process waiting for a message?  */
-      OsReady(Pid);                    /* Yes, so make it ready.             */
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgQueue() -- Called disabled, with the timer started if Hundreds is more */
+/* than 0. Messages up to Msg were queued to a process: ready it if it waits */
+/* for one, and wait for Msg to be received if it has too many or Hundreds   */
+/* is not 0...                                                               */
+/*---------------------------------------------------------------------------*/
+
+static int MsgQueue( PROCESS *Process, MESSAGE *Msg, long Hundreds )
+{
+   PROCESS   *Sender;
+
+   if (Process->State == PRRECV ||     /* Is process waiting for a message?  */
+       (Process->State == PRMULTI && (Process->Flags & PROCESS_WATCHMSG)))
+      OsReady(Process->Pid);           /* Yes, so make it ready.             */
+
+   Sender = CurrProc;
 
    if (Process->MsgCount > NMSG ||     /* Can we queue more messages?        */
-       Wait == True  ) {               /*   or are we to wait anyhow?        */
-      Msg->Pid = OsGetPid();           /* Say that we are suspended.         */
-      Unchain( &ReadyAnchor, &(Process->Link)); /* Remove from ready chain.  */
-      Process->State = PRSEND;         /* Say process is waiting to send.    */
+       Hundreds != 0 ) {               /*   or are we to wait anyhow?        */
+      Msg->Pid = Sender->Pid;          /* Say that we are suspended.         */
+      Sender->Sending = &Msg->Pid;     /* For a timeout to take it back.     */
+      PrioUnchain( ReadyQ(Sender), &Sender->Link, Sender->Prio);   /* Off ready. */
+      Sender->State = PRSEND;          /* Say we are waiting to send.        */
       OsSched();                       /* Let someone else run.              */
    }
 
-   OsEnable();                         /* Enable interrupts.                 */
-   return SYSOK;                       /* Return                             */
+   return OsTimerStop(Sender);         /* SYSTIMEOUT if not received in time.*/
 }
 
 
@@ -75,35 +504,385 @@ int   OsMsgSend(HANDLE Pid, void *Data, int Length, int Wait)
 
 int   OsMsgRecv(void **Data, int *Length, int Wait)
 {
-   MESSAGE   *Msg;
    PROCESS   *Process;
 
+   if (CurrProc->Box)                  /* Mailbox ring, no kernel lock.      */
+      return OsMboxRecv(CurrProc->Box, Data, Length, 1, Wait ? -1L : 0L) ==
+             1 ? MsgPlain(Data, *Length) : SYSNOMSG;
+
    OsDisable();                        /* Disable interrupts.                */
 
-   Process = (PROCESS *) OsHandFind(ProcessAnchor, CurrPid);
+   Process = CurrProc;
 
    if (Process->MsgCount == 0 && Wait) {    /* Need to wait for message?     */
-      Unchain( &ReadyAnchor, &(Process->Link)); /* Remove from ready chain.  */
+      PrioUnchain( ReadyQ(Process), &Process->Link, Process->Prio); /* Off rdy.*/
       Process->State = PRRECV;         /* Say process is waiting for message.*/
       OsSched();                       /* Let some else run.                 */
    }
 
    if (Process->MsgCount > 0 && Wait) {
+      MsgTake(Process, Data, Length, 1);    /* Pop off a message.            */
+      OsEnable();                      /* Enable interrupts.                 */
+      return MsgPlain(Data, *Length);  /* Return plain data to caller.       */
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSNOMSG;                    /* Return indicating no messages.     */
+}
+
+
+
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgRecvTimeout() -- Receive a message. Wait Hundreds of a second at     */
+/* most (0 to not wait, -1 to wait forever) for one. Returns SYSTIMEOUT if   */
+/* none came...                                                              */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgRecvTimeout(void **Data, int *Length, long Hundreds)
+{
+   int        rc;
+
+   if ((rc = MsgRecv(Data, Length, Hundreds)) == SYSOK)
+      rc = MsgPlain(Data, *Length);    /* Something OsFree() can free.       */
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgRecvBuff() -- Same as OsMsgRecvTimeout(), but hand back the data as  */
+/* it was sent, not copied: a buffer sent with OsMsgSendBuff() comes back at */
+/* the address it was sent from. Free it with OsMsgFree()...                 */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgRecvBuff(void **Data, int *Length, long Hundreds)
+{
+   return MsgRecv(Data, Length, Hundreds);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgFree() -- Free data from OsMsgRecvBuff(), copied or not...           */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgFree(void *Data)
+{
+   BYTE     *Tag = (BYTE *) Data - 4;
+
+   if (memcmp(Tag, MSG_INLINE_ID, 4) == 0) {
+      memset(Tag, 0, 4);               /* Catch freeing it twice.            */
+      OsDisable();
+      MsgPut((MESSAGE *) ((BYTE *) Data - MSG_HDR -
+                          (BYTE *) (((MESSAGE *)(0))->Inline)));
+      OsEnable();
+      return SYSOK;
+   }
+
+   if (memcmp(Tag, MSG_COPY_ID, 4) == 0) {
+      memset(Tag, 0, 4);
+      return OsFree((BYTE *) Data - MSG_HDR);
+   }
+
+   if (OsMboxFree(Data) == SYSOK)      /* Data held in a mailbox slot?       */
+      return SYSOK;
+
+   return OsBuffFree(Data) == SYSOK ? SYSOK : SYSERR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgStats() -- Get counts of the message pool, and of sends by where     */
+/* their data went...                                                        */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgStats(MSGSTATS *Stats)
+{
+   OsDisable();
+   *Stats = MsgStats;
+   OsEnable();
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgDrop() -- Called disabled. Free a message that was never received,   */
+/* and its data...                                                           */
+/*---------------------------------------------------------------------------*/
+
+void  OsMsgDrop(MESSAGE *Msg)
+{
+   if (Msg->Data != NULL && !MsgInline(Msg))
+      OsMsgFree(Msg->Data);
+   MsgPut(Msg);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsMsgRecvBatch() -- Receive up to Max messages at once, into Data[] and   */
+/* Length[]. Wait Hundreds of a second at most (0 to not wait, -1 to wait    */
+/* forever) for the first, then take whatever else is queued. Returns how    */
+/* many, 0 if none came in time. The data is handed back as it was sent,     */
+/* like OsMsgRecvBuff(): free each with OsMsgFree()...                       */
+/*---------------------------------------------------------------------------*/
+
+int   OsMsgRecvBatch(void **Data, int *Length, int Max, long Hundreds)
+{
+   PROCESS   *Process;
+   int        n;
+
+   if (Max < 1)
+      return(SYSERR);
+
+   if (CurrProc->Box)                  /* Mailbox ring, no kernel lock.      */
+      return OsMboxRecv(CurrProc->Box, Data, Length, Max, Hundreds);
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   Process = CurrProc;
+
+   if (Process->MsgCount == 0 && Hundreds != 0) {  /* Need to wait?          */
+      if (OsTimerStart(Process, Hundreds) != SYSOK) {  /* Give up when due.  */
+         OsEnable();
+         return(SYSERR);
+      }
+      PrioUnchain( ReadyQ(Process), &Process->Link, Process->Prio); /* Off rdy.*/
+      Process->State = PRRECV;         /* Say process is waiting for message.*/
+      OsSched();                       /* Let some else run.                 */
+      OsTimerStop(Process);
+   }
+
+   n = MsgTake(Process, Data, Length, Max);  /* 0 if none came in time.      */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return n;                           /* Return to caller.                  */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgRecv() -- Take the next message, waiting Hundreds for one, and hand    */
+/* back its data as it was queued...                                         */
+/*---------------------------------------------------------------------------*/
+
+static int MsgRecv( void **Data, int *Length, long Hundreds )
+{
+   int        n;
+
+   n = OsMsgRecvBatch(Data, Length, 1, Hundreds);
+   return n == 1 ? SYSOK : n == 0 ? SYSTIMEOUT : n;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgTake() -- Called disabled. Pop up to Max queued messages of a process  */
+/* into Data[] and Length[], readying senders waiting on them, but none past */
+/* a call. Returns how many...                                               */
+/*---------------------------------------------------------------------------*/
+
+static int MsgTake( PROCESS *Process, void **Data, int *Length, int Max )
+{
+   MESSAGE   *Msg;
+   int        n;
+
+   for (n = 0; n < Max && Process->MsgCount > 0; n++) {
       Process->MsgCount--;             /* One less message.                  */
       Msg = ChainPop( &Process->Msgs); /* Pop off a message.                 */
-      *Data = Msg->Data;               /* Pass data to caller.               */
-      *Length = Msg->Length;           /* Pass data lenbgth to caller.       */
+      Data[n] = Msg->Data;             /* Pass data to caller.               */
+      Length[n] = Msg->Length;         /* Pass data length to caller.        */
+      Process->Caller = Msg->Call;     /* Who to reply to, if a call.        */
       if (Msg->Pid)                    /* Is there a waiting process?        */
-         OsResume(Msg->Pid);           /* Then resume it.                    */
-      OsFree(Msg);                     /* Free message structure.            */
-      OsEnable();                      /* Enable interrupts.                 */
-      return(SYSOK);                   /* Return to caller.                  */
+         OsReady(Msg->Pid);            /* Then ready it.                     */
+      OsMsgDone(Msg);                  /* Free message, unless data is in it.*/
+      if (Process->Caller) {           /* A call ends the batch.             */
+         n++;
+         break;
+      }
+   }
+
+   return n;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgCallOn() -- Called disabled. The current process calls Server: chain   */
+/* it on Server's callers, for OsMsgReply() to find...                       */
+/*---------------------------------------------------------------------------*/
+
+static void MsgCallOn( PROCESS *Server )
+{
+   PROCESS   *Caller = CurrProc;
+
+   ChainInit(&Caller->CallLink, Caller);
+   ChainQueue(&Server->Callers, &Caller->CallLink);
+   Caller->Server = Server->Pid;
+   Caller->Reply  = NULL;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgReplied() -- Called disabled, enables. Pass the reply to a call back   */
+/* to the caller, SYSERR if the process called was killed instead...         */
+/*---------------------------------------------------------------------------*/
+
+static int MsgReplied( void **Reply, int *ReplyLength )
+{
+   PROCESS   *Caller = CurrProc;
+   MESSAGE   *Msg;
+
+   if ((Msg = Caller->Reply) == NULL) {
+      OsEnable();
+      return(SYSERR);
    }
 
+   Caller->Reply = NULL;
+   *Reply = Msg->Data;                 /* Pass reply to caller.              */
+   *ReplyLength = Msg->Length;
+   OsMsgDone(Msg);                     /* Free message, unless data is in it.*/
+
    OsEnable();                         /* Enable interrupts.                 */
-   return SYSNOMSG;                    /* Return indicating no messages.     */
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgPlain() -- Turn received data into a plain block from OsAlloc(), as    */
+/* OsMsgRecv() has always handed back. A heap copy is moved down over its    */
+/* tag; inline data or a buffer is copied out and freed, which puts the      */
+/* MESSAGE, slot or buffer back at once. SYSERR, and nothing handed back, if */
+/* there is no memory for that...                                            */
+/*---------------------------------------------------------------------------*/
+
+static int MsgPlain( void **Data, int Length )
+{
+   BYTE      *Block;
+
+   if (memcmp((BYTE *) *Data - 4, MSG_COPY_ID, 4) == 0) {
+      Block = (BYTE *) *Data - MSG_HDR;
+      memmove(Block, *Data, Length);   /* Start of the block it came in.     */
+      *Data = Block;
+      return SYSOK;
+   }
+
+   if ((Block = OsAlloc(Length)) != NULL)
+      memcpy(Block, *Data, Length);
+   OsMsgFree(*Data);                   /* Back to its pool.                  */
+
+   *Data = Block;
+   return Block != NULL ? SYSOK : SYSERR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgGet() -- Called disabled. Get a MESSAGE from the pool, growing it      */
+/* when it is empty. NULL if out of memory...                                */
+/*---------------------------------------------------------------------------*/
+
+static MESSAGE *MsgGet( void )
+{
+   MESSAGE  *Msg;
+   int       i;
+
+   if (ChainFirst(&MsgPool) == NULL) {
+      if ((Msg = OsAlloc(NMSGSLAB * sizeof(MESSAGE))) == NULL)
+         return NULL;
+      for (i = 0; i < NMSGSLAB; i++) {
+         ChainInit(&Msg[i].Link, &Msg[i]);
+         ChainPush(&MsgPool, &Msg[i].Link);
+      }
+      MsgStats.Blocks += NMSGSLAB;
+   }
+
+   Msg = ChainPop(&MsgPool);
+   Msg->Pid  = 0;
+   Msg->Call = 0;
+
+   if (++MsgStats.InUse > MsgStats.HighWater)
+      MsgStats.HighWater = MsgStats.InUse;
+
+   return Msg;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgPut() -- Called disabled. Put a MESSAGE back in the pool...            */
+/*---------------------------------------------------------------------------*/
+
+static void MsgPut( MESSAGE *Msg )
+{
+   ChainPush(&MsgPool, &Msg->Link);
+   MsgStats.InUse--;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgCopy() -- Copy data longer than OS_MSGINLINE to a block of the heap,   */
+/* tagged MSG_COPY_ID. NULL if out of memory...                              */
+/*---------------------------------------------------------------------------*/
+
+static BYTE *MsgCopy( void *Data, int Length )
+{
+   BYTE     *Copy;
+
+   if ((Copy = OsAlloc(MSG_HDR + Length)) == NULL)
+      return NULL;
+
+   memcpy(Copy + MSG_HDR - 4, MSG_COPY_ID, 4);
+   memcpy(Copy + MSG_HDR, Data, Length);
+   return Copy + MSG_HDR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* MsgToBox() -- Copy a message into the ring of process P, which the        */
+/* caller protects, waiting as OsMboxSend() does. Call is MBOX_CALL if the   */
+/* caller waits for a reply...                                               */
+/*---------------------------------------------------------------------------*/
+
+static int MsgToBox( PROCESS *P, void *Data, int Length, int Call,
+                     long Hundreds )
+{
+   BYTE      *Copy;
+
+   if (Length <= OS_MSGINLINE)
+      return OsMboxSend(P, Data, Length, MBOX_COPY | Call, Hundreds);
+   if ((Copy = MsgCopy(Data, Length)) != NULL)
+      return OsMboxSend(P, Copy, Length, MBOX_HEAP | Call, Hundreds);
+   return SYSERR;
 }
 
 
 
-
\ No newline at end of file
+/*---------------------------------------------------------------------------*/
+/* MsgBox() -- If process Pid has a mailbox ring, protect its Pid and return */
+/* it, else NULL...                                                          */
+/*---------------------------------------------------------------------------*/
+
+static PROCESS *MsgBox( HANDLE Pid )
+{
+   PROCESS  *Process;
+
+   if ((Process = (PROCESS *) OsHandProtect(ProcessAnchor, Pid)) == NULL)
+      return NULL;
+
+   if (Process->Box == NULL) {
+      OsHandUnprotect(ProcessAnchor, Pid);
+      return NULL;
+   }
+
+   return Process;
+}
@@ -0,0 +1,432 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSPORT.C                                              */
+/*                                                                           */
+/*             Title:  Named message ports.                                  */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsPortCreate() - Creates a port, named or not.        */
+/*                     OsPortOpen()   - Finds a port by name.                */
+/*                     OsPortDelete() - Deletes a port.                      */
+/*                     OsPortJoin()   - Join a broadcast port.               */
+/*                     OsPortLeave()  - Leave a broadcast port.              */
+/*                     OsPortSend()   - Send a message to a port.            */
+/*                     OsPortRecv()   - Receive a message from a port.       */
+/*                     OsPortCancel() - Takes a receiver off its port.       */
+/*                                                                           */
+/*                     A port is addressed by handle, or found by name, so   */
+/*                     senders need not know which processes receive. Any    */
+/*                     number of processes may receive from it. A message    */
+/*                     sent to a port (OS_PORT_BALANCE) goes to one of them: */
+/*                     straight to the receiver that has waited longest, or  */
+/*                     if none waits, onto the port for the next to ask. A   */
+/*                     broadcast port (OS_PORT_BROADCAST) gives every        */
+/*                     process that joined it a copy of its own instead.     */
+/*                                                                           */
+/*                     Messages are MESSAGEs from the pool of osmsg.c, and   */
+/*                     the receiver frees what it got with OsMsgFree(). A    */
+/*                     send never waits.                                     */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+
+
+static PORT       *PortFind(   char *Name );
+static PORTMEMBER *PortMember( PORT *Port, HANDLE Pid );
+static void        PortPut(    PORTQ *Q, MESSAGE *Msg );
+static void        PortDrain(  PORTQ *Q );
+static void        PortLeave(  PORT *Port, PORTMEMBER *M );
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortCreate() -- Create a new port. Name may be NULL; else it must not   */
+/* name another port. Options is OS_PORT_BALANCE or OS_PORT_BROADCAST...     */
+/*---------------------------------------------------------------------------*/
+
+HANDLE   OsPortCreate(char *Name, int Options)
+{
+   HANDLE      Handle;                 /* New port handle.                   */
+   PORT       *Port;                   /* Pointer to new port.               */
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if (Name != NULL && PortFind(Name) != NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return (SYSERR);                 /* Name is taken.                     */
+   }
+
+   if ((Port = (PORT *) OsAlloc(sizeof(PORT))) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return (SYSERR);                 /* Can not allocate any more.         */
+   }
+
+   if ((Handle = OsHandCreate(&PortAnchor, (void *) Port)) == SYSERR) {
+      OsFree(Port);                    /* Can not use port struct.           */
+      OsEnable();                      /* Enable interrupts.                 */
+      return (SYSERR);                 /* Can not allocate any more.         */
+   }
+
+   Port->Handle  = Handle;
+   Port->Options = Options;
+   if (Name != NULL)
+      strncpy(Port->Name, Name, PORTNMLEN - 1);
+
+   ChainInit( &Port->Link, Port );
+   ChainQueue( &PortNames, &Port->Link );   /* Named or not, so all are on.  */
+
+   OsHandUnprotect(PortAnchor, Handle);     /* Unprotect resource.           */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return Handle;                      /* Return with new port handle.       */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortOpen() -- Find the port of a name. SYSERR if there is none...       */
+/*---------------------------------------------------------------------------*/
+
+HANDLE   OsPortOpen(char *Name)
+{
+   PORT       *Port;
+   HANDLE      Handle = SYSERR;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if (Name != NULL && (Port = PortFind(Name)) != NULL)
+      Handle = Port->Handle;
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return Handle;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortDelete() -- Destroy a port and the messages still on it. Its        */
+/* receivers get SYSERR...                                                   */
+/*---------------------------------------------------------------------------*/
+
+int   OsPortDelete(HANDLE Handle)
+{
+   PORT       *Port;
+   PORTMEMBER *M;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Port = (PORT *) OsHandDestroy(PortAnchor, Handle)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   Unchain( &PortNames, &Port->Link );
+
+   PortDrain( &Port->Q );
+   while ((M = ChainFirst( &Port->Members )) != NULL)
+      PortLeave( Port, M );
+
+   OsFree(Port);                       /* Free port structure.               */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortJoin() -- Make the current process a member of a port, to get a     */
+/* copy of each message broadcast from now on...                             */
+/*---------------------------------------------------------------------------*/
+
+int   OsPortJoin(HANDLE Handle)
+{
+   PORT       *Port;
+   PORTMEMBER *M;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Port = (PORT *) OsHandFind(PortAnchor, Handle)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   if (PortMember(Port, CurrPid) == NULL) {     /* Not joined already?       */
+      if ((M = (PORTMEMBER *) OsAlloc(sizeof(PORTMEMBER))) == NULL) {
+         OsEnable();
+         return SYSERR;
+      }
+      M->Pid = CurrPid;
+      ChainInit( &M->Link, M );
+      ChainQueue( &Port->Members, &M->Link );
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortLeave() -- The current process leaves a port; messages broadcast    */
+/* to it but not yet received are freed...                                   */
+/*---------------------------------------------------------------------------*/
+
+int   OsPortLeave(HANDLE Handle)
+{
+   PORT       *Port;
+   PORTMEMBER *M;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Port = (PORT *) OsHandFind(PortAnchor, Handle)) == NULL ||
+       (M = PortMember(Port, CurrPid)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   PortLeave(Port, M);
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortSend() -- Send a copy of a message to a port: to one receiver, or   */
+/* with OS_PORT_BROADCAST to every member...                                 */
+/*---------------------------------------------------------------------------*/
+
+int   OsPortSend(HANDLE Handle, void *Data, int Length)
+{
+   PORT       *Port;
+   PORTMEMBER *M, *Next;
+   MESSAGE    *Msg;
+   int         rc = SYSOK;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Port = (PORT *) OsHandFind(PortAnchor, Handle)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   if (!(Port->Options & OS_PORT_BROADCAST)) {
+      if ((Msg = OsMsgMake(Data, Length)) != NULL)
+         PortPut(&Port->Q, Msg);
+      else
+         rc = SYSERR;
+   }
+   else for (M = ChainFirst( &Port->Members ); M; M = Next) {
+      Next = ChainNext( &M->Link );
+      if (OsHandFind(ProcessAnchor, M->Pid) == NULL)
+         PortLeave(Port, M);           /* Member is gone, never left.        */
+      else if ((Msg = OsMsgMake(Data, Length)) != NULL)
+         PortPut(&M->Q, Msg);
+      else
+         rc = SYSERR;                  /* This one misses it.                */
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortRecv() -- Receive a message from a port, waiting Hundreds of a      */
+/* second at most (0 to not wait, -1 to wait forever). Returns SYSTIMEOUT if */
+/* none came, SYSERR if the port is deleted or, for a broadcast port, the    */
+/* process is not a member...                                                */
+/*---------------------------------------------------------------------------*/
+
+int   OsPortRecv(HANDLE Handle, void **Data, int *Length, long Hundreds)
+{
+   PORT       *Port;
+   PORTMEMBER *M;
+   PORTQ      *Q;
+   PORTWAIT    W;                      /* On our stack, we are blocked while */
+   PROCESS    *P;                      /* it is in use.                      */
+   MESSAGE    *Msg;
+   int         rc;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Port = (PORT *) OsHandFind(PortAnchor, Handle)) == NULL) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return with error.                 */
+   }
+
+   if (!(Port->Options & OS_PORT_BROADCAST))
+      Q = &Port->Q;                    /* Shared by all receivers.           */
+   else if ((M = PortMember(Port, CurrPid)) != NULL)
+      Q = &M->Q;                       /* Our own copies.                    */
+   else {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Must join first.                   */
+   }
+
+   if ((Msg = ChainPop( &Q->Msgs )) != NULL)
+      rc = SYSOK;                      /* One was queued, no need to wait.   */
+
+   else if (Hundreds == 0)             /* Would have to wait, but can't.     */
+      rc = SYSTIMEOUT;
+
+   else if (OsTimerStart( CurrProc, Hundreds ) != SYSOK)
+      rc = SYSERR;                     /* No timer, so we can't wait.        */
+
+   else {
+      P = CurrProc;
+      ChainInit( &W.Link, &W );
+      W.On   = &Q->Waiters;
+      W.Proc = P;
+      W.Msg  = NULL;
+      W.Rc   = SYSERR;
+      ChainQueue( W.On, &W.Link );     /* Queue onto port, last to be given  */
+      P->PortWait = &W;                /* one.                               */
+
+      PrioUnchain( ReadyQ(P), &P->Link, P->Prio);  /* Off ready queue.  */
+      P->State = PRPORT;               /* State is now waiting on port.      */
+      OsSched();                       /* Now, let others run.               */
+      rc = OsTimerStop( P );
+
+      P->PortWait = NULL;
+      if (rc == SYSOK)
+         rc = W.Rc;                    /* SYSERR if port was deleted.        */
+      Msg = W.Msg;
+   }
+
+   if (Msg != NULL) {
+      *Data   = Msg->Data;             /* Pass data to caller.               */
+      *Length = Msg->Length;           /* Pass data length to caller.        */
+      OsMsgDone(Msg);                  /* Free message, unless data is in it.*/
+      rc = SYSOK;
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;                          /* Return SYSOK or SYSTIMEOUT.        */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsPortCancel() -- Called disabled. Take a process off the port it waits   */
+/* on...                                                                     */
+/*---------------------------------------------------------------------------*/
+
+void  OsPortCancel(PROCESS *P)
+{
+   PORTWAIT   *W;
+
+   if ((W = P->PortWait) != NULL && W->On != NULL) {
+      Unchain( W->On, &W->Link );
+      W->On = NULL;
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PortFind() -- Called disabled. Find a port by name, NULL if none...       */
+/*---------------------------------------------------------------------------*/
+
+static PORT *PortFind( char *Name )
+{
+   PORT       *Port;
+
+   for (Port = ChainFirst( &PortNames ); Port; Port = ChainNext( &Port->Link ))
+      if (Port->Name[0] && strncmp(Port->Name, Name, PORTNMLEN - 1) == 0)
+         return Port;
+
+   return NULL;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PortMember() -- Called disabled. Find process Pid among members of a      */
+/* port, NULL if it did not join...                                          */
+/*---------------------------------------------------------------------------*/
+
+static PORTMEMBER *PortMember( PORT *Port, HANDLE Pid )
+{
+   PORTMEMBER *M;
+
+   for (M = ChainFirst( &Port->Members ); M; M = ChainNext( &M->Link ))
+      if (M->Pid == Pid)
+         return M;
+
+   return NULL;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PortPut() -- Called disabled. Hand a message to the receiver that has     */
+/* waited longest, or queue it if none waits...                              */
+/*---------------------------------------------------------------------------*/
+
+static void PortPut( PORTQ *Q, MESSAGE *Msg )
+{
+   PORTWAIT   *W;
+
+   ChainInit( &Msg->Link, Msg );
+
+   if ((W = ChainPop( &Q->Waiters )) == NULL) {
+      ChainQueue( &Q->Msgs, &Msg->Link );
+      return;
+   }
+
+   W->On  = NULL;
+   W->Msg = Msg;
+   W->Rc  = SYSOK;
+   OsReady(W->Proc->Pid);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PortDrain() -- Called disabled. Free the messages of a queue, and ready   */
+/* its receivers with SYSERR...                                              */
+/*---------------------------------------------------------------------------*/
+
+static void PortDrain( PORTQ *Q )
+{
+   PORTWAIT   *W;
+   MESSAGE    *Msg;
+
+   while ((Msg = ChainPop( &Q->Msgs )) != NULL)
+      OsMsgDrop(Msg);
+
+   while ((W = ChainPop( &Q->Waiters )) != NULL) {
+      W->On = NULL;                    /* Receiver finds port is gone.       */
+      W->Rc = SYSERR;
+      OsReady(W->Proc->Pid);
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PortLeave() -- Called disabled. Take a member off a port and free it...   */
+/*---------------------------------------------------------------------------*/
+
+static void PortLeave( PORT *Port, PORTMEMBER *M )
+{
+   Unchain( &Port->Members, &M->Link );
+   PortDrain( &M->Q );
+   OsFree(M);
+}
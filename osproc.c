@@ -13,11 +13,17 @@
 /*       Description:  This module contains the following:                   */
 /*                                                                           */
 /*                     OsCreate()  - Create a process that ready to run.     */
+/*                     OsCreateMbox() - Same, getting messages in a ring.    */
 /*                     OsSched()   - Schedule process with highest priority. */
+/*                     OsHandoff() - Switch straight to a waiting process.   */
+/*                     OsIdle()    - Run others, or wait until there are.    */
+/*                     OsQuantum() - Set time slice for a priority.          */
+/*                     OsProcPool()- Set size of recycling pool for stacks.  */
 /*                     OsKill()    - Kill a process.                         */
 /*                     OsReturn()  - Kills currently running process.        */
 /*                     OsReady()   - Make a process ready to run.            */
 /*                     OsSuspend() - Suspend a ready process.                */
+/*                     OsSuspendTimeout() - Suspend self, for a while at most*/
 /*                     OsResume()  - Resume a suspended process.             */
 /*                     OsGetPid()  - Get process id of currently running     */
 /*                                   process.                                */
@@ -31,7 +37,13 @@
 #include "oskernel.h"
 
 
-static int  NewPid(        void );
+static void IdleWait(      void );
+static void Reap(          void );
+static int  PoolClass(     int Size );
+static PROCESS *PoolGet(   int Class );
+static void PoolPut(       PROCESS *pptr );
+static int  ReapFree(      void *Process );
+static void BoxFree(       MSGBOX *Box );
 
 
 /*---------------------------------------------------------------------------*/
@@ -41,15 +53,37 @@ static int  NewPid(        void );
 HANDLE  OsCreate(
    void     *procaddr,                 /* Procedure address.                 */
    int       ssize,                    /* Stack size in words.               */
-   int       priority,                 /* Process priority >= 0.             */
+   int       priority,                 /* Priority 1 to NPRIO-1.             */
    char     *name,                     /* Name ( for debugging ).            */
    char     *data )                    /* Argument passed to new process.    */
 
+{
+   return OsCreateMbox(procaddr, ssize, priority, name, data, 0);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsCreateMbox  --  Create a process that gets its messages in a lock-free  */
+/* ring of Slots slots (see osmbox.c), or on a chain if Slots is 0           */
+/*---------------------------------------------------------------------------*/
+
+HANDLE  OsCreateMbox(
+   void     *procaddr,                 /* Procedure address.                 */
+   int       ssize,                    /* Stack size in words.               */
+   int       priority,                 /* Priority 1 to NPRIO-1.             */
+   char     *name,                     /* Name ( for debugging ).            */
+   char     *data,                     /* Argument passed to new process.    */
+   int       slots )                   /* Mailbox ring slots, or 0.          */
+
 {
    HANDLE   Pid;                       /* Stores new process id.             */
    PROCESS *pptr;                      /* Pointer to process table entry.    */
-   int      i;
+   MSGBOX  *Box = NULL;                /* Mailbox ring, if any.              */
+   int      Class;                     /* Pool size class of stack.          */
+#if !defined(OS_HOSTED)
    USHORT  *stk;                       /* Stack address.                     */
+#endif
 
 
    ssize = ((ssize + 3) & (~3));       /* Round size to long word boundary.  */
@@ -57,36 +91,48 @@ HANDLE  OsCreate(
    if ( ssize < MIN_STACK_SIZE )       /* Make sure at least minimum size.   */
       ssize = MIN_STACK_SIZE;
 
-   if ( priority < 1 ) {               /* Check a few parms.           */
-   	OsEnable();
+   if ( priority < 1 || priority >= NPRIO || slots < 0 )  /* Check parms.    */
    	return(SYSERR);
-   }
 
+   if (slots > 0 && (Box = OsMboxCreate(slots)) == NULL)
+      return(SYSERR);
 
-   /*------------------------------------------------------------------------*/
-   /* Create process structure...                                            */
-   /*------------------------------------------------------------------------*/
+   if ((Class = PoolClass(ssize)) >= 0)   /* Round up to a pool size class.  */
+      ssize = MIN_STACK_SIZE << Class;
 
-   pptr  = (PROCESS *) OsAlloc(sizeof(PROCESS));
 
    /*------------------------------------------------------------------------*/
-   /* Create handle for process (same as process id)...                      */
+   /* Take process structure and stack from the pool, else allocate them...  */
    /*------------------------------------------------------------------------*/
 
-   if ((Pid = OsHandCreate(&ProcessAnchor, (void *) pptr)) == SYSERR)  {
-   	OsFree(pptr);                    /* Free process structure, can't use. */
-   	return(SYSERR);                  /* Can't create process due to handle.*/
+   OsDisable();
+   Reap();                             /* Recycle what was killed.           */
+   pptr = PoolGet(Class);
+   OsEnable();
+
+   if (pptr == NULL) {
+      if ((pptr = (PROCESS *) OsAlloc(sizeof(PROCESS))) == NULL ||
+          (pptr->Base = (BYTE *) OsAlloc(ssize)) == NULL) {
+         OsFree(pptr);                 /* Free process structure, can't use. */
+         BoxFree(Box);                 /* Nor the ring.                      */
+         return(SYSERR);               /* Can't create process, no stack.    */
+      }
+      pptr->StkLen = ssize;
    }
 
+   pptr->Box = Box;                    /* Before the Pid can be found.       */
+
    /*------------------------------------------------------------------------*/
-   /* Allocate a stack for process...                                        */
+   /* Create handle for process (same as process id)...                      */
    /*------------------------------------------------------------------------*/
 
-   if ( (stk = (USHORT *) OsAlloc(ssize)) == NULL) {   /* Allocate stack.    */
-   	OsFree(pptr);                    /* Free process structure, can't use. */
-   	OsHandUnprotect(ProcessAnchor, Pid);
-   	OsHandDestroy(  ProcessAnchor, Pid);
-   	return(SYSERR);                  /* Can't create process, no stack.    */
+   if ((Pid = OsHandCreate(&ProcessAnchor, (void *) pptr)) == SYSERR)  {
+      OsDisable();
+      pptr->Box = NULL;
+      BoxFree(Box);
+      PoolPut(pptr);                   /* Keep for next time, can't use.     */
+      OsEnable();
+   	return(SYSERR);                  /* Can't create process due to handle.*/
    }
 
 
@@ -99,17 +145,24 @@ HANDLE  OsCreate(
    strncpy(pptr->Name, name, PNMLEN);  /* Process' name.                     */
    pptr->Name[PNMLEN - 1] = '\0';      /* Assure null termination.           */
    pptr->Prio   = priority;            /* Process priority.                  */
-   pptr->Base   = (BYTE *) stk;        /* Base (bottom) of stack.            */
-   pptr->StkLen = ssize;               /* Size of stack.                     */
+   pptr->BasePrio = priority;          /* Priority without inheritance.      */
    pptr->State  = PRSUSP;              /* Make it look suspended for OsReady.*/
-
-   ((BYTE *) stk) += ssize;            /* Position stack pointer.            */
-
+#if defined(OS_SMP)
+   pptr->Cpu    = OsCpu()->Id;         /* Starts on creator's CPU.           */
+#endif
 
    /*------------------------------------------------------------------------*/
    /*************** BEGINNING OF IMPLEMENATION SPECIFIC CODE *****************/
    /*------------------------------------------------------------------------*/
 
+#if defined(OS_HOSTED)
+
+   pptr->Stack = OsHostFrame(pptr->Base, ssize, procaddr, data);
+
+#else
+
+   stk = (USHORT *) (pptr->Base + ssize);    /* Position stack pointer.      */
+
    *--stk    = (USHORT) FP_SEG(data);
    *--stk    = (USHORT) FP_OFF(data);
 
@@ -136,6 +189,8 @@ HANDLE  OsCreate(
 
    pptr->Stack = (BYTE *) stk;
 
+#endif
+
    /*------------------------------------------------------------------------*/
    /**************** END OF IMPLEMENATION SPECIFIC CODE **********************/
    /*------------------------------------------------------------------------*/
@@ -162,48 +217,62 @@ int  OsSched( void )
 {
    register PROCESS *cptr;             /* Currently running process.         */
    register PROCESS *tptr;             /* Top process in ready queue.        */
-   register PROCESS *nptr;             /* Next process in ready queue.       */
 
 
    OsDisable();                        /* Disable interrupts.                */
 
+   Resched = 0;                        /* Any preemption request is served.  */
+
+#if defined(OS_SMP)
+   OsSmpPending();                     /* Killed or suspended by other CPU?  */
+#endif
+
    /*------------------------------------------------------------------------*/
    /* First, go do sleeper check to see if any sleepers have expired...      */
    /*------------------------------------------------------------------------*/
 
    OsSleepCheck();                     /* Check for any expired sleepers.    */
 
+#if defined(OS_SMP)
+   OsSmpSteal();                       /* Pull in better work from others.   */
+#endif
+
    /*------------------------------------------------------------------------*/
    /* Get first process in ready chain. If there are none (normaly the low-  */
    /* est prior task is always runnable) then loop until there is a process. */
    /*------------------------------------------------------------------------*/
 
-   while ((tptr = ChainFirst(&ReadyAnchor)) == NULL) {
-      enable();                        /* Open a window for interrupts.      */
-      disable();                       /* Maybe an isr will ready a task.    */
+   while ((tptr = PrioFirst(&ReadyQueue)) == NULL) {
+      IdleWait();                      /* Wait for interrupt or sleeper due. */
+      OsSleepCheck();
+#if defined(OS_SMP)
+      OsSmpSteal();
+#endif
    }
-
-   nptr = ChainNext( &tptr->Link );    /* Get second process in ready queue. */
+   Resched = 0;                        /* Kicks that woke us are served too. */
 
 
    /*------------------------------------------------------------------------*/
    /* No context switch is needed if highest priority process is the         */
    /* currently running process, and there are no others with same priority. */
+   /* Otherwise move it to the end of its priority level (round robin)...    */
    /*------------------------------------------------------------------------*/
 
-   if (tptr->Pid == CurrPid) {         /* If current one is top of queue...  */
-
-      if (nptr != NULL) {              /* Are there more in the ready queue? */
-         if (tptr->Prio == nptr->Prio) { /* And, does it have same priority? */
+   if (tptr->Pid == CurrPid &&         /* If current one is top of queue...  */
+       ChainNext(&tptr->Link) != NULL) {  /* and others at same priority?    */
 
-            ChainPop( &ReadyAnchor );  /* Pop off currently running process. */
-            OsReady( tptr->Pid );      /* Reschedule current one for later.  */
-            tptr = nptr;               /* Now make next one the top of queue.*/
-         }
-      }
+      PrioUnchain(&ReadyQueue, &tptr->Link, tptr->Prio);
+      PrioChain(  &ReadyQueue, &tptr->Link, tptr->Prio);
+      tptr = PrioFirst(&ReadyQueue);   /* Now next one is top of queue.      */
    }
 
+   SliceTicks = Quantum[tptr->Prio];   /* Start a new time slice.            */
+#if defined(OS_SMP)
+   OsCpu()->Prio = tptr->Prio;         /* Others look at this to kick us.    */
+#endif
+
    if (tptr->Pid == CurrPid) {         /* If current one is top of queue...  */
+      tptr->State = PRCURR;            /* May have been readied while running*/
       OsEnable();                      /* Enable interrupts.                 */
       return (SYSOK);                  /* Return.                            */
    }
@@ -213,7 +282,7 @@ int  OsSched( void )
    /* Now, if current process is still eligable, make it ready...            */
    /*------------------------------------------------------------------------*/
 
-   cptr = (PROCESS *) OsHandFind(ProcessAnchor, CurrPid);  /* Get curr proc. */
+   cptr = CurrProc;                    /* Get current process.               */
 
    cptr->Disable = DisableCount;       /* Save disable count.                */
 
@@ -225,7 +294,8 @@ int  OsSched( void )
    /* Now, switch context to new process...                                  */
    /*------------------------------------------------------------------------*/
 
-   CurrPid = tptr->Pid;                /* Save current process id.           */
+   CurrPid  = tptr->Pid;               /* Save current process id.           */
+   CurrProc = tptr;                    /* And its process structure.         */
    tptr->State = PRCURR;               /* Make top on current one.           */
 
    DisableCount = tptr->Disable;       /* New disable count.                 */
@@ -235,19 +305,316 @@ int  OsSched( void )
 
    /*------------------------------------------------------------------------*/
    /* The resumed process picks up here. (If it was a new task, then         */
-   /* OsSwitch() does not return, but instead goes directly to new task.)... */
-   /* If there were any killed processes, then free them now...              */
+   /* OsSwitch() does not return, but instead goes directly to new task.)    */
+   /* Killed processes are recycled later by OsCreate(), OsKill() and        */
+   /* OsIdle(), not here...                                                  */
    /*------------------------------------------------------------------------*/
 
-   while ((cptr = ChainPop( &KilledAnchor )) != NULL) {
-      OsHandDestroy(ProcessAnchor, cptr->Pid); /* Destroy handle (Pid).      */
-      OsFree( cptr->Base );            /* Free killed proc's stack.          */
-      OsFree( cptr );                  /* Free killed proc's structure.      */
+   OsEnable();                         /* Enable interrupts.                 */
+
+   return (SYSOK);                     /* Return to new process.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsHandoff() -- Called disabled. Switch straight to process To, waiting or */
+/* ready, without going through the scheduler: it goes to the front of its   */
+/* priority level and runs on what is left of the current time slice. If     */
+/* something more urgent is ready, To is just readied and OsSched() picks... */
+/*---------------------------------------------------------------------------*/
+
+int  OsHandoff( PROCESS *To )
+
+{
+   register PROCESS *cptr;             /* Currently running process.         */
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   cptr = CurrProc;                    /* Get current process.               */
+
+   if ((ReadyQueue.Map && PrioHigh(ReadyQueue.Map) > To->Prio)
+#if defined(OS_SMP)
+       || (cptr->Flags & (PROCESS_KILLED | PROCESS_STOPPED))
+#endif
+       ) {
+      if (To->State != PRREADY)
+         OsReady(To->Pid);             /* Let the scheduler decide.          */
+      OsSched();
+      OsEnable();
+      return (SYSOK);
    }
 
+   if (To->State == PRREADY)           /* Off its place in the queue.        */
+      PrioUnchain(ReadyQ(To), &To->Link, To->Prio);
+
+#if defined(OS_SMP)
+   To->Cpu = OsCpu()->Id;              /* Runs here now.                     */
+   OsCpu()->Prio = To->Prio;
+#endif
+   PrioPush(&ReadyQueue, &To->Link, To->Prio);   /* Top of the queue.        */
+
+   cptr->Disable = DisableCount;       /* Save disable count.                */
+
+   if (cptr->State == PRCURR)          /* Make it ready for next time.       */
+      cptr->State = PRREADY;
+
+   CurrPid  = To->Pid;                 /* Save current process id.           */
+   CurrProc = To;                      /* And its process structure.         */
+   To->State = PRCURR;                 /* Make it the current one.           */
+
+   DisableCount = To->Disable;         /* New disable count.                 */
+
+   OsSwitch(&cptr->Stack, &To->Stack);                   /* Switch context.  */
+
    OsEnable();                         /* Enable interrupts.                 */
 
-   return (SYSOK);                     /* Return to new process.             */
+   return (SYSOK);                     /* Return to this process.            */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsIdle() -- Main line of a process with nothing to do, e.g. INIT. Run     */
+/* anything else that is ready; if there is nothing, wait for an interrupt   */
+/* or the next sleeper instead of spinning in OsSched()...                   */
+/*---------------------------------------------------------------------------*/
+
+int  OsIdle( void )
+{
+   PROCESS *pptr;
+
+   OsSched();                          /* Let others run first.              */
+
+   OsDisable();
+
+   Reap();                             /* Recycle killed processes.          */
+
+   pptr = CurrProc;
+
+   if (ReadyQueue.Map == ((ULONG) 1 << pptr->Prio) &&   /* Only us ready?    */
+       ChainNext(&pptr->Link) == NULL && !Resched) {
+      IdleWait();
+      OsEnable();
+      OsSched();                       /* Run whatever the interrupt readied.*/
+      return SYSOK;
+   }
+
+   OsEnable();
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* IdleWait() -- Called disabled when there is nothing to run. Stop the CPU  */
+/* until an interrupt comes in, and run its isr...                           */
+/*---------------------------------------------------------------------------*/
+
+static void IdleWait( void )
+{
+#if defined(OS_SMP)
+   OsSmpIdle();                        /* Let others in, wait for interrupt. */
+#elif defined(OS_HOSTED)
+   OsHostIdle(OsSleepNext());          /* Host timer only for next sleeper.  */
+   enable();                           /* Take the interrupt that woke us.   */
+   disable();
+#else
+   __emit__(0xFB, 0xF4);               /* STI; HLT. Interrupt can't slip in  */
+   disable();                          /* between them.                      */
+#endif
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsQuantum() -- Set time slice, in timer ticks, for processes running at a */
+/* priority. The timer preempts such a process when its slice runs out, or   */
+/* when a sleeper comes due. Zero means run until it gives up the CPU...     */
+/*---------------------------------------------------------------------------*/
+
+int  OsQuantum( int Prio, int Ticks )
+{
+   if (Prio < 0 || Prio >= NPRIO || Ticks < 0)
+      return SYSERR;
+
+   OsDisable();
+   Quantum[Prio] = Ticks;
+   OsEnable();
+
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsProcPool() -- Keep up to Max killed processes with stacks of SSize for  */
+/* reuse by OsCreate(), and fill the pool up to Max now so creating that     */
+/* many needs no allocation. Stacks are pooled by size class, powers of two  */
+/* from MIN_STACK_SIZE; OsCreate() rounds a stack up to its class...         */
+/*---------------------------------------------------------------------------*/
+
+int  OsProcPool( int SSize, int Max )
+{
+   PROCESS *pptr;
+   int      Class;
+
+   if (SSize < MIN_STACK_SIZE)
+      SSize = MIN_STACK_SIZE;
+
+   if (Max < 0 || (Class = PoolClass(SSize)) < 0)
+      return SYSERR;
+
+   SSize = MIN_STACK_SIZE << Class;
+
+   OsDisable();
+
+   PoolMax[Class] = Max;
+
+   while (PoolCount[Class] > Max) {    /* Shrink...                          */
+      pptr = (PROCESS *) ChainPop(&ProcPool[Class]);
+      PoolCount[Class]--;
+      OsFree(pptr->Base);
+      OsFree(pptr);
+   }
+
+   while (PoolCount[Class] < Max) {    /* ...or fill.                        */
+      if ((pptr = (PROCESS *) OsAlloc(sizeof(PROCESS))) == NULL)
+         break;
+      if ((pptr->Base = (BYTE *) OsAlloc(SSize)) == NULL) {
+         OsFree(pptr);
+         break;
+      }
+      pptr->StkLen = SSize;
+      PoolPut(pptr);
+   }
+
+   OsEnable();
+
+   return PoolCount[Class] == Max ? SYSOK : SYSERR;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* Reap() -- Called disabled. Retire the Pids of killed processes, so they   */
+/* go in the pool once no one has them, unless one is still on its way out   */
+/* on some CPU...                                                            */
+/*---------------------------------------------------------------------------*/
+
+static void Reap( void )
+{
+   PROCESS *pptr;
+   PROCESS *Next;
+
+   for (pptr = ChainFirst(&KilledAnchor); pptr != NULL; pptr = Next) {
+      Next = ChainNext(&pptr->Link);
+      if (OsRunning(pptr))
+         continue;
+      Unchain(&KilledAnchor, &pptr->Link);
+      OsHandRetire(ProcessAnchor, pptr->Pid, ReapFree);  /* Pool it when     */
+                                                         /* no one has Pid.  */
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* ReapFree() -- Called disabled, when no one protects the Pid of a reaped   */
+/* process any more...                                                       */
+/*---------------------------------------------------------------------------*/
+
+static int ReapFree( void *Process )
+{
+   PROCESS *pptr = (PROCESS *) Process;
+
+   if (pptr->Box) {                    /* Free what is left in its ring.     */
+      OsMboxDelete(pptr->Box);
+      pptr->Box = NULL;
+   }
+   PoolPut(pptr);
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* BoxFree() -- Free the mailbox ring of a process that could not be made... */
+/*---------------------------------------------------------------------------*/
+
+static void BoxFree( MSGBOX *Box )
+{
+   if (Box) {
+      OsMboxKill(Box);
+      OsMboxDelete(Box);
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PoolClass() -- Pool size class for a stack size, or -1 if too big...      */
+/*---------------------------------------------------------------------------*/
+
+static int PoolClass( int Size )
+{
+   int   i;
+
+   for (i = 0; i < NPOOL; i++)
+      if (Size <= (MIN_STACK_SIZE << i))
+         return i;
+
+   return -1;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PoolGet() -- Called disabled. Take a process structure and its stack out  */
+/* of the pool, cleared except for the stack. NULL if there is none...       */
+/*---------------------------------------------------------------------------*/
+
+static PROCESS *PoolGet( int Class )
+{
+   PROCESS *pptr;
+   BYTE    *Base;
+   ULONG    StkLen;
+
+   if (Class < 0 || (pptr = ChainPop(&ProcPool[Class])) == NULL)
+      return NULL;
+
+   PoolCount[Class]--;
+
+   Base   = pptr->Base;
+   StkLen = pptr->StkLen;
+   memset(pptr, 0, sizeof(PROCESS));
+   pptr->Base   = Base;
+   pptr->StkLen = StkLen;
+
+   return pptr;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* PoolPut() -- Called disabled. Keep a dead process structure and stack in  */
+/* the pool, or free them if the pool for their size is full...              */
+/*---------------------------------------------------------------------------*/
+
+static void PoolPut( PROCESS *pptr )
+{
+   int   Class = PoolClass((int) pptr->StkLen);
+
+   if (Class >= 0 && pptr->StkLen == (ULONG) (MIN_STACK_SIZE << Class) &&
+       PoolCount[Class] < PoolMax[Class]) {
+      ChainInit(&pptr->Link, pptr);
+      ChainPush(&ProcPool[Class], &pptr->Link);  /* Last in is warmest.      */
+      PoolCount[Class]++;
+      return;
+   }
+
+   OsFree(pptr->Base);                 /* Free killed proc's stack.          */
+   OsFree(pptr);                       /* Free killed proc's structure.      */
 }
 
 
@@ -285,39 +652,74 @@ int  OsKill( HANDLE Pid )
    State = pptr->State;                /* Save current state of process.     */
 
    if(pptr->Flags & PROCESS_CANT_KILL) /* Can we kill this process?          */
-      if (Pid != CurrPid)              /* Only if it's the current process.  */
+      if (Pid != CurrPid) {            /* Only if it's the current process.  */
+         OsEnable();
          return SYSERR;                /* Otherwise, it's an error.          */
+      }
 
 
-   switch (State)  {                   /* Depending on current state...      */
+#if defined(OS_SMP)
+   if (State == PRCURR && Pid != CurrPid) {  /* Running on another CPU?      */
+      pptr->Flags |= PROCESS_KILLED;   /* It goes when it next schedules.    */
+      OsSmpKick(pptr->Cpu);
+      OsEnable();
+      return SYSOK;
+   }
+#endif
 
-      case PRSLEEP:                    /* Process is sleeping on event.      */
-         OsAwake(Pid);                 /* First wake process up.             */
+   OsTimerStop(pptr);                  /* Off event chain, if sleeping or    */
+                                       /* in a timed wait.                   */
+   switch (State)  {                   /* Depending on current state...      */
 
       case PRCURR:                     /* This is the currently running proc.*/
       case PRREADY:                    /* Process is ready to run.           */
-         Unchain(&ReadyAnchor, &pptr->Link);   /* Remove from ready queue.   */
+         PrioUnchain(ReadyQ(pptr), &pptr->Link, pptr->Prio); /* Off ready q. */
          break;
 
       case PRWAIT:                     /* Process waiting on semaphore.      */
-         /* SemTab[pptr->Sem].SemCnt++; */
+         OsSemCancel(pptr);            /* Off it, give back its count.       */
+         break;
+
+      case PRSEND:                     /* Its message stays queued, but no   */
+         *pptr->Sending = 0;           /* one is to be readied for it.       */
+         break;
+
+      case PRMULTI:                    /* Process in OsWaitAny/All().        */
+         OsWatchCancel(pptr);          /* Take its watches down.             */
+         break;
+
+      case PREVENT:                    /* Process waiting on event flags.    */
+         OsEventCancel(pptr);          /* Off its group.                     */
+         break;
+
+      case PRPORT:                     /* Process waiting on a port.         */
+         OsPortCancel(pptr);           /* Off its queue.                     */
+         break;
 
       default:
          break;
    }
 
+   OsLockKill(pptr);                   /* Off lock waited for, pass on held. */
+
    NumProc--;                          /* Count of created processes.        */
    pptr->State = PRKILL;               /* Put process in killed state.       */
    ChainPush( &KilledAnchor, &pptr->Link); /* Free stack & proc later.     */
 
+   if (pptr->Box)                      /* Ready senders waiting on its ring. */
+      OsMboxKill(pptr->Box);
+
+   OsMsgCallKill(pptr);                /* End its calls, and calls to it.    */
+
    while ((Msg = ChainPop(&pptr->Msgs)) != NULL) {
-      if (Msg->Data != NULL)           /* Does data need to be free'd?       */
-         OsFree(Msg->Data);
       if (Msg->Pid > 0)                /* Is there a waiter waiting for msg? */
          OsReady(Msg->Pid);
-      OsFree(Msg);                     /* Free message structure.            */
+      OsMsgDrop(Msg);                  /* Free message and its data.         */
    }
 
+   if (State != PRCURR)                /* Not on its own stack, recycle now. */
+      Reap();
+
    OsEnable();                         /* Enable interrupts again.           */
 
    if (State == PRCURR)                /* This was current process...        */
@@ -350,7 +752,6 @@ int  OsReady( HANDLE Pid )
 
 {
    PROCESS *pptr;
-   PROCESS *p, *q;
 
    OsDisable();                        /* Disable interupts while chaining.  */
 
@@ -380,22 +781,14 @@ int  OsReady( HANDLE Pid )
 
 
    /*------------------------------------------------------------------------*/
-   /* Add process to ready queue in priority order...                        */
+   /* Add process to end of its priority level in the ready queue...         */
    /*------------------------------------------------------------------------*/
 
-   p = ChainFirst( &ReadyAnchor );     /* Get first in chain.                */
-   q = NULL;                           /* Reset previous pointer.            */
-   while (p) {
-      if ( pptr->Prio > p->Prio )      /* Insert before p process?           */
-         break;                        /* Yes...                             */
-      q = p;                           /* No. Save current as previous.      */
-      p = ChainNext( &p->Link );       /* Point to next on chain.            */
-   }
+   PrioChain( ReadyQ(pptr), &pptr->Link, pptr->Prio);
 
-   if (q)                              /* Are we following another one?      */
-      Chain( &ReadyAnchor, &q->Link, &pptr->Link);
-   else                                /* Insert at top of chain.            */
-      Chain( &ReadyAnchor, NULL,     &pptr->Link);
+#if defined(OS_SMP)
+   OsSmpReady(pptr);                   /* Get a CPU to run it.               */
+#endif
 
    OsEnable();                         /* Enable interrupts now.             */
 
@@ -442,7 +835,7 @@ int  OsResume( HANDLE Pid )
 int  OsSuspend( HANDLE Pid )
 
 {
-   PROCESS *pptr, *p, *q;
+   PROCESS *pptr;
    int      State;
 
    OsDisable();                        /* Disable interrupts.                */
@@ -460,7 +853,16 @@ int  OsSuspend( HANDLE Pid )
       return SYSERR;                   /* Then error.                        */
    }
 
-   Unchain(&ReadyAnchor, &pptr->Link); /* Remove from ready queue.           */
+#if defined(OS_SMP)
+   if (State == PRCURR && Pid != CurrPid) {  /* Running on another CPU?      */
+      pptr->Flags |= PROCESS_STOPPED;  /* It stops when it next schedules.   */
+      OsSmpKick(pptr->Cpu);
+      OsEnable();
+      return SYSOK;
+   }
+#endif
+
+   PrioUnchain(ReadyQ(pptr), &pptr->Link, pptr->Prio); /* Off ready queue.   */
 
    pptr->State = PRSUSP;               /* Mark process as suspended.         */
 
@@ -472,4 +874,35 @@ int  OsSuspend( HANDLE Pid )
    return SYSOK;                       /* Return with good return code.      */
 }
 
-
\ No newline at end of file
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSuspendTimeout() -- Suspend the current process until OsResume(), or    */
+/* until Hundreds of a second have gone by (-1 for no limit). Returns        */
+/* SYSTIMEOUT if it was not resumed in time...                               */
+/*---------------------------------------------------------------------------*/
+
+int  OsSuspendTimeout( long Hundreds )
+
+{
+   PROCESS *pptr;
+   int      rc;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   pptr = CurrProc;
+
+   if (OsTimerStart(pptr, Hundreds) != SYSOK) {  /* Give up when it is due.  */
+      OsEnable();
+      return SYSERR;
+   }
+
+   PrioUnchain(ReadyQ(pptr), &pptr->Link, pptr->Prio); /* Off ready queue.   */
+   pptr->State = PRSUSP;               /* Mark process as suspended.         */
+
+   OsSched();                          /* Reschedule processes.              */
+   rc = OsTimerStop(pptr);
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;                          /* Return SYSOK or SYSTIMEOUT.        */
+}
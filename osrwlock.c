@@ -0,0 +1,259 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSRWLOCK.C                                            */
+/*                                                                           */
+/*             Title:  Reader-writer locks.                                  */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsRwCreate() - Sets up a reader-writer lock.          */
+/*                     OsRwDelete() - Deletes a reader-writer lock.          */
+/*                     OsRwRead()   - Locks for reading (shared).            */
+/*                     OsRwWrite()  - Locks for writing (exclusive).         */
+/*                     OsRwUnlock() - Unlocks either.                        */
+/*                                                                           */
+/*                     The lock lives in the caller's RWLOCK, like a         */
+/*                     FASTSEM. Its State word holds the number of readers,  */
+/*                     RW_WRITER while a writer has it, and RW_WAITING while */
+/*                     anyone waits. Locking and unlocking change it with    */
+/*                     one compare-and-swap and do not enter the kernel      */
+/*                     unless someone has to wait or be woken, so readers    */
+/*                     on several CPUs do not serialize on the kernel lock.  */
+/*                                                                           */
+/*                     Waiters wait on one of two semaphores in the RWLOCK.  */
+/*                     When the lock comes free it is handed over, to one    */
+/*                     writer or to all waiting readers at once, before they */
+/*                     are posted. Readers go first unless the lock was      */
+/*                     created with OS_RW_WRITERS; then a waiting writer     */
+/*                     also keeps new readers out, so writers can not be     */
+/*                     starved by a steady stream of readers.                */
+/*                                                                           */
+/*                     Who waits is read off the semaphores' counts, under   */
+/*                     the kernel lock, when the lock is handed over. A      */
+/*                     waiter that is killed has given its count back, so    */
+/*                     it is never handed the lock; one killed once handed   */
+/*                     the lock dies holding it, as with OsLock().           */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+#include "osatomic.h"
+
+
+#define  RW_WRITER     0x40000000L     /* A writer holds it.                 */
+#define  RW_WAITING    0x20000000L     /* Someone waits, take slow paths.    */
+                                       /* Below these, count of readers.     */
+
+
+static int  RwWaiters( HANDLE Sem );
+static void RwPass(    RWLOCK *Rw );
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsRwCreate() -- Set up a reader-writer lock, unlocked. Options is 0, or   */
+/* OS_RW_WRITERS to prefer writers...                                        */
+/*---------------------------------------------------------------------------*/
+
+int   OsRwCreate(RWLOCK *Rw, int Options)
+{
+   if ((Rw->ReadSem = OsSemCreate(0)) == SYSERR)
+      return SYSERR;                   /* Can not allocate any more.         */
+
+   if ((Rw->WriteSem = OsSemCreate(0)) == SYSERR) {
+      OsSemDelete(Rw->ReadSem);
+      return SYSERR;
+   }
+
+   Rw->State     = 0;
+   Rw->Options   = Options;
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsRwDelete() -- Delete a reader-writer lock no one holds or waits for...  */
+/*---------------------------------------------------------------------------*/
+
+int   OsRwDelete(RWLOCK *Rw)
+{
+   OsSemDelete(Rw->ReadSem);
+   return OsSemDelete(Rw->WriteSem);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsRwRead() -- Lock for reading, along with any other readers...           */
+/*---------------------------------------------------------------------------*/
+
+int   OsRwRead(RWLOCK *Rw)
+{
+   ULONG    State;
+   int      rc = SYSOK;
+
+   State = OsAtomicLoad(&Rw->State);   /* Fast path: no writer, no waiters.  */
+   if (!(State & (RW_WRITER | RW_WAITING)) &&
+       OsAtomicCas(&Rw->State, &State, State + 1))
+      return SYSOK;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   for (;;) {
+      State = OsAtomicLoad(&Rw->State);
+
+      if (!(State & RW_WRITER) &&      /* Can come in?                       */
+          !((Rw->Options & OS_RW_WRITERS) && RwWaiters(Rw->WriteSem))) {
+         if (OsAtomicCas(&Rw->State, &State, State + 1))
+            break;
+         continue;
+      }
+
+      if (OsAtomicCas(&Rw->State, &State, State | RW_WAITING)) {
+         rc = OsWait(Rw->ReadSem);     /* Back when handed to us.            */
+         break;
+      }
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsRwWrite() -- Lock for writing, alone...                                 */
+/*---------------------------------------------------------------------------*/
+
+int   OsRwWrite(RWLOCK *Rw)
+{
+   ULONG    State = 0;
+   int      rc = SYSOK;
+
+   if (OsAtomicCas(&Rw->State, &State, RW_WRITER))
+      return SYSOK;                    /* Fast path: it was free.            */
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   for (;;) {
+      State = OsAtomicLoad(&Rw->State);
+
+      if ((State & ~RW_WAITING) == 0) {   /* Free?                           */
+         if (OsAtomicCas(&Rw->State, &State, State | RW_WRITER))
+            break;
+         continue;
+      }
+
+      if (OsAtomicCas(&Rw->State, &State, State | RW_WAITING)) {
+         rc = OsWait(Rw->WriteSem);    /* Back when handed to us.            */
+         break;
+      }
+   }
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsRwUnlock() -- Unlock, as reader or writer. The last one out hands the   */
+/* lock to whoever waits...                                                  */
+/*---------------------------------------------------------------------------*/
+
+int   OsRwUnlock(RWLOCK *Rw)
+{
+   ULONG    State, New;
+
+   State = OsAtomicLoad(&Rw->State);   /* Fast path: no one waits.           */
+   if (!(State & RW_WAITING)) {
+      New = State & RW_WRITER ? 0 : State - 1;
+      if (OsAtomicCas(&Rw->State, &State, New))
+         return SYSOK;
+   }
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   do {
+      State = OsAtomicLoad(&Rw->State);
+      New   = State & RW_WRITER ? State & ~RW_WRITER : State - 1;
+   } while (!OsAtomicCas(&Rw->State, &State, New));
+
+   if ((New & ~RW_WAITING) == 0)       /* Last one out?                      */
+      RwPass(Rw);
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* RwWaiters() -- Called disabled. Number of processes waiting on one of the */
+/* lock's semaphores, those killed or given up already not counted...        */
+/*---------------------------------------------------------------------------*/
+
+static int RwWaiters( HANDLE Sem )
+{
+   SEMAPHORE *S;
+
+   if ((S = (SEMAPHORE *) OsHandFind(SemaphoreAnchor, Sem)) == NULL ||
+       S->Count >= 0)
+      return 0;
+   return -S->Count;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* RwPass() -- Called disabled when the lock is free. Hand it to a writer    */
+/* or to all readers waiting, and post them. If no one waits any more, just  */
+/* clear RW_WAITING...                                                       */
+/*---------------------------------------------------------------------------*/
+
+static void RwPass( RWLOCK *Rw )
+{
+   ULONG    State;
+   int      Readers, Writers;
+
+   Readers = RwWaiters(Rw->ReadSem);
+   Writers = RwWaiters(Rw->WriteSem);
+
+   if (Readers == 0 && Writers == 0) {    /* Waiters are gone: let the fast  */
+      State = OsAtomicLoad(&Rw->State);   /* paths back in, unless they have */
+      if (State == RW_WAITING)            /* it by now.                      */
+         OsAtomicCas(&Rw->State, &State, 0);
+      return;
+   }
+
+   if (Writers &&                      /* Writer next?                       */
+       (Readers == 0 || (Rw->Options & OS_RW_WRITERS))) {
+      State = RW_WRITER;
+      if (Readers || Writers > 1)      /* Still someone waiting?             */
+         State |= RW_WAITING;
+      Readers = 0;
+   } else {
+      State = Readers;
+      if (Writers)
+         State |= RW_WAITING;
+   }
+
+   OsAtomicStore(&Rw->State, State);   /* Fast paths stay out while anyone   */
+                                       /* waits, so no one else changed it.  */
+   if (State & RW_WRITER)
+      OsPost(Rw->WriteSem);
+   else
+      while (Readers--)
+         OsPost(Rw->ReadSem);
+}
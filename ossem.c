@@ -15,7 +15,14 @@
 /*                     OsSemCreate() - Creates a semaphore.                  */
 /*                     OsSemDelete() - Deletes a semaphore.                  */
 /*                     OsSemWait()   - Waits for a semaphore to be posted.   */
+/*                     OsWaitTimeout() - Waits, for a while at most.         */
 /*                     OsSemPost()   - Posts a semaphore.                    */
+/*                     OsFastSemCreate() - Sets up a fast semaphore.         */
+/*                     OsFastSemDelete() - Deletes a fast semaphore.         */
+/*                     OsFastWait()  - Waits on a fast semaphore.            */
+/*                     OsFastPost()  - Posts a fast semaphore.               */
+/*                     OsSemCancel() - Takes a waiter off its semaphore.     */
+/*                     OsSemOrder()  - Sets the order waiters are posted in. */
 /*                                                                           */
 /*                     These semaphores are counting semaphores. They are    */
 /*                     referenced by an interger handle. When a semaphore    */
@@ -25,6 +32,15 @@
 /*                     When a process posts a semaphore, the count is        */
 /*                     incremented, and if the count goes positive, then     */
 /*                     a waiting process will be allowed to run again.       */
+/*                     Waiters are posted in the order they came, or most    */
+/*                     urgent first once OsSemOrder() sets OS_ORDER_PRIO.    */
+/*                                                                           */
+/*                     A fast semaphore keeps its count in the caller's      */
+/*                     FASTSEM, changed atomically without a handle lookup   */
+/*                     or disabling. Only a wait that takes the count below  */
+/*                     0, or a post that brings it up from below 0, goes on  */
+/*                     to the kernel semaphore in it, which starts at 0 and  */
+/*                     so holds just the waiters.                            */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
@@ -33,14 +49,7 @@
 /*---------------------------------------------------------------------------*/
 
 #include "oskernel.h"
-
-
-
-/*---------------------------------------------------------------------------*/
-/* Static local routines in this module...                                   */
-/*---------------------------------------------------------------------------*/
-
-static int AllocSem( void );           /* Allocate next semaphore id.        */
+#include "osatomic.h"
 
 
 
@@ -92,6 +101,7 @@ int   OsSemDelete(HANDLE Sem)
 {
    SEMAPHORE *S;                       /* Pointer to semaphore structure.    */
    PROCESS   *P;                       /* Pointer to process structure.      */
+   WATCH     *W;                       /* OsWaitAny/All() watching it.       */
 
    OsDisable();                        /* Disable interrupts.                */
 
@@ -101,12 +111,16 @@ int   OsSemDelete(HANDLE Sem)
    }
 
 
-   P = ChainFirst( &S->WaitList );     /* Get first process waiting.         */
-   while (P) {                         /* While there are processes waiting, */
+   while ((P = WaitPop( &S->WaitList )) != NULL)   /* While processes wait,  */
       OsReady(P->Pid);                 /* Ready process.                     */
-      P = ChainNext( &P->Link );       /* Next process in chain.             */
+
+   while ((W = ChainPop( &S->Watchers )) != NULL) {
+      W->On = NULL;                    /* Watcher finds semaphore is gone.   */
+      OsReady(W->Proc->Pid);
    }
 
+   if (S->WaitList.Prio)
+      OsFree(S->WaitList.Prio);        /* Free priority queue, if any.       */
    OsFree(S);                          /* Free semaphore structure.          */
 
    OsEnable();                         /* Enable interrupts.                 */
@@ -122,9 +136,23 @@ int   OsSemDelete(HANDLE Sem)
 
 
 int   OsWait(HANDLE Sem)
+{
+   return OsWaitTimeout(Sem, -1L);     /* Wait as long as it takes.          */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsWaitTimeout() -- Same as OsWait(), but give up after Hundreds of a      */
+/*                    second (0 to not wait, -1 to wait forever). Returns    */
+/*                    SYSTIMEOUT if it gave up...                            */
+/*---------------------------------------------------------------------------*/
+
+int   OsWaitTimeout(HANDLE Sem, long Hundreds)
 {
    SEMAPHORE *S;                       /* Pointer to semaphore structure.    */
    PROCESS   *P;                       /* Pointer to process structure.      */
+   int        rc = SYSOK;
 
    OsDisable();                        /* Disable interrupts.                */
 
@@ -133,19 +161,31 @@ int   OsWait(HANDLE Sem)
       return SYSERR;                   /* Return with error.                 */
    }
 
+   if (S->Count <= 0 && Hundreds == 0) {
+      OsEnable();                      /* Would have to wait, but can't.     */
+      return SYSTIMEOUT;
+   }
+
+   if (S->Count <= 0 && OsTimerStart(CurrProc, Hundreds) != SYSOK) {
+      OsEnable();                      /* No memory for the timer, so no     */
+      return SYSERR;                   /* wait: it could never time out.     */
+   }
+
    /*------------------------------------------------------------------------*/
    /* If count is negative, then make current process wait...                */
    /*------------------------------------------------------------------------*/
    if ( --S->Count < 0 ) {                 /* Decrement count.               */
-      P = OsHandFind(ProcessAnchor, CurrPid);  /* Get current proc's struct. */
-      Unchain( &ReadyAnchor, &P->Link);    /* Remove process from ready chain*/
+      P = CurrProc;                        /* Get current proc's struct.     */
+      PrioUnchain( ReadyQ(P), &P->Link, P->Prio);  /* Off ready queue.  */
       P->State = PRWAIT;                   /* State is now "waiting".        */
-      ChainQueue( &S->WaitList, &P->Link); /* Queue onto semaphore.          */
+      P->Sem   = Sem;                      /* For OsSemCancel().             */
+      WaitChain( &S->WaitList, &P->Link, P->Prio);   /* Queue onto semaphore.*/
       OsSched();                           /* Now, let others run.           */
+      rc = OsTimerStop( P );
    }
 
    OsEnable();                         /* Enable interrupts.                 */
-   return SYSOK;                       /* Return with no errors.             */
+   return rc;                          /* Return SYSOK or SYSTIMEOUT.        */
 }
 
 
@@ -158,7 +198,6 @@ int   OsWait(HANDLE Sem)
 int   OsPost(HANDLE Sem)
 {
    SEMAPHORE *S;                       /* Pointer to semaphore structure.    */
-   PROCESS   *P;                       /* Pointer to process structure.      */
 
    OsDisable();                        /* Disable interrupts.                */
 
@@ -169,9 +208,120 @@ int   OsPost(HANDLE Sem)
 
    if ( S->Count++ < 0 )               /* If semaphore count is still neg.   */
                                        /* Ready top waiting process...       */
-      OsReady( ((PROCESS *) ChainPop( &S->WaitList ))->Pid );
+      OsReady( ((PROCESS *) WaitPop( &S->WaitList ))->Pid );
+   else if (ChainFirst( &S->Watchers ))   /* Else tell OsWaitAny/All().      */
+      OsWatchWake( &S->Watchers );
 
    OsEnable();                         /* Enable interrupts.                 */
    return SYSOK;                       /* Return with no errors.             */
 }
-
\ No newline at end of file
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSemCancel() -- Called disabled. Take a process off the semaphore it     */
+/*                  waits on, giving back the count its wait took...         */
+/*---------------------------------------------------------------------------*/
+
+void  OsSemCancel(PROCESS *P)
+{
+   SEMAPHORE *S;                       /* Pointer to semaphore structure.    */
+
+   if ((S = (SEMAPHORE *) OsHandFind(SemaphoreAnchor, P->Sem)) != NULL) {
+      WaitUnchain( &S->WaitList, &P->Link, P->Prio );
+      S->Count++;
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSemOrder() -- Set the order waiters are posted in: OS_ORDER_FIFO (the   */
+/*                 default) or OS_ORDER_PRIO. Only while no one waits...     */
+/*---------------------------------------------------------------------------*/
+
+int   OsSemOrder(HANDLE Sem, int Order)
+{
+   SEMAPHORE *S;                       /* Pointer to semaphore structure.    */
+   PRIOQ     *Q = NULL;
+
+   if (Order != OS_ORDER_FIFO && Order != OS_ORDER_PRIO)
+      return SYSERR;
+
+   if (Order == OS_ORDER_PRIO &&       /* Allocate before disabling.         */
+       (Q = (PRIOQ *) OsAlloc(sizeof(PRIOQ))) == NULL)
+      return SYSERR;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((S = (SEMAPHORE *) OsHandFind(SemaphoreAnchor, Sem)) == NULL ||
+       !WaitEmpty( &S->WaitList )) {
+      OsEnable();                      /* Gone, or would have to reorder.    */
+      if (Q)
+         OsFree(Q);
+      return SYSERR;
+   }
+
+   if (S->WaitList.Prio)               /* Drop the old priority queue.       */
+      OsFree(S->WaitList.Prio);
+   S->WaitList.Prio = Q;
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsFastSemCreate() -- Set up a fast semaphore, set count...                */
+/*---------------------------------------------------------------------------*/
+
+int   OsFastSemCreate(FASTSEM *Sem, int Count)
+{
+   if ((Sem->Sem = OsSemCreate(0)) == SYSERR)
+      return SYSERR;                   /* Can not allocate any more.         */
+
+   Sem->Count = Count;
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsFastSemDelete() -- Delete a fast semaphore, ready procs waiting...      */
+/*---------------------------------------------------------------------------*/
+
+int   OsFastSemDelete(FASTSEM *Sem)
+{
+   return OsSemDelete(Sem->Sem);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsFastWait() -- Decrement count, wait in the kernel only if it went       */
+/*                 below 0...                                                */
+/*---------------------------------------------------------------------------*/
+
+int   OsFastWait(FASTSEM *Sem)
+{
+   if ((long) OsAtomicAdd((ULONG *) &Sem->Count, -1) >= 0)
+      return SYSOK;                    /* Had a count, no need to wait.      */
+
+   return OsWait(Sem->Sem);            /* Wait for a post.                   */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsFastPost() -- Increment count, ready a waiter in the kernel only if it  */
+/*                 was below 0...                                            */
+/*---------------------------------------------------------------------------*/
+
+int   OsFastPost(FASTSEM *Sem)
+{
+   if ((long) OsAtomicAdd((ULONG *) &Sem->Count, 1) > 0)
+      return SYSOK;                    /* No one waiting.                    */
+
+   return OsPost(Sem->Sem);            /* Ready first waiter.                */
+}
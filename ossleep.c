@@ -15,9 +15,18 @@
 /*                     OsSleepInit()  - Initialize Sleep routines.           */
 /*                     OsSleepTerm()  - Terminate Sleep routines.            */
 /*                     OsSleepCheck() - Check for Sleep expirations.         */
+/*                     OsSleepNext()  - Time until next Sleep expiration.    */
 /*                     OsSleepReady() - Unsleep a sleeper.                   */
 /*                     OsSleep()      - Suspend a process for period of time.*/
+/*                     OsTimerStart() - Time out a process's wait.           */
+/*                     OsTimerStop()  - Stop timer, tell if it timed out.    */
 /*                                                                           */
+/*                     Sleepers and processes in a timed wait both have an   */
+/*                     event on EventAnchor, pointed to by Process->Timer.   */
+/*                     When a waiter's event comes due it is taken off the   */
+/*                     semaphore or lock it waits on, marked timed out and   */
+/*                     readied, all while disabled, so a post can not come   */
+/*                     in between.                                           */
 /*                                                                           */
 /*            Author:  John C. Overton                                       */
 /*                                                                           */
@@ -30,6 +39,7 @@
 
 static void interrupt (*Old_Timer_Vector)(void);
 static void interrupt TimerTick(void);
+static void           TimerExpire( EVENT *Event );
 
 
 
@@ -46,7 +56,11 @@ int   OsSleepInit(void)
    Old_Timer_Vector = getvect(0x08);   /* Get old timer tick vector address. */
    setvect(0x08, TimerTick);           /* Set our routine in its place.      */
 
+#if defined(OS_HOSTED)
+   OsHostClock(&Seconds, &Millisecs);  /* Start from host's time of day.     */
+#else
    Seconds = time(NULL);               /* Get current time value.            */
+#endif
 
    OsEnable();                         /* Enable interrupts.                 */
    return SYSOK;                       /* Return with no errors.             */
@@ -90,7 +104,7 @@ int   OsSleepCheck( void )
       if ( (Event->Seconds <  Seconds ) ||
            (Event->Seconds == Seconds && Event->Millisecs <= Millisecs) ) {
 
-         OsAwake( Event->Pid );        /* Put task in ready chain.           */
+         TimerExpire( Event );         /* Put task in ready chain.           */
 
       } else {
          break;
@@ -103,25 +117,113 @@ int   OsSleepCheck( void )
 
 
 
+/*---------------------------------------------------------------------------*/
+/* OsSleepNext() -- Called disabled when going idle. Returns millisecs until */
+/* first sleeper is due, 0 if one is due now, or -1 if no one is sleeping... */
+/*---------------------------------------------------------------------------*/
+
+long  OsSleepNext( void )
+{
+   EVENT  *Event;
+   long    Wait;
+
+   if ((Event = ChainFirst(&EventAnchor)) == NULL)
+      return -1;
+
+#if defined(OS_HOSTED)
+   OsHostClock(&Seconds, &Millisecs);  /* Clock may be a tick behind.        */
+#endif
+
+   Wait = (long) (Event->Seconds - Seconds) * 1000L +
+          ((long) Event->Millisecs - (long) Millisecs);
+
+   return Wait > 0 ? Wait : 0;
+}
+
+
+
 /*---------------------------------------------------------------------------*/
 /* OsSleep() -- Make process sleep for a period of time...                   */
 /*---------------------------------------------------------------------------*/
 
 int   OsSleep(long Hundreds)
 {
-   EVENT   *Event, *p, *q;
    PROCESS *Process;
 
 
    OsDisable();                        /* Disable interrupts.                */
 
-   Event = OsAlloc( sizeof(EVENT));    /* Allocate an event block.           */
+   Process = CurrProc;
+
+   if (OsTimerStart( Process, Hundreds ) != SYSOK) {   /* Event to wake us.  */
+      OsEnable();                      /* Out of memory, would never wake.   */
+      return SYSERR;
+   }
+
+   PrioUnchain( ReadyQ(Process), &Process->Link, Process->Prio); /* Off rdy.*/
+   Process->State = PRSLEEP;           /* Say process is sleeping.           */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   OsSched();
+
+   return SYSOK;                       /* Return with no errors.             */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsAwake() -- Wakeup a sleeper...                                          */
+/*---------------------------------------------------------------------------*/
+
+int   OsAwake(HANDLE Pid )
+{
+   PROCESS  *Process;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   if ((Process = OsHandFind(ProcessAnchor, Pid)) == NULL ||
+       (Process->State != PRSLEEP && Process->State != PRWAKING)) {
+      OsEnable();                      /* Enable interrupts.                 */
+      return SYSERR;                   /* Return, pid not sleeping.          */
+   }
+
+   OsTimerStop( Process );             /* Off event chain.                   */
+   Process->State = PRSUSP;            /* In-between state.                  */
+   OsReady( Pid );                     /* Put task in ready chain.           */
+
+   OsEnable();                         /* Enable interrupts.                 */
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsTimerStart() -- Called disabled. Queue an event for a process to come   */
+/* due in Hundreds of a second. Negative means never, so no event. SYSERR if */
+/* out of memory: the caller must not wait then, it would never time out...  */
+/*---------------------------------------------------------------------------*/
+
+int   OsTimerStart( PROCESS *Process, long Hundreds )
+{
+   EVENT   *Event, *p, *q;
+
+   Process->Flags &= ~PROCESS_TIMEDOUT;
+
+   if (Hundreds < 0)
+      return SYSOK;
+
+   if ((Event = OsAlloc(sizeof(EVENT))) == NULL)
+      return SYSERR;
+
    ChainInit( &Event->Link, Event );   /* Initialize link fields.            */
    Event->Seconds   = Seconds   + (Hundreds / 100);
    Event->Millisecs = Millisecs + ((Hundreds % 100) * 10);
-   Event->Pid       = CurrPid;         /* Save our pid.                      */
+   Event->Pid       = Process->Pid;    /* Save its pid.                      */
 
-   Process = OsHandProtect(ProcessAnchor, OsGetPid());
+   if (Event->Millisecs >= 1000) {     /* Carry into seconds.                */
+      Event->Millisecs -= 1000;
+      Event->Seconds++;
+   }
 
    p = ChainFirst( &EventAnchor );     /* Get first event in chain.          */
    q = NULL;
@@ -140,48 +242,92 @@ int   OsSleep(long Hundreds)
    else
       Chain( &EventAnchor, NULL,     &Event->Link );
 
-   Unchain( &ReadyAnchor, &(Process->Link)); /* Remove us from ready chain.  */
-   Process->State = PRSLEEP;           /* Say process is sleeping.           */
+   Process->Timer = Event;
+   return SYSOK;
+}
 
-   OsHandUnprotect(ProcessAnchor, Process->Pid);
 
-   OsEnable();                         /* Enable interrupts.                 */
-   OsSched();
 
-   return SYSOK;                       /* Return with no errors.             */
+/*---------------------------------------------------------------------------*/
+/* OsTimerStop() -- Called disabled. Take a process's event off the chain,   */
+/* if still on it. Returns SYSTIMEOUT if it came due and ended a wait...     */
+/*---------------------------------------------------------------------------*/
+
+int   OsTimerStop( PROCESS *Process )
+{
+   if (Process->Timer) {
+      Unchain( &EventAnchor, &Process->Timer->Link );
+      OsFree( Process->Timer );
+      Process->Timer = NULL;
+   }
+
+   if (Process->Flags & PROCESS_TIMEDOUT) {
+      Process->Flags &= ~PROCESS_TIMEDOUT;
+      return SYSTIMEOUT;
+   }
+
+   return SYSOK;
 }
 
 
 
 /*---------------------------------------------------------------------------*/
-/* OsAwake() -- Wakeup a sleeper...                                          */
+/* TimerExpire() -- Called disabled when an event comes due. Wake a sleeper, */
+/* or take a waiter off what it waits on and ready it, timed out...          */
 /*---------------------------------------------------------------------------*/
 
-int   OsAwake(HANDLE Pid )
+static void TimerExpire( EVENT *Event )
 {
-   EVENT    *Event;
    PROCESS  *Process;
 
-   OsDisable();                        /* Disable interrupts.                */
-   Event = ChainFirst( &EventAnchor ); /* Get first sleeper.                 */
-
-   while (Event) {
-      if (Event->Pid == Pid) {
-         Unchain( &EventAnchor, &Event->Link );
-         OsFree( Event );
-         Process = OsHandProtect(ProcessAnchor, Pid);
-         Process->State = PRSUSP;      /* In-between state.                  */
-         OsHandUnprotect(ProcessAnchor, Pid);
-         OsReady( Pid );               /* Put task in ready chain.           */
-         OsEnable();                   /* Enable interrupts.                 */
-         return SYSOK;
-      }
+   if ((Process = OsHandFind(ProcessAnchor, Event->Pid)) == NULL ||
+       Process->Timer != Event) {
+      Unchain( &EventAnchor, &Event->Link );   /* Stale, owner is gone.      */
+      OsFree( Event );
+      return;
+   }
 
-      Event = ChainNext( &Event->Link );
+   OsTimerStop( Process );
+
+   switch (Process->State) {
+
+      case PRSLEEP:                    /* Sleep is over.                     */
+         Process->State = PRSUSP;
+         OsReady( Process->Pid );
+         return;
+
+      case PRWAIT:                     /* Off semaphore.                     */
+         OsSemCancel( Process );
+         break;
+
+      case PRLOCK:                     /* Off lock's turnstile.              */
+         OsLockCancel( Process );
+         break;
+
+      case PRSEND:                     /* Off its message, which stays       */
+         *Process->Sending = 0;        /* queued to be received later.       */
+         break;
+
+      case PREVENT:                    /* Off event group.                   */
+         OsEventCancel( Process );
+         break;
+
+      case PRPORT:                     /* Off port.                          */
+         OsPortCancel( Process );
+         break;
+
+      case PRRECV:                     /* Nothing to take it off.            */
+      case PRSUSP:
+      case PRMULTI:                    /* Takes its own watches down.        */
+         break;
+
+      default:                         /* Woken already, hasn't run yet.     */
+         return;
    }
 
-   OsEnable();                         /* Enable interrupts.                 */
-   return SYSERR;                      /* Return, pid not found.             */
+   Process->Flags |= PROCESS_TIMEDOUT;
+   Process->State  = PRSUSP;
+   OsReady( Process->Pid );
 }
 
 
@@ -192,12 +338,34 @@ int   OsAwake(HANDLE Pid )
 
 static void interrupt TimerTick(void)
 {
+   EVENT  *Event;
+
    Old_Timer_Vector();
+   OsIntEnter();                       /* Tell OSKERNEL we're in an isr.     */
 
+#if defined(OS_HOSTED)
+   OsHostClock(&Seconds, &Millisecs);  /* Host keeps time of day for us.     */
+#else
    Millisecs += 55;
    if (Millisecs >= 990) {
       Seconds++;
       Millisecs = 0;
    }
+#endif
+
+   /*------------------------------------------------------------------------*/
+   /* If current process is time sliced, preempt it when its slice is used   */
+   /* up or a sleeper has come due...                                        */
+   /*------------------------------------------------------------------------*/
+
+   if (SliceTicks > 0) {
+      Event = ChainFirst(&EventAnchor);
+      if (--SliceTicks == 0 ||
+          (Event != NULL &&
+           (Event->Seconds <  Seconds ||
+            (Event->Seconds == Seconds && Event->Millisecs <= Millisecs))))
+         Resched = 1;
+   }
+
+   OsIntExit();                        /* May switch to another process.     */
 }
-
\ No newline at end of file
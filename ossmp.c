@@ -0,0 +1,300 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSSMP.C                                               */
+/*                                                                           */
+/*             Title:  Multiple CPU (OS_SMP) support.                        */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsSmpStart()   - Start more CPUs.                     */
+/*                     OsSmpCpu()     - Main line of an added CPU.           */
+/*                     OsSmpKick()    - Make a CPU reschedule.               */
+/*                     OsSmpReady()   - Find a CPU for a readied process.    */
+/*                     OsSmpSteal()   - Take ready work from other CPUs.     */
+/*                     OsSmpIdle()    - Wait for work.                       */
+/*                     OsSmpPending() - Kill or suspend asked by another CPU.*/
+/*                     OsCpu()        - State of CPU we are running on.      */
+/*                                                                           */
+/*                     Each CPU is a host thread with its own ready queue.   */
+/*                     A process stays on the queue of the CPU it last ran   */
+/*                     on; CPUs that have nothing better to run steal ready  */
+/*                     processes from the others. The kernel itself is       */
+/*                     serialized by the lock taken in OsDisable().          */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+
+#if defined(OS_SMP)
+
+
+/*---------------------------------------------------------------------------*/
+/* A process may be switched to a different host thread inside any call to   */
+/* OsSched(), so the compiler must never keep the address of ThisCpu across  */
+/* a call. Reading it only through an out of line function assures that...   */
+/*---------------------------------------------------------------------------*/
+
+#if defined(__clang__)
+#define  OUTOFLINE    __attribute__((noinline))
+#else
+#define  OUTOFLINE    __attribute__((noipa))
+#endif
+
+static __thread CPU *ThisCpu = &CpuTable[0];   /* CPU of this host thread.   */
+
+
+static void interrupt SmpKick( void ); /* Kick isr.                          */
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsCpu() -- Return state of CPU we are running on...                       */
+/*---------------------------------------------------------------------------*/
+
+OUTOFLINE CPU *OsCpu( void )
+{
+   return ThisCpu;
+}
+
+
+OUTOFLINE struct HostInt *OsHostInt( void )
+{
+   return &ThisCpu->Int;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpStart() -- Start CPUs until there are Cpus running. Returns number   */
+/* of CPUs running...                                                        */
+/*---------------------------------------------------------------------------*/
+
+int   OsSmpStart( int Cpus )
+{
+   int   i;
+
+   if (Cpus > NCPU)
+      Cpus = NCPU;
+
+   OsDisable();
+
+   setvect(HOST_KICK, SmpKick);
+
+   for (i = NumCpu; i < Cpus; i++) {
+      CpuTable[i].Id = i;
+      if (OsHostCpuStart(i) != SYSOK)
+         break;
+      NumCpu = i + 1;                  /* Now others may steal from it.      */
+   }
+
+   OsEnable();
+
+   return NumCpu;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpCpu() -- Main line of an added CPU. It becomes an idle process at    */
+/* priority 0 that runs whenever the CPU has nothing else to do...           */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpCpu( int Cpu )
+{
+   HANDLE   Pid;
+   PROCESS *pptr;
+
+   ThisCpu = &CpuTable[Cpu];
+
+   OsDisable();
+
+   pptr = (PROCESS *) OsAlloc(sizeof(PROCESS));
+   Pid  = OsHandCreate(&ProcessAnchor, (void *) pptr);
+
+   pptr->Flags |= PROCESS_CANT_KILL;   /* Idle process must always be there. */
+   ChainInit(&pptr->Link, pptr);
+   pptr->Pid    = Pid;
+   pptr->State  = PRCURR;
+   strncpy(pptr->Name, "IDLE", PNMLEN);
+   pptr->Prio   = 0;                   /* Lowest, never stolen.              */
+   pptr->Cpu    = Cpu;
+   pptr->Stack  = OsHostFrame(NULL, 0, NULL, NULL);
+   PrioChain(&ReadyQueue, &pptr->Link, pptr->Prio);
+   CurrPid  = Pid;
+   CurrProc = pptr;
+
+   OsHandUnprotect(ProcessAnchor, Pid);
+
+   OsEnable();
+
+   OsHostCpuInit(Cpu);                 /* Start ticking.                     */
+
+   for (;;)
+      OsIdle();                        /* Run or steal anything ready.       */
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpKick() -- Make a CPU reschedule...                                   */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpKick( int Cpu )
+{
+   CpuTable[Cpu].Preempt = 1;
+
+   if (&CpuTable[Cpu] != OsCpu())
+      OsHostKick(Cpu);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpReady() -- A process was put on its CPU's ready queue. Kick that CPU */
+/* if it is idle or should preempt what it runs; otherwise kick an idle CPU  */
+/* to steal it. An idle CPU must be kicked even for a priority 0 process,    */
+/* which only it may run: with no tick, nothing else would wake it...        */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpReady( PROCESS *pptr )
+{
+   CPU     *Self = OsCpu();
+   CPU     *Cpu  = &CpuTable[pptr->Cpu];
+   int      i;
+
+   if (Cpu != Self && (Cpu->Prio == 0 || Cpu->Prio < pptr->Prio)) {
+      OsSmpKick(Cpu->Id);
+      return;
+   }
+
+   for (i = 0; i < NumCpu; i++) {
+      Cpu = &CpuTable[i];
+      if (Cpu != Self && Cpu->Prio == 0 && !Cpu->Preempt) {
+         OsSmpKick(i);
+         return;
+      }
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpSteal() -- Move the best ready process of another CPU to our queue   */
+/* if it has higher priority than anything we have. Never takes a process    */
+/* that is running, or an idle (priority 0) process...                       */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpSteal( void )
+{
+   CPU     *Self = OsCpu();
+   CPU     *Cpu;
+   PROCESS *pptr;
+   PROCESS *Best = NULL;
+   ULONG    Map;
+   int      Prio;
+   int      Floor;
+   int      i;
+
+   Floor = Self->Ready.Map ? PrioHigh(Self->Ready.Map) : 0;
+
+   for (i = 0; i < NumCpu; i++) {
+      if ((Cpu = &CpuTable[i]) == Self)
+         continue;
+
+      for (Map = Cpu->Ready.Map; Map; Map &= ~((ULONG) 1 << Prio)) {
+         Prio = PrioHigh(Map);
+         if (Prio <= Floor)
+            break;
+
+         pptr = ChainFirst(&Cpu->Ready.Level[Prio]);
+         while (pptr && pptr->Pid == Cpu->Curr)
+            pptr = ChainNext(&pptr->Link);
+
+         if (pptr) {
+            Best  = pptr;
+            Floor = Prio;
+            break;
+         }
+      }
+   }
+
+   if (Best) {
+      PrioUnchain(ReadyQ(Best), &Best->Link, Best->Prio);
+      Best->Cpu = Self->Id;
+      PrioChain(&Self->Ready, &Best->Link, Best->Prio);
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpIdle() -- Called disabled when this CPU has nothing to run. Let go   */
+/* of the kernel and sleep until an interrupt (tick or kick), then take it   */
+/* again and run the isr...                                                  */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpIdle( void )
+{
+   long     Wait;
+
+   OsCpu()->Prio = 0;                  /* Tell others we are idle.           */
+   Wait = OsSleepNext();               /* Needs the kernel lock.             */
+
+   OsKernelUnlock();
+   OsHostIdle(Wait);                   /* Tickless until next sleeper.       */
+   OsKernelLock();
+
+   enable();                           /* Take the interrupt that woke us.   */
+   disable();
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsSmpPending() -- Called by OsSched(). Another CPU may have asked to kill */
+/* or suspend us while we were running...                                    */
+/*---------------------------------------------------------------------------*/
+
+void  OsSmpPending( void )
+{
+   PROCESS *pptr;
+
+   pptr = CurrProc;
+
+   if (pptr->Flags & PROCESS_STOPPED) {
+      pptr->Flags &= ~PROCESS_STOPPED;
+      if (pptr->State == PRCURR) {
+         PrioUnchain(ReadyQ(pptr), &pptr->Link, pptr->Prio);
+         pptr->State = PRSUSP;
+      }
+   }
+
+   if (pptr->Flags & PROCESS_KILLED) {
+      pptr->Flags &= ~PROCESS_KILLED;
+      OsKill(CurrPid);                 /* Doesn't return if we were running. */
+   }
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* SmpKick() -- Kick isr. The kicker set Resched; OsIntExit() acts on it...  */
+/*---------------------------------------------------------------------------*/
+
+static void interrupt SmpKick( void )
+{
+   OsIntEnter();
+   OsIntExit();
+}
+
+#endif
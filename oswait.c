@@ -0,0 +1,272 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*                              OS KERNEL                                    */
+/*                                                                           */
+/*                  COPYRIGHT (c) 1994 by JOHN C. OVERTON                    */
+/*              Advanced Communication Development Tools, Inc                */
+/*                                                                           */
+/*                                                                           */
+/*            Module:  OSWAIT.C                                              */
+/*                                                                           */
+/*             Title:  Wait for several objects at once.                     */
+/*                                                                           */
+/*       Description:  This module contains:                                 */
+/*                                                                           */
+/*                     OsWaitAny()     - Wait until one object is ready.     */
+/*                     OsWaitAll()     - Wait until all objects are ready.   */
+/*                     OsWatchWake()   - Ready processes watching an object. */
+/*                     OsWatchCancel() - Take down watches of a process.     */
+/*                                                                           */
+/*                     Objects are semaphores (ready with a count > 0, which */
+/*                     is taken), the process's own message queue (ready     */
+/*                     when not empty) and devices (ready when the driver's  */
+/*                     Poll() says a read would not wait). A process that    */
+/*                     has to wait hangs a watch on each semaphore and       */
+/*                     device. Posts, sends and drivers ready it when        */
+/*                     something changes, and it looks at everything again.  */
+/*                     Senders to a mailbox ring (osmbox.c) take no lock     */
+/*                     unless its Watch is on, so that goes on first.        */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#include "oskernel.h"
+
+
+#define  NOT_READY     -2              /* WaitScan(), nothing to return yet. */
+
+
+static int  WaitFor(  WAITOBJ *List, int Count, long Hundreds, int All);
+static int  WaitScan( WAITOBJ *List, int Count, int All, DEVICE **Dev);
+static int  WaitReady(WAITOBJ *Obj, DEVICE *Dev);
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsWaitAny() -- Wait until one of the objects is ready, at most Hundreds   */
+/* of a second (0 to not wait, -1 to wait forever). Returns the index of the */
+/* object, whose semaphore count is taken, or SYSTIMEOUT...                  */
+/*---------------------------------------------------------------------------*/
+
+int   OsWaitAny(WAITOBJ *List, int Count, long Hundreds)
+{
+   return WaitFor(List, Count, Hundreds, False);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsWaitAll() -- Wait until all of the objects are ready at once, at most   */
+/* Hundreds of a second. Takes a count from every semaphore and returns      */
+/* SYSOK, or SYSTIMEOUT...                                                   */
+/*---------------------------------------------------------------------------*/
+
+int   OsWaitAll(WAITOBJ *List, int Count, long Hundreds)
+{
+   return WaitFor(List, Count, Hundreds, True);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsWatchWake() -- Called disabled. Ready every process watching an object; */
+/* each takes its own watches down...                                        */
+/*---------------------------------------------------------------------------*/
+
+void  OsWatchWake(ANCHOR *Watchers)
+{
+   WATCH   *W;
+
+   for (W = ChainFirst(Watchers); W; W = ChainNext(&W->Link))
+      if (W->Proc->State == PRMULTI)
+         OsReady(W->Proc->Pid);
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* OsWatchCancel() -- Called disabled. Take a process's watches off the      */
+/* objects they are on...                                                    */
+/*---------------------------------------------------------------------------*/
+
+void  OsWatchCancel(PROCESS *P)
+{
+   int      i;
+
+   for (i = 0; i < P->Watches; i++)
+      if (P->Watch[i].On) {
+         Unchain(P->Watch[i].On, &P->Watch[i].Link);
+         P->Watch[i].On = NULL;
+      }
+
+   P->Watches = 0;
+   P->Flags  &= ~PROCESS_WATCHMSG;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitFor() -- Common code of OsWaitAny() and OsWaitAll()...                */
+/*---------------------------------------------------------------------------*/
+
+static int WaitFor(WAITOBJ *List, int Count, long Hundreds, int All)
+{
+   WATCH      Watch[NWAIT];            /* On our stack, we are blocked while */
+   DEVICE    *Dev[NWAIT];              /* they are in use.                   */
+   SEMAPHORE *S;
+   PROCESS   *P;
+   int        i, rc;
+   int        Box = False;             /* Watching a mailbox ring.           */
+
+
+   if (Count < 1 || Count > NWAIT)
+      return SYSERR;
+
+   /*------------------------------------------------------------------------*/
+   /* Keep devices from going away while we watch them...                    */
+   /*------------------------------------------------------------------------*/
+   for (i = 0; i < Count; i++)
+      Dev[i] = List[i].Type == OS_WAIT_DEV ?
+               OsHandProtect(DeviceAnchor, List[i].Handle) : NULL;
+
+   OsDisable();                        /* Disable interrupts.                */
+
+   P = CurrProc;
+
+   /*------------------------------------------------------------------------*/
+   /* Ring senders don't take the kernel lock: tell them to before looking,  */
+   /* so one that comes after is seen by them or by us...                    */
+   /*------------------------------------------------------------------------*/
+   for (i = 0; i < Count; i++)
+      if (List[i].Type == OS_WAIT_MSG && P->Box)
+         Box = True;
+   if (Box)
+      OsMboxWatch(P->Box, True);
+
+   if ((rc = WaitScan(List, Count, All, Dev)) == NOT_READY &&
+       Hundreds != 0) {
+
+      if (OsTimerStart(P, Hundreds) != SYSOK)  /* Give up when it is due.    */
+         rc = SYSERR;                  /* No timer, so we can't wait.        */
+
+      else do {
+         /*------------------------------------------------------------------*/
+         /* Watch everything, then wait for a change and look again...       */
+         /*------------------------------------------------------------------*/
+         for (i = 0; i < Count; i++) {
+            ChainInit(&Watch[i].Link, &Watch[i]);
+            Watch[i].Proc = P;
+            Watch[i].On   = NULL;
+
+            if (List[i].Type == OS_WAIT_SEM &&
+                (S = OsHandFind(SemaphoreAnchor, List[i].Handle)) != NULL)
+               Watch[i].On = &S->Watchers;
+            else if (List[i].Type == OS_WAIT_DEV && Dev[i] != NULL)
+               Watch[i].On = &Dev[i]->Watchers;
+            else if (List[i].Type == OS_WAIT_MSG)
+               P->Flags |= PROCESS_WATCHMSG;
+
+            if (Watch[i].On)
+               ChainQueue(Watch[i].On, &Watch[i].Link);
+         }
+         P->Watch   = Watch;
+         P->Watches = Count;
+
+         PrioUnchain(ReadyQ(P), &P->Link, P->Prio);   /* Off ready queue.    */
+         P->State = PRMULTI;
+         OsSched();                    /* Back when something changed.       */
+
+         OsWatchCancel(P);
+
+      } while ((rc = WaitScan(List, Count, All, Dev)) == NOT_READY &&
+               !(P->Flags & PROCESS_TIMEDOUT));
+
+      OsTimerStop(P);                  /* Harmless if it never started.      */
+   }
+
+   if (Box)
+      OsMboxWatch(P->Box, False);
+
+   OsEnable();                         /* Enable interrupts.                 */
+
+   for (i = 0; i < Count; i++)
+      if (Dev[i])
+         OsHandUnprotect(DeviceAnchor, List[i].Handle);
+
+   return rc == NOT_READY ? SYSTIMEOUT : rc;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitScan() -- Called disabled. For any, take and return the first ready   */
+/* object; for all, take them all if all are ready. Else NOT_READY...        */
+/*---------------------------------------------------------------------------*/
+
+static int WaitScan(WAITOBJ *List, int Count, int All, DEVICE **Dev)
+{
+   SEMAPHORE *S;
+   int        i, Ready;
+
+   for (i = 0; i < Count; i++) {
+      if ((Ready = WaitReady(&List[i], Dev[i])) == SYSERR)
+         return All ? SYSERR : i;      /* Gone, let caller find out.         */
+      if (!Ready && All)
+         return NOT_READY;
+      if (Ready && !All) {
+         if (List[i].Type == OS_WAIT_SEM) {
+            S = OsHandFind(SemaphoreAnchor, List[i].Handle);
+            S->Count--;                /* Take it.                           */
+         }
+         return i;
+      }
+   }
+
+   if (!All)
+      return NOT_READY;
+
+   for (i = 0; i < Count; i++)         /* All are ready, take them all.      */
+      if (List[i].Type == OS_WAIT_SEM) {
+         S = OsHandFind(SemaphoreAnchor, List[i].Handle);
+         S->Count--;
+      }
+
+   return SYSOK;
+}
+
+
+
+/*---------------------------------------------------------------------------*/
+/* WaitReady() -- Called disabled. True if an object is ready, SYSERR if     */
+/* it does not exist...                                                      */
+/*---------------------------------------------------------------------------*/
+
+static int WaitReady(WAITOBJ *Obj, DEVICE *Dev)
+{
+   SEMAPHORE    *S;
+   DEVICEDRIVER *DeviceDriver;
+
+   switch (Obj->Type) {
+
+      case OS_WAIT_SEM:
+         if ((S = OsHandFind(SemaphoreAnchor, Obj->Handle)) == NULL)
+            return SYSERR;
+         return S->Count > 0;
+
+      case OS_WAIT_MSG:
+         return OsMsgReady(CurrProc);
+
+      case OS_WAIT_DEV:
+         if (Dev == NULL || OsHandFind(DeviceAnchor, Obj->Handle) == NULL)
+            return SYSERR;             /* Never opened, or closed since.     */
+         DeviceDriver = &DeviceDriverTable[Dev->Driver];
+         if (DeviceDriver->Poll == NULL)
+            return True;               /* Can't tell, let read find out.     */
+         return (*DeviceDriver->Poll)(Dev) > 0;
+   }
+
+   return SYSERR;
+}
@@ -0,0 +1,210 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHBATCH.C                                          */
+/*                                                                           */
+/*             Title:  One message at a time versus batches.                 */
+/*                                                                           */
+/*       Description:  A sender streams [loops] short messages in bursts of  */
+/*                     BURST to a receiver, first one OsMsgSend() and        */
+/*                     OsMsgRecvBuff() per message, then one OsMsgSendBatch()*/
+/*                     and OsMsgRecvBatch() per burst; to a receiver made by */
+/*                     OsCreate(), then to one made by OsCreateMbox(). The   */
+/*                     receiver checks they come in order, and that batches  */
+/*                     really hold more than one. Reports the cost per       */
+/*                     message of each. Then checks a batch sent with Wait   */
+/*                     returns only once all of it is taken, and that an     */
+/*                     empty batch receive times out. Exits 1 if a check     */
+/*                     fails.                                                */
+/*                                                                           */
+/*                     Usage: benchbatch [loops]                             */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  BURST        32               /* Messages per batch.                */
+#define  NSLOT        64               /* Ring slots.                        */
+#define  NLAST        3                /* Messages in the batch with Wait.   */
+
+typedef struct {
+   long     Seq;                       /* Sequence number.                   */
+   long     Pad[3];
+} MSG;
+
+static void Sender(   char *Data );
+static void Receiver( char *Data );
+
+static long    Loops = 200000L;        /* Messages per mode.                 */
+static HANDLE  RecvPid;
+static HANDLE  Done;
+static int     Taken;                  /* Receiver took the last batch.      */
+static int     Errors;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("benchbatch: %s failed\n", What);
+      Errors++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Loops = atol(argv[1]);
+   Loops -= Loops % BURST;             /* Whole bursts only.                 */
+
+   OsInit();
+
+   Done = OsSemCreate(0);
+
+   if (OsCreate(Sender, 16384, 10, "Sender", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Sender( char *Data )
+{
+   static MSG  Msg[BURST];
+   void    *Datas[BURST];
+   int      Lengths[BURST];
+   double   Start;
+   long     i;
+   int      Ring, Batch, j;
+
+   for (j = 0; j < BURST; j++) {
+      Datas[j]   = &Msg[j];
+      Lengths[j] = sizeof(MSG);
+   }
+
+   for (Ring = 0; Ring < 2; Ring++) {
+      RecvPid = Ring ?
+         OsCreateMbox(Receiver, 16384, 10, "Receiver", NULL, NSLOT) :
+         OsCreate(    Receiver, 16384, 10, "Receiver", NULL);
+      Check(RecvPid != SYSERR, "OsCreate()");
+
+      for (Batch = 0; Batch < 2; Batch++) {
+         Start = Now();
+         for (i = 0; i < Loops; i += BURST) {
+            for (j = 0; j < BURST; j++)
+               Msg[j].Seq = i + j;
+            if (Batch)
+               Check(OsMsgSendBatch(RecvPid, Datas, Lengths, BURST, False) ==
+                     BURST, "OsMsgSendBatch()");
+            else
+               for (j = 0; j < BURST; j++)
+                  Check(OsMsgSend(RecvPid, &Msg[j], sizeof(MSG), False) ==
+                        SYSOK, "OsMsgSend()");
+         }
+         OsWait(Done);                 /* Receiver has them all.             */
+
+         printf("%-16s %-16s %8.1f ns/message\n",
+                Ring ? "OsCreateMbox()" : "OsCreate()",
+                Batch ? "OsMsgSendBatch()" : "OsMsgSend()",
+                (Now() - Start) / Loops);
+      }
+
+      /*---------------------------------------------------------------------*/
+      /* With Wait, back only once the receiver took the whole batch...      */
+      /*---------------------------------------------------------------------*/
+      Taken = 0;
+      for (j = 0; j < NLAST; j++)
+         Msg[j].Seq = -1 - j;
+      Check(OsMsgSendBatch(RecvPid, Datas, Lengths, NLAST, True) == NLAST,
+            "OsMsgSendBatch() with Wait");
+      Check(Taken, "Wait until taken");
+      OsWait(Done);
+   }
+
+   Check(OsMsgSendBatch(RecvPid, Datas, Lengths, 0, False) == SYSERR,
+         "OsMsgSendBatch() of none");
+   Check(OsMsgRecvBatch(Datas, Lengths, 0, 0) == SYSERR,
+         "OsMsgRecvBatch() of none");
+   Check(OsMsgRecvBatch(Datas, Lengths, BURST, 2) == 0,
+         "OsMsgRecvBatch() when empty");
+
+   printf(Errors ? "benchbatch: FAILED, %d errors\n" : "benchbatch: ok\n",
+          Errors);
+   OsTerm();
+   exit(Errors != 0);
+}
+
+
+static void Receiver( char *Data )
+{
+   MSG     *Msgs[BURST];
+   int      Lengths[BURST];
+   long     Next;
+   int      Batch, Widest, n, j;
+
+   for (Batch = 0; Batch < 2; Batch++) {
+      Widest = 0;
+      for (Next = 0; Next < Loops; ) {
+         if (Batch)
+            n = OsMsgRecvBatch((void **) Msgs, Lengths, BURST, -1L);
+         else
+            n = OsMsgRecvBuff((void **) Msgs, Lengths, -1L) == SYSOK;
+         if (n < 1) {
+            Errors++;
+            continue;
+         }
+         if (n > Widest)
+            Widest = n;
+
+         for (j = 0; j < n; j++) {
+            if (Lengths[j] != sizeof(MSG) || Msgs[j]->Seq != Next++)
+               Errors++;
+            OsMsgFree(Msgs[j]);
+         }
+      }
+      if (Batch)
+         Check(Widest > 1, "OsMsgRecvBatch() takes more than one");
+      OsPost(Done);
+   }
+
+   for (Next = 0; Next < NLAST; Next += n) {
+      n = OsMsgRecvBatch((void **) Msgs, Lengths, BURST, 500L);
+      if (n < 1) {
+         Errors++;
+         break;
+      }
+      for (j = 0; j < n; j++) {
+         if (Msgs[j]->Seq != -1 - (Next + j))
+            Errors++;
+         OsMsgFree(Msgs[j]);
+      }
+   }
+   Taken = 1;
+   OsPost(Done);
+}
@@ -0,0 +1,291 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHCALL.C                                           */
+/*                                                                           */
+/*             Title:  Request and reply: send and receive versus call.      */
+/*                                                                           */
+/*       Description:  A client asks a server [loops] times to add one to a  */
+/*                     number, first with OsMsgSend() and OsMsgRecvBuff()    */
+/*                     both ways, then with OsMsgCall() and OsMsgReply(),    */
+/*                     which switch straight between the two; to a server    */
+/*                     made by OsCreate(), then to one made by               */
+/*                     OsCreateMbox(). Reports the round trip of each. Then  */
+/*                     checks a batch receive stops after a call, a call     */
+/*                     does not pass over a more urgent ready process, a     */
+/*                     call to a process killed before it replies fails, a   */
+/*                     reply to a killed caller fails, and every message     */
+/*                     went back to the pool. Exits 1 if a check fails.      */
+/*                                                                           */
+/*                     Usage: benchcall [loops]                              */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+static void Client( char *Data );
+static void Server( char *Data );
+static void Hog(    char *Data );
+static void Killer( char *Data );
+static void Sink(   char *Data );
+static void Caller( char *Data );
+static void Batcher( char *Data );
+static void Asker(  char *Data );
+
+static long    Loops = 200000L;        /* Round trips per mode.              */
+static HANDLE  ClientPid;
+static HANDLE  SinkPid;
+static HANDLE  CallerPid;
+static HANDLE  BatchPid;
+static HANDLE  AskerPid;
+static HANDLE  Go;                     /* Batcher may receive now.           */
+static int     Took[2];                /* Batcher: how many in each batch,   */
+static HANDLE  Asked[2];               /* and who called in each.            */
+static int     HogRan;                 /* Hog ran before the server.         */
+static int     Failed;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("benchcall: %s failed\n", What);
+      Failed++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Loops = atol(argv[1]);
+
+   OsInit();
+
+   Go = OsSemCreate(0);
+
+   if ((ClientPid = OsCreate(Client, 16384, 10, "Client", NULL)) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Client( char *Data )
+{
+   MSGSTATS Stats;
+   HANDLE   Pid;
+   double   Start;
+   long     i, n, *Got;
+   int      Length, Ring, Call, Errors;
+
+   for (Ring = 0; Ring < 2; Ring++) {
+      Pid = Ring ?
+         OsCreateMbox(Server, 16384, 10, "Server", NULL, 16) :
+         OsCreate(    Server, 16384, 10, "Server", NULL);
+
+      for (Call = 0; Call < 2; Call++) {
+         Errors = 0;
+         Start = Now();
+         for (i = 0; i < Loops; i++) {
+            if (Call) {
+               if (OsMsgCall(Pid, &i, sizeof(i), (void **) &Got, &Length) !=
+                   SYSOK) {
+                  Errors++;
+                  break;
+               }
+            }
+            else {
+               OsMsgSend(Pid, &i, sizeof(i), False);
+               OsMsgRecvBuff((void **) &Got, &Length, -1L);
+            }
+            if (Length != sizeof(long) || *Got != i + 1)
+               Errors++;
+            OsMsgFree(Got);
+         }
+
+         printf("%-16s %-24s %8.1f ns/round trip\n",
+                Ring ? "OsCreateMbox()" : "OsCreate()",
+                Call ? "OsMsgCall/Reply()" : "OsMsgSend/Recv()",
+                (Now() - Start) / Loops);
+         Check(Errors == 0, Call ? "OsMsgCall()" : "OsMsgSend()");
+      }
+      OsKill(Pid);
+   }
+
+   Check(OsMsgCall(ClientPid, &i, sizeof(i), (void **) &Got, &Length) ==
+         SYSERR, "OsMsgCall() of self");
+
+   /*------------------------------------------------------------------------*/
+   /* A message, a call, a message: the first batch stops at the call, so    */
+   /* OsMsgCaller() is the caller of its last message...                     */
+   /*------------------------------------------------------------------------*/
+   for (Ring = 0; Ring < 2; Ring++) {
+      BatchPid = Ring ?
+         OsCreateMbox(Batcher, 16384, 20, "Batcher", NULL, 16) :
+         OsCreate(    Batcher, 16384, 20, "Batcher", NULL);
+      OsSleep(1);                      /* Let it wait for Go.                */
+      n = 1;
+      OsMsgSend(BatchPid, &n, sizeof(n), False);
+      AskerPid = OsCreate(Asker, 16384, 15, "Asker", NULL);
+      OsSleep(1);                      /* Let it call.                       */
+      n = 3;
+      OsMsgSend(BatchPid, &n, sizeof(n), False);
+      OsPost(Go);
+      OsSleep(5);                      /* Let it take both batches.          */
+      Check(Took[0] == 2 && Asked[0] == AskerPid, "Batch ends at a call");
+      Check(Took[1] == 1 && Asked[1] == 0, "Batch after a call");
+   }
+
+   /*------------------------------------------------------------------------*/
+   /* A less urgent server doesn't jump ahead of a ready Hog...              */
+   /*------------------------------------------------------------------------*/
+   Pid = OsCreate(Server, 16384, 5, "Server", (char *) 1L);
+   OsSleep(1);                         /* Let it wait for a message.         */
+   OsCreate(Hog, 16384, 8, "Hog", NULL);
+   n = 0;
+   Check(OsMsgCall(Pid, &n, sizeof(n), (void **) &Got, &Length) == SYSOK &&
+         *Got == 1, "Call to less urgent server");
+   OsMsgFree(Got);
+   Check(HogRan, "More urgent process runs first");
+   OsKill(Pid);
+
+   /*------------------------------------------------------------------------*/
+   /* Killed before it replies, and a reply to a killed caller...            */
+   /*------------------------------------------------------------------------*/
+   SinkPid = OsCreate(Sink, 16384, 5, "Sink", NULL);
+   OsCreate(Killer, 16384, 15, "Killer", NULL);
+   Check(OsMsgCall(SinkPid, &n, sizeof(n), (void **) &Got, &Length) ==
+         SYSERR, "Call to process killed");
+
+   SinkPid = OsCreate(Sink, 16384, 5, "Sink", NULL);
+   CallerPid = OsCreate(Caller, 16384, 5, "Caller", NULL);
+   OsSleep(5);                         /* Caller waits on Sink.              */
+   OsKill(CallerPid);
+   Check(OsMsgCaller() == 0, "No call received");
+   OsSleep(30);                        /* Sink replies, and finds it gone.   */
+   OsKill(SinkPid);
+
+   OsMsgStats(&Stats);
+   Check(Stats.InUse == 0, "Messages back in pool");
+
+   printf(Failed ? "benchcall: FAILED\n" : "benchcall: ok\n");
+   OsTerm();
+   exit(Failed != 0);
+}
+
+
+static void Server( char *Data )
+{
+   long    *Msg;
+   long     Answer;
+   HANDLE   Pid;
+   int      Length;
+
+   for (;;) {
+      OsMsgRecvBuff((void **) &Msg, &Length, -1L);
+      Answer = Data ? HogRan : *Msg + 1;
+      OsMsgFree(Msg);
+
+      if ((Pid = OsMsgCaller()) != 0)
+         OsMsgReply(Pid, &Answer, sizeof(Answer));
+      else
+         OsMsgSend(ClientPid, &Answer, sizeof(Answer), False);
+   }
+}
+
+
+static void Hog( char *Data )
+{
+   HogRan = 1;
+}
+
+
+static void Killer( char *Data )
+{
+   OsSleep(5);                         /* Let the call get there.            */
+   OsKill(SinkPid);
+}
+
+
+static void Sink( char *Data )
+{
+   void    *Msg;
+   HANDLE   Pid;
+   int      Length;
+   long     n = 0;
+
+   OsMsgRecvBuff(&Msg, &Length, -1L);
+   Pid = OsMsgCaller();
+   OsMsgFree(Msg);
+
+   OsSleep(20);                        /* Too slow, caller may be killed.    */
+   if (OsMsgReply(Pid, &n, sizeof(n)) != SYSERR)
+      Failed++;                        /* Killer or Client got there first.  */
+   OsSleep(1000);
+}
+
+
+static void Caller( char *Data )
+{
+   void    *Reply;
+   long     n = 0;
+   int      Length;
+
+   OsMsgCall(SinkPid, &n, sizeof(n), &Reply, &Length);
+   Failed++;                           /* Killed while waiting, never here.  */
+}
+
+
+static void Batcher( char *Data )
+{
+   void    *Msgs[8];
+   int      Lengths[8];
+   int      i, j;
+
+   OsWait(Go);
+   for (i = 0; i < 2; i++) {
+      Took[i]  = OsMsgRecvBatch(Msgs, Lengths, 8, 0L);
+      Asked[i] = OsMsgCaller();
+      for (j = 0; j < Took[i]; j++)
+         OsMsgFree(Msgs[j]);
+      if (Asked[i])
+         OsMsgReply(Asked[i], &i, sizeof(i));
+   }
+}
+
+
+static void Asker( char *Data )
+{
+   void    *Reply;
+   long     n = 2;
+   int      Length;
+
+   if (OsMsgCall(BatchPid, &n, sizeof(n), &Reply, &Length) == SYSOK)
+      OsMsgFree(Reply);
+}
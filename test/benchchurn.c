@@ -0,0 +1,145 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHCHURN.C                                          */
+/*                                                                           */
+/*             Title:  Handle churn benchmark.                               */
+/*                                                                           */
+/*       Description:  Creates [count] semaphores all at once, then destroys */
+/*                     them, to grow the handle space past 64K handles.      */
+/*                     Then creates and destroys one semaphore [count] times */
+/*                     over, checking that an old handle is not found again, */
+/*                     and creates and kills [count] short lived processes.  */
+/*                     Reports the cost of each.                             */
+/*                                                                           */
+/*                     Usage: benchchurn [count]                             */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+static void Driver( char *Data );
+static void Child(  char *Data );
+
+static long    Count = 1000000L;
+static HANDLE  Done;
+static int     Failed;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Count = atol(argv[1]);
+
+   OsInit();
+
+   if (OsCreate(Driver, 16384, 10, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   HANDLE  *Hand;
+   HANDLE   Old, New;
+   double   Start, Create, Destroy, Churn, Proc;
+   long     i;
+
+   if ((Hand = malloc(Count * sizeof(HANDLE))) == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+   }
+   Done = OsSemCreate(0);
+
+   /*------------------------------------------------------------------------*/
+   /* All live at once...                                                    */
+   /*------------------------------------------------------------------------*/
+   Start = Now();
+   for (i = 0; i < Count; i++)
+      if ((Hand[i] = OsSemCreate(0)) == SYSERR) {
+         fprintf(stderr, "OsSemCreate() failed after %ld\n", i);
+         exit(1);
+      }
+   Create = Now() - Start;
+
+   for (i = 0; i < Count; i++)         /* Every one still there?             */
+      if (OsHandFind(SemaphoreAnchor, Hand[i]) == NULL)
+         Failed++;
+
+   Start = Now();
+   for (i = 0; i < Count; i++)
+      OsSemDelete(Hand[i]);
+   Destroy = Now() - Start;
+
+   /*------------------------------------------------------------------------*/
+   /* One at a time, reusing the same handle slot...                         */
+   /*------------------------------------------------------------------------*/
+   Old   = OsSemCreate(0);
+   OsSemDelete(Old);
+
+   Start = Now();
+   for (i = 0; i < Count; i++) {
+      New = OsSemCreate(0);
+      OsSemDelete(New);
+   }
+   Churn = Now() - Start;
+
+   if (OsHandFind(SemaphoreAnchor, Old) != NULL ||
+       OsHandFind(SemaphoreAnchor, Hand[0]) != NULL)
+      Failed++;                        /* Stale handle found again.          */
+
+   /*------------------------------------------------------------------------*/
+   /* Short lived processes...                                               */
+   /*------------------------------------------------------------------------*/
+   Start = Now();
+   for (i = 0; i < Count; i++) {
+      if (OsCreate(Child, 16384, 20, "Child", NULL) == SYSERR) {
+         Failed++;
+         break;
+      }
+      OsWait(Done);
+   }
+   Proc = Now() - Start;
+
+   printf("%ld semaphores: create %.1f ns  delete %.1f ns  churn %.1f ns  "
+          "process create+kill %.1f ns  %s\n", Count,
+          Create / Count, Destroy / Count, Churn / Count, Proc / Count,
+          Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Child( char *Data )
+{
+   OsPost(Done);
+}
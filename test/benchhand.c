@@ -0,0 +1,120 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHHAND.C                                           */
+/*                                                                           */
+/*             Title:  Concurrent handle lookup benchmark.                   */
+/*                                                                           */
+/*       Description:  One worker per CPU looks up a shared set of handles   */
+/*                     with OsHandFind() and with OsHandProtect() plus       */
+/*                     OsHandUnprotect(). Reports the cost of each and the   */
+/*                     total lookups per second over all CPUs. In an OS_SMP  */
+/*                     build the workers run in parallel on [cpus] CPUs.     */
+/*                                                                           */
+/*                     Usage: benchhand [cpus] [loops]                       */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  NHAND        64               /* Handles looked up.                 */
+
+static void Worker( char *Data );
+
+static long    Loops = 2000000L;       /* Lookups per worker per test.       */
+static HANDLE  Hand[NHAND];
+static HANDLE  Done;
+static double  FindTime, ProtTime;     /* Worker time totals, in ns.         */
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   double   Start, Wall;
+   int      Cpus = 1;
+   int      i;
+
+   if (argc > 1)
+      Cpus  = atoi(argv[1]);
+   if (argc > 2)
+      Loops = atol(argv[2]);
+
+   OsInit();
+#if defined(OS_SMP)
+   Cpus = OsSmpStart(Cpus);
+#else
+   Cpus = 1;
+#endif
+
+   for (i = 0; i < NHAND; i++)
+      Hand[i] = OsSemCreate(0);
+   Done = OsSemCreate(0);
+
+   Start = Now();
+
+   for (i = 0; i < Cpus; i++)
+      OsCreate(Worker, 16384, 10, "Worker", NULL);
+   for (i = 0; i < Cpus; i++)
+      OsWait(Done);
+
+   Wall = Now() - Start;
+
+   printf("cpus %d  OsHandFind %.1f ns  OsHandProtect+Unprotect %.1f ns  "
+          "%.1f M lookups/s\n", Cpus,
+          FindTime / (Cpus * (double) Loops),
+          ProtTime / (Cpus * (double) Loops),
+          2.0 * Cpus * Loops / Wall * 1e3);
+
+   OsTerm();
+   return 0;
+}
+
+
+static void Worker( char *Data )
+{
+   double   Start, Find, Prot;
+   long     i;
+
+   Start = Now();
+   for (i = 0; i < Loops; i++)
+      if (OsHandFind(SemaphoreAnchor, Hand[i % NHAND]) == NULL)
+         abort();
+   Find  = Now() - Start;
+
+   Start = Now();
+   for (i = 0; i < Loops; i++) {
+      if (OsHandProtect(SemaphoreAnchor, Hand[i % NHAND]) == NULL)
+         abort();
+      OsHandUnprotect(SemaphoreAnchor, Hand[i % NHAND]);
+   }
+   Prot  = Now() - Start;
+
+   OsDisable();
+   FindTime += Find;
+   ProtTime += Prot;
+   OsEnable();
+
+   OsPost(Done);
+}
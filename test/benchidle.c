@@ -0,0 +1,93 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHIDLE.C                                           */
+/*                                                                           */
+/*             Title:  Idle cost and sleep wakeup latency (hosted build).    */
+/*                                                                           */
+/*       Description:  One process sleeps for one hundredth of a second over */
+/*                     and over while the INIT process idles in OsIdle().    */
+/*                     Reports how late the sleeper woke up and how much of  */
+/*                     the host CPU the whole thing used.                    */
+/*                                                                           */
+/*                     Usage: benchidle [sleeps]                             */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "os.h"
+
+static void Sleeper( char *Data );
+
+static long    Sleeps = 100;
+
+
+static double Now( clockid_t Clock )   /* Millisecs on a host clock.         */
+{
+   struct timespec   Ts;
+
+   clock_gettime(Clock, &Ts);
+   return Ts.tv_sec * 1e3 + Ts.tv_nsec / 1e6;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Sleeps = atol(argv[1]);
+
+   OsInit();
+
+   if (OsCreate(Sleeper, 16384, 10, "Sleeper", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Sleeper( char *Data )
+{
+   double   Wall, Cpu, Start, Late;
+   double   Total = 0, Worst = 0;
+   long     i;
+
+   OsSleep(1);                         /* Line up with the clock.            */
+
+   Wall = Now(CLOCK_MONOTONIC);
+   Cpu  = Now(CLOCK_PROCESS_CPUTIME_ID);
+
+   for (i = 0; i < Sleeps; i++) {
+      Start = Now(CLOCK_MONOTONIC);
+      OsSleep(1);
+      Late  = Now(CLOCK_MONOTONIC) - Start - 10.0;
+      Total += Late;
+      if (Late > Worst)
+         Worst = Late;
+   }
+
+   Wall = Now(CLOCK_MONOTONIC)          - Wall;
+   Cpu  = Now(CLOCK_PROCESS_CPUTIME_ID) - Cpu;
+
+   OsTerm();
+
+   printf("%ld sleeps of 10 ms  late avg %.2f ms  worst %.2f ms  "
+          "cpu %.1f%%\n", Sleeps, Total / Sleeps, Worst, 100.0 * Cpu / Wall);
+
+   exit(0);
+}
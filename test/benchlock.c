@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHLOCK.C                                           */
+/*                                                                           */
+/*             Title:  Lock throughput with short critical sections.         */
+/*                                                                           */
+/*       Description:  1, 2, 4, ... up to [cpus] workers, one per CPU, each  */
+/*                     lock a shared lock with OsLock(), bump a counter and  */
+/*                     unlock, with a little work outside the lock. Run      */
+/*                     with LockSpin 0 (always wait on the turnstile) and    */
+/*                     with the default adaptive spin. Reports lock and      */
+/*                     unlock pairs per second over all workers, and checks  */
+/*                     the counter. Spinning needs an OS_SMP build.          */
+/*                                                                           */
+/*                     Usage: benchlock [cpus] [loops]                       */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  OUTSIDE      50               /* Work loops outside the lock.       */
+
+static void Worker( char *Data );
+
+static long    Loops = 200000L;        /* Lock/unlock pairs per worker.      */
+static HANDLE  Lock;
+static HANDLE  Done;
+static volatile long Counter;
+static int     Failed;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static double Run( int Workers )       /* Returns M pairs per second.        */
+{
+   double   Start, Wall;
+   int      i;
+
+   Counter = 0;
+   Start   = Now();
+
+   for (i = 0; i < Workers; i++)
+      OsCreate(Worker, 16384, 10, "Worker", NULL);
+   for (i = 0; i < Workers; i++)
+      OsWait(Done);
+
+   Wall = Now() - Start;
+
+   if (Counter != Workers * Loops)
+      Failed++;
+
+   return Workers * Loops / Wall * 1e3;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   double   Wait, Spin;
+   int      Cpus = 2;
+   int      n;
+
+   if (argc > 1)
+      Cpus  = atoi(argv[1]);
+   if (argc > 2)
+      Loops = atol(argv[2]);
+
+   OsInit();
+#if defined(OS_SMP)
+   Cpus = OsSmpStart(Cpus);
+#else
+   Cpus = 1;
+#endif
+
+   Done = OsSemCreate(0);
+
+   for (n = 1; n <= Cpus; n *= 2) {
+      LockSpin = 0;
+      Wait = Run(n);
+      LockSpin = OS_LOCKSPIN;
+      Spin = Run(n);
+      printf("workers %2d  wait %6.2f  spin %6.2f M lock/unlock per sec\n",
+             n, Wait, Spin);
+   }
+
+   printf("benchlock %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Worker( char *Data )
+{
+   volatile int   j;
+   long           i;
+
+   for (i = 0; i < Loops; i++) {
+      OsLock(&Lock);
+      Counter++;                       /* The critical section.              */
+      OsUnlock(&Lock);
+
+      for (j = 0; j < OUTSIDE; j++)
+         ;
+   }
+
+   OsPost(Done);
+}
@@ -0,0 +1,209 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHMBOX.C                                           */
+/*                                                                           */
+/*             Title:  Many senders, one receiver: chain versus ring.        */
+/*                                                                           */
+/*       Description:  [senders] processes each send [loops] short messages  */
+/*                     to one receiver, first made by OsCreate() (messages   */
+/*                     on its chain, under the kernel lock), then by         */
+/*                     OsCreateMbox() (a lock-free ring). The receiver       */
+/*                     checks each sender's messages come in order. Reports  */
+/*                     messages per second for each; in an OS_SMP build the  */
+/*                     senders run in parallel on [cpus] CPUs. Then checks a */
+/*                     ring wakes OsWaitAny(), times out an empty receive,   */
+/*                     holds a waiting sender until its message is taken,    */
+/*                     and lets a timed send give up with its message left   */
+/*                     in the ring. Exits 1 if a check fails.                */
+/*                                                                           */
+/*                     Usage: benchmbox [cpus] [senders] [loops]             */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  NSEND        64               /* Most senders.                      */
+#define  NSLOT        256              /* Ring slots.                        */
+
+typedef struct {
+   long     Sender;                    /* Which sender,                      */
+   long     Seq;                       /* and its count.                     */
+} MSG;
+
+static void Sender(   char *Data );
+static void Receiver( char *Data );
+
+static long    Loops   = 50000L;       /* Messages per sender.               */
+static int     Senders = 16;
+static HANDLE  RecvPid;
+static HANDLE  Done;
+static HANDLE  Go;                     /* Receiver may take the timed send.  */
+static int     Taken;                  /* Receiver took the last message.    */
+static int     Errors;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("benchmbox: %s failed\n", What);
+      Errors++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   double   Start, Wall;
+   MSG      Last;
+   int      Cpus = 1;
+   int      Ring, i;
+
+   if (argc > 1)
+      Cpus    = atoi(argv[1]);
+   if (argc > 2)
+      Senders = atoi(argv[2]);
+   if (argc > 3)
+      Loops   = atol(argv[3]);
+   if (Senders < 1 || Senders > NSEND)
+      Senders = NSEND;
+
+   OsInit();
+#if defined(OS_SMP)
+   Cpus = OsSmpStart(Cpus);
+#else
+   Cpus = 1;
+#endif
+
+   Done = OsSemCreate(0);
+   Go   = OsSemCreate(0);
+
+   for (Ring = 0; Ring < 2; Ring++) {
+      RecvPid = Ring ?
+         OsCreateMbox(Receiver, 16384, 10, "Receiver", (char *) 1L, NSLOT) :
+         OsCreate(    Receiver, 16384, 10, "Receiver", NULL);
+      Check(RecvPid != SYSERR, "OsCreate()");
+
+      Start = Now();
+      for (i = 0; i < Senders; i++)
+         OsCreate(Sender, 16384, 10, "Sender", (char *) (long) i);
+      for (i = 0; i < Senders + 1; i++)
+         OsWait(Done);                 /* Senders, then the receiver.        */
+      Wall = Now() - Start;
+
+      printf("cpus %d  senders %d  %-14s %8.2f M messages/s\n", Cpus,
+             Senders, Ring ? "OsCreateMbox()" : "OsCreate()",
+             Senders * (double) Loops / Wall * 1e3);
+   }
+
+   /*------------------------------------------------------------------------*/
+   /* Receiver of the ring is waiting in OsWaitAny() now. A message with     */
+   /* Wait returns only once it has been taken...                            */
+   /*------------------------------------------------------------------------*/
+   Last.Sender = -1;
+   Last.Seq    = 0;
+   Check(OsMsgSend(RecvPid, &Last, sizeof(Last), True) == SYSOK,
+         "OsMsgSend() with Wait");
+   Check(Taken, "Wait until taken");
+   OsWait(Done);
+
+   /*------------------------------------------------------------------------*/
+   /* Receiver waits on Go now, so a timed send gives up. Its message stays  */
+   /* in the ring for the receiver to take later...                          */
+   /*------------------------------------------------------------------------*/
+   Last.Sender = -2;
+   Check(OsMsgSendTimeout(RecvPid, &Last, sizeof(Last), 5) == SYSTIMEOUT,
+         "OsMsgSendTimeout() expires");
+   OsPost(Go);
+   OsWait(Done);
+
+   printf(Errors ? "benchmbox: FAILED\n" : "benchmbox: ok\n");
+   OsTerm();
+   return Errors != 0;
+}
+
+
+static void Sender( char *Data )
+{
+   MSG      Msg;
+
+   Msg.Sender = (long) Data;
+   for (Msg.Seq = 0; Msg.Seq < Loops; Msg.Seq++)
+      if (OsMsgSend(RecvPid, &Msg, sizeof(Msg), False) != SYSOK) {
+         Errors++;
+         break;
+      }
+
+   OsPost(Done);
+}
+
+
+static void Receiver( char *Data )
+{
+   static long Next[NSEND];
+   WAITOBJ  Obj;
+   MSG     *Msg;
+   void    *Empty;
+   long     i;
+   int      Length;
+
+   for (i = 0; i < Senders; i++)
+      Next[i] = 0;
+
+   for (i = 0; i < Senders * Loops; i++) {
+      OsMsgRecvBuff((void **) &Msg, &Length, -1L);
+      if (Length != sizeof(MSG) || Msg->Sender < 0 ||
+          Msg->Sender >= Senders || Msg->Seq != Next[Msg->Sender]++)
+         Errors++;
+      OsMsgFree(Msg);
+   }
+
+   if (Data == NULL) {                 /* Chain, done.                       */
+      OsPost(Done);
+      return;
+   }
+
+   Check(OsMsgRecvTimeout(&Empty, &Length, 2) == SYSTIMEOUT,
+         "OsMsgRecvTimeout() on empty ring");
+   Check(OsMsgRecv(&Empty, &Length, False) == SYSNOMSG,
+         "OsMsgRecv() on empty ring");
+   OsPost(Done);
+
+   Obj.Type   = OS_WAIT_MSG;
+   Obj.Handle = 0;
+   Check(OsWaitAny(&Obj, 1, 500) == 0, "OsWaitAny() on ring");
+   Check(OsMsgRecvBuff((void **) &Msg, &Length, 0L) == SYSOK &&
+         Msg->Sender == -1, "OsMsgRecvBuff() after OsWaitAny()");
+   OsMsgFree(Msg);
+   Taken = 1;
+   OsPost(Done);
+
+   OsWait(Go);
+   Check(OsMsgRecv((void **) &Msg, &Length, True) == SYSOK &&
+         Msg->Sender == -2, "OsMsgRecv() after send timed out");
+   OsFree(Msg);
+   OsPost(Done);
+}
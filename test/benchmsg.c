@@ -0,0 +1,211 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHMSG.C                                            */
+/*                                                                           */
+/*             Title:  Copying versus zero-copy message benchmark.           */
+/*                                                                           */
+/*       Description:  A sender streams messages of several sizes to a       */
+/*                     receiver, first with OsMsgSend(), which copies them,  */
+/*                     then in pool buffers with OsMsgSendBuff(), which does */
+/*                     not. The receiver takes them with OsMsgRecvBuff().    */
+/*                     Each message holds its own address, so the receiver   */
+/*                     checks the zero-copy ones arrive at the very buffer   */
+/*                     sent, and their sequence number and filler, and that  */
+/*                     OsMsgRecv() copies a buffer or inline data out.       */
+/*                     Reports the cost per message of each, and the message */
+/*                     pool counts from OsMsgStats(). Exits 1 if a check     */
+/*                     fails.                                                */
+/*                                                                           */
+/*                     Usage: benchmsg [loops]                               */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+typedef struct {                       /* Start of every message.            */
+   void    *Self;                      /* Where the sender put it.           */
+   long     Seq;                       /* Sequence number.                   */
+} STAMP;
+
+static void Sender(   char *Data );
+static void Receiver( char *Data );
+
+static int     Sizes[] = { 64, 1600, 4096 };
+#define  NSIZES      (sizeof(Sizes) / sizeof(Sizes[0]))
+
+static long    Loops = 200000L;        /* Messages per size and mode.        */
+static HANDLE  RecvPid;
+static HANDLE  Done;
+static int     Size;                   /* Size being sent.                   */
+static int     ZeroCopy;               /* Mode being sent.                   */
+static int     Errors;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Loops = atol(argv[1]);
+
+   OsInit();
+
+   Done = OsSemCreate(0);
+
+   if ((RecvPid = OsCreate(Receiver, 16384, 10, "Receiver", NULL)) == SYSERR ||
+       OsCreate(Sender, 16384, 10, "Sender", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Fill( BYTE *Msg, long Seq )
+{
+   STAMP   *Stamp = (STAMP *) Msg;
+
+   Stamp->Self = Msg;
+   Stamp->Seq  = Seq;
+   memset(Msg + sizeof(STAMP), (BYTE) Seq, Size - sizeof(STAMP));
+}
+
+
+static void Sender( char *Data )
+{
+   static BYTE Copy[4096];
+   MSGSTATS Stats;
+   void    *Buff;
+   BYTE    *Msg;
+   int      Length;
+   double   Start;
+   unsigned s;
+   long     i;
+
+   for (s = 0; s < NSIZES; s++) {
+      Size = Sizes[s];
+
+      for (ZeroCopy = 0; ZeroCopy < 2; ZeroCopy++) {
+         Start = Now();
+         for (i = 0; i < Loops; i++) {
+            if (!ZeroCopy) {
+               Fill(Copy, i);
+               if (OsMsgSend(RecvPid, Copy, Size, False) != SYSOK)
+                  Errors++;
+            }
+            else {
+               if (OsBuffAlloc(&Buff, Size) != SYSOK) {
+                  Errors++;
+                  break;
+               }
+               Fill(Buff, i);
+               if (OsMsgSendBuff(RecvPid, Buff, Size, False) != SYSOK)
+                  Errors++;
+            }
+         }
+         OsWait(Done);                 /* Receiver has them all.             */
+
+         printf("%4d bytes  %-15s %8.1f ns/message\n", Size,
+                ZeroCopy ? "OsMsgSendBuff()" : "OsMsgSend()",
+                (Now() - Start) / Loops);
+      }
+   }
+
+   /*------------------------------------------------------------------------*/
+   /* More than the buffer holds can't be sent, and it stays ours...         */
+   /*------------------------------------------------------------------------*/
+   if (OsBuffAlloc(&Buff, 64) != SYSOK ||
+       OsMsgSendBuff(RecvPid, Buff, 4096, False) != SYSERR ||
+       OsBuffFree(Buff) != SYSOK)
+      Errors++;
+
+   /*------------------------------------------------------------------------*/
+   /* OsMsgRecv() copies a buffer or inline data out, so OsFree() can free   */
+   /* what it got...                                                         */
+   /*------------------------------------------------------------------------*/
+   Size = 64;
+   if (OsBuffAlloc(&Buff, Size) != SYSOK)
+      Errors++;
+   else {
+      Fill(Buff, 7);
+      if (OsMsgSendBuff(OsGetPid(), Buff, Size, False) != SYSOK ||
+          OsMsgRecv((void **) &Msg, &Length, True) != SYSOK ||
+          Length != Size || Msg == Buff || ((STAMP *) Msg)->Seq != 7)
+         Errors++;
+      else
+         OsFree(Msg);
+   }
+   if (OsMsgSend(OsGetPid(), Copy, Size, False) != SYSOK ||
+       OsMsgRecv((void **) &Msg, &Length, True) != SYSOK ||
+       Length != Size || memcmp(Msg, Copy, Size) != 0)
+      Errors++;
+   else
+      OsFree(Msg);
+
+   /*------------------------------------------------------------------------*/
+   /* Short copies went inline, and every message came back to the pool...   */
+   /*------------------------------------------------------------------------*/
+   OsMsgStats(&Stats);
+   printf("message pool %lu, high water %lu, in use %lu;"
+          " sends inline %lu, heap %lu\n", Stats.Blocks, Stats.HighWater,
+          Stats.InUse, Stats.Inline, Stats.Heap);
+   if (Stats.InUse != 0 || Stats.Inline != (ULONG) Loops + 1 ||
+       Stats.Heap != 2 * (ULONG) Loops)
+      Errors++;
+
+   printf(Errors ? "benchmsg: FAILED, %d errors\n" : "benchmsg: ok\n",
+          Errors);
+   OsTerm();
+   exit(Errors != 0);
+}
+
+
+static void Receiver( char *Data )
+{
+   BYTE    *Msg;
+   STAMP   *Stamp;
+   int      Length, j;
+   long     i;
+
+   for (;;) {
+      for (i = 0; i < Loops; i++) {
+         OsMsgRecvBuff((void **) &Msg, &Length, -1L);
+         Stamp = (STAMP *) Msg;
+
+         if (Length != Size || Stamp->Seq != i ||
+             (ZeroCopy ? Stamp->Self != Msg : Stamp->Self == Msg))
+            Errors++;
+         for (j = sizeof(STAMP); j < Length; j += 97)
+            if (Msg[j] != (BYTE) i)
+               Errors++;
+
+         OsMsgFree(Msg);
+      }
+      OsPost(Done);
+   }
+}
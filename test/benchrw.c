@@ -0,0 +1,165 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHRW.C                                             */
+/*                                                                           */
+/*             Title:  Read-mostly table benchmark.                          */
+/*                                                                           */
+/*       Description:  Four workers per CPU read a shared table, and every   */
+/*                     WRITES'th time rewrite it instead. The table is       */
+/*                     guarded by OsLock(), then by an RWLOCK preferring     */
+/*                     readers, then one preferring writers. Reports the     */
+/*                     CPU time of an access and accesses per second over    */
+/*                     all CPUs. Every so often a worker gives up the CPU    */
+/*                     while it holds the lock, so others have to wait       */
+/*                     even with one CPU. Readers check they never see a     */
+/*                     half written table. In an OS_SMP build the workers    */
+/*                     run on [cpus] CPUs.                                   */
+/*                                                                           */
+/*                     Usage: benchrw [cpus] [loops]                         */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  NTABLE       64               /* Entries in the table.              */
+#define  WRITES       1000             /* One access in this many writes.    */
+#define  YIELD        256              /* One in this many gives up the CPU. */
+#define  WORKERS      4                /* Workers per CPU.                   */
+
+#define  USE_LOCK     0                /* How the table is guarded.          */
+#define  USE_RW       1
+
+static void Worker( char *Data );
+
+static long    Loops = 1000000L;       /* Accesses per worker per test.      */
+static int     Use;
+static HANDLE  Lock;
+static RWLOCK  Rw;
+static HANDLE  Done;
+static volatile long Table[NTABLE];
+static long    Torn;                   /* Half written tables seen.          */
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static void Run( int Cpus, char *Name )
+{
+   double   Start, Wall;
+   int      i;
+
+   Start = Now();
+
+   for (i = 0; i < Cpus * WORKERS; i++)
+      OsCreate(Worker, 16384, 10, "Worker", NULL);
+   for (i = 0; i < Cpus * WORKERS; i++)
+      OsWait(Done);
+
+   Wall = Now() - Start;
+
+   printf("cpus %d  %-22s %7.1f ns/access  %6.2f M accesses/s\n", Cpus, Name,
+          Wall / (WORKERS * (double) Loops),
+          Cpus * WORKERS * Loops / Wall * 1e3);
+}
+
+
+int main( int argc, char *argv[] )
+{
+   int      Cpus = 1;
+
+   if (argc > 1)
+      Cpus  = atoi(argv[1]);
+   if (argc > 2)
+      Loops = atol(argv[2]);
+
+   OsInit();
+#if defined(OS_SMP)
+   Cpus = OsSmpStart(Cpus);
+#else
+   Cpus = 1;
+#endif
+
+   Done = OsSemCreate(0);
+
+   Use = USE_LOCK;
+   Run(Cpus, "OsLock");
+
+   Use = USE_RW;
+   OsRwCreate(&Rw, 0);
+   Run(Cpus, "OsRwRead/Write");
+   OsRwDelete(&Rw);
+
+   OsRwCreate(&Rw, OS_RW_WRITERS);
+   Run(Cpus, "OsRwRead/Write writers");
+   OsRwDelete(&Rw);
+
+   printf("torn reads %ld  %s\n", Torn, Torn ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Torn ? 1 : 0);
+}
+
+
+static void Worker( char *Data )
+{
+   long     i, j, First;
+   int      Write;
+
+   for (i = 0; i < Loops; i++) {
+      Write = i % WRITES == 0;
+
+      if (Use == USE_LOCK)
+         OsLock(&Lock);
+      else if (Write)
+         OsRwWrite(&Rw);
+      else
+         OsRwRead(&Rw);
+
+      if (Write) {
+         for (j = 0; j < NTABLE; j++) {
+            Table[j] = i;
+            if (j == NTABLE / 2 && i % (YIELD * WRITES) == 0)
+               OsSched();              /* Let readers in, if they can.       */
+         }
+      } else {
+         First = Table[0];
+         for (j = 1; j < NTABLE; j++)
+            if (Table[j] != First) {
+               OsDisable();
+               Torn++;
+               OsEnable();
+               break;
+            }
+         if (i % YIELD == 1)
+            OsSched();                 /* Others may come in, or wait.       */
+      }
+
+      if (Use == USE_LOCK)
+         OsUnlock(&Lock);
+      else
+         OsRwUnlock(&Rw);
+   }
+
+   OsPost(Done);
+}
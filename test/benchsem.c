@@ -0,0 +1,147 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHSEM.C                                            */
+/*                                                                           */
+/*             Title:  Semaphore benchmark (hosted build).                   */
+/*                                                                           */
+/*       Description:  Uncontended: one process posts and then waits, so     */
+/*                     nothing ever blocks. Contended: two processes hand    */
+/*                     control back and forth with a post and a wait on two  */
+/*                     semaphores, so every wait blocks (a round trip is two */
+/*                     posts, two waits and two context switches). Each is   */
+/*                     run with handle semaphores (OsPost(), OsWait()) and   */
+/*                     with fast semaphores (OsFastPost(), OsFastWait()).    */
+/*                                                                           */
+/*                     Usage: benchsem [loops]                               */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "os.h"
+
+static void Ping( char *Data );
+static void Pong( char *Data );
+
+static long    Loops = 1000000L;       /* Round trips.                       */
+
+static int     Fast;                   /* Pong uses fast semaphores.         */
+static HANDLE  PingSem;
+static HANDLE  PongSem;
+static FASTSEM PingFast;
+static FASTSEM PongFast;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   if (argc > 1)
+      Loops = atol(argv[1]);
+
+   OsInit();
+
+   PingSem = OsSemCreate(0);
+   PongSem = OsSemCreate(0);
+   OsFastSemCreate(&PingFast, 0);
+   OsFastSemCreate(&PongFast, 0);
+
+   if (OsCreate(Ping, 16384, 10, "Ping", NULL) == SYSERR ||
+       OsCreate(Pong, 16384, 10, "Pong", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Ping( char *Data )
+{
+   HANDLE   Sem;
+   FASTSEM  Uncont;
+   double   Start;
+   long     i;
+
+   /*------------------------------------------------------------------------*/
+   /* Uncontended...                                                         */
+   /*------------------------------------------------------------------------*/
+   Sem   = OsSemCreate(0);
+   Start = Now();
+   for (i = 0; i < Loops; i++) {
+      OsPost(Sem);
+      OsWait(Sem);
+   }
+   printf("uncontended OsPost+OsWait         %8.1f ns\n",
+          (Now() - Start) / Loops);
+
+   OsFastSemCreate(&Uncont, 0);
+   Start = Now();
+   for (i = 0; i < Loops; i++) {
+      OsFastPost(&Uncont);
+      OsFastWait(&Uncont);
+   }
+   printf("uncontended OsFastPost+OsFastWait %8.1f ns\n",
+          (Now() - Start) / Loops);
+
+   /*------------------------------------------------------------------------*/
+   /* Contended, ping-pong...                                                */
+   /*------------------------------------------------------------------------*/
+   Start = Now();
+   for (i = 0; i < Loops; i++) {
+      OsPost(PongSem);
+      OsWait(PingSem);
+   }
+   printf("contended   OsPost/OsWait         %8.1f ns/round trip\n",
+          (Now() - Start) / Loops);
+
+   Fast  = 1;
+   OsPost(PongSem);                    /* Pong switches to fast semaphores.  */
+   OsWait(PingSem);
+
+   Start = Now();
+   for (i = 0; i < Loops; i++) {
+      OsFastPost(&PongFast);
+      OsFastWait(&PingFast);
+   }
+   printf("contended   OsFastPost/OsFastWait %8.1f ns/round trip\n",
+          (Now() - Start) / Loops);
+
+   OsTerm();
+   exit(0);
+}
+
+
+static void Pong( char *Data )
+{
+   while (!Fast) {
+      OsWait(PongSem);
+      OsPost(PingSem);
+   }
+
+   for (;;) {
+      OsFastWait(&PongFast);
+      OsFastPost(&PingFast);
+   }
+}
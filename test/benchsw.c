@@ -0,0 +1,147 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  BENCHSW.C                                             */
+/*                                                                           */
+/*             Title:  Context switch benchmark (hosted build).              */
+/*                                                                           */
+/*       Description:  Ping-pong between two contexts and report the cost    */
+/*                     of one switch:                                        */
+/*                                                                           */
+/*                     OsSwitch    - bare OsSwitch() between two frames      */
+/*                                   built by OsHostFrame().                 */
+/*                     swapcontext - the same with the host's ucontext       */
+/*                                   routines, for comparison.               */
+/*                     OsSched     - two equal priority processes yielding   */
+/*                                   to each other through the scheduler.    */
+/*                                                                           */
+/*                     Usage: benchsw [iterations]                           */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "oskernel.h"
+
+#define  STACK_SIZE   65536
+
+static long        Loops = 1000000L;   /* Round trips per test.              */
+
+static BYTE       *MainStack;          /* Saved context of main line.        */
+static BYTE       *PeerStack;          /* Saved context of peer.             */
+
+static ucontext_t  MainContext;
+static ucontext_t  PeerContext;
+
+static void Peer(  char *Data );
+static void Bounce( void );
+static void Yield( char *Data );
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e9 + Ts.tv_nsec;
+}
+
+
+static void Report( char *Name, double Start, double End )
+{
+   printf("%-12s %10ld round trips  %8.1f ns/switch\n",
+          Name, Loops, (End - Start) / (Loops * 2.0));
+}
+
+
+int main( int argc, char *argv[] )
+{
+   BYTE    *Stack;
+   double   Start;
+
+   if (argc > 1)
+      Loops = atol(argv[1]);
+
+   /*------------------------------------------------------------------------*/
+   /* Bare OsSwitch(), kernel not yet started...                             */
+   /*------------------------------------------------------------------------*/
+
+   Stack     = malloc(STACK_SIZE);
+   MainStack = OsHostFrame(NULL,  0,          NULL, NULL);
+   PeerStack = OsHostFrame(Stack, STACK_SIZE, Peer, NULL);
+
+   Start = Now();
+   for (long i = 0; i < Loops; i++)
+      OsSwitch(&MainStack, &PeerStack);
+   Report("OsSwitch", Start, Now());
+
+   /*------------------------------------------------------------------------*/
+   /* Host swapcontext()...                                                  */
+   /*------------------------------------------------------------------------*/
+
+   getcontext(&PeerContext);
+   PeerContext.uc_stack.ss_sp   = malloc(STACK_SIZE);
+   PeerContext.uc_stack.ss_size = STACK_SIZE;
+   PeerContext.uc_link          = NULL;
+   makecontext(&PeerContext, Bounce, 0);
+
+   Start = Now();
+   for (long i = 0; i < Loops; i++)
+      swapcontext(&MainContext, &PeerContext);
+   Report("swapcontext", Start, Now());
+
+   /*------------------------------------------------------------------------*/
+   /* Scheduler round robin between two processes...                         */
+   /*------------------------------------------------------------------------*/
+
+   OsInit();
+
+   if (OsCreate(Yield, 8192, 10, "Ping", NULL) == SYSERR ||
+       OsCreate(Yield, 8192, 10, "Pong", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   Start = Now();
+   OsSched();                          /* Back here when both have ended.    */
+   Report("OsSched", Start, Now());
+
+   OsTerm();
+
+   return 0;
+}
+
+
+static void Peer( char *Data )
+{
+   for (;;)
+      OsSwitch(&PeerStack, &MainStack);
+}
+
+
+static void Bounce( void )
+{
+   for (;;)
+      swapcontext(&PeerContext, &MainContext);
+}
+
+
+static void Yield( char *Data )
+{
+   for (long i = 0; i < Loops; i++)
+      OsSched();
+}
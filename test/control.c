@@ -269,4 +269,3 @@ Bool Hex(char *Str, unsigned int   *Result)
    }
    return True;
 }
-
\ No newline at end of file
@@ -76,4 +76,3 @@ void main ()
 
    OsTerm();                           /* Terminate OS KERNEL.               */
 }
-
\ No newline at end of file
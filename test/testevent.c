@@ -0,0 +1,191 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTEVENT.C                                           */
+/*                                                                           */
+/*             Title:  Test event flag groups and buffer pool waits.         */
+/*                                                                           */
+/*       Description:  Waiters on one group wait for any or all of their     */
+/*                     flags, some clearing them. Checks who one OsEventSet()*/
+/*                     wakes, that all see the flags before they are         */
+/*                     cleared, timeouts, deleting and killing. Then uses up */
+/*                     a buffer pool and checks a blocked OsBuffAlloc() gets */
+/*                     the buffer OsBuffFree() returns.                      */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+#define  NBROAD       5                /* Waiters for one broadcast.         */
+#define  NBUFF        5                /* Buffers in the 8192 byte pool.     */
+
+static void Driver(  char *Data );
+static void Waiter(  char *Data );
+static void Alloc(   char *Data );
+
+typedef struct {                       /* What a Waiter waits for.           */
+   ULONG    Mask;
+   int      Options;
+} WANT;
+
+static WANT    Any1   = { 0x1, OS_EVENT_ANY };
+static WANT    All3   = { 0x3, OS_EVENT_ALL };
+static WANT    Clear2 = { 0x2, OS_EVENT_ANY | OS_EVENT_CLEAR };
+static WANT    Clear4 = { 0x4, OS_EVENT_ANY | OS_EVENT_CLEAR };
+
+static HANDLE  Event;
+static int     Woke, Errors;
+static ULONG   Seen;                   /* Flags each woken waiter saw, ORed. */
+static void   *Got;                    /* Buffer Alloc got.                  */
+static int     Failed;
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+static ULONG Flags( void )             /* Flag word of the group.            */
+{
+   return ((EVENTGROUP *) OsHandFind(EventGroupAnchor, Event))->Flags;
+}
+
+
+static int Waiting( void )             /* Anyone on the group?               */
+{
+   return ChainFirst(&((EVENTGROUP *) OsHandFind(EventGroupAnchor, Event))
+                     ->Waiters) != NULL;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   if (OsCreate(Driver, 16384, 20, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   void    *Buff[NBUFF];
+   ULONG    F;
+   HANDLE   Pid;
+   int      i;
+
+   Event = OsEventCreate(0);
+
+   /*------------------------------------------------------------------------*/
+   /* Any, all and clear...                                                  */
+   /*------------------------------------------------------------------------*/
+   OsCreate(Waiter, 16384, 10, "Any1",   (char *) &Any1);
+   OsCreate(Waiter, 16384, 10, "All3",   (char *) &All3);
+   OsCreate(Waiter, 16384, 10, "Clear2", (char *) &Clear2);
+   OsSleep(1);
+
+   OsEventSet(Event, 0x2);
+   OsSleep(1);
+   Check(Woke == 1 && Flags() == 0, "Clear2 woken, flag cleared");
+
+   OsEventSet(Event, 0x3);
+   OsSleep(1);
+   Check(Woke == 3 && Flags() == 0x3 && !Waiting(), "Any1 and All3 woken");
+
+   Check(OsEventWait(Event, 0x3, OS_EVENT_ALL | OS_EVENT_CLEAR, &F) == SYSOK &&
+         F == 0x3 && Flags() == 0, "Set already");
+
+   /*------------------------------------------------------------------------*/
+   /* One set wakes everyone it satisfies...                                 */
+   /*------------------------------------------------------------------------*/
+   Woke = 0;
+   Seen = 0;
+   for (i = 0; i < NBROAD; i++)
+      OsCreate(Waiter, 16384, 10, "Clear4", (char *) &Clear4);
+   OsSleep(1);
+   OsEventSet(Event, 0x4);
+   OsSleep(1);
+   Check(Woke == NBROAD && Seen == 0x4 && Flags() == 0, "Broadcast");
+
+   /*------------------------------------------------------------------------*/
+   /* Timeout, delete and kill...                                            */
+   /*------------------------------------------------------------------------*/
+   Check(OsEventWaitTimeout(Event, 0x8, OS_EVENT_ANY, &F, 0) == SYSTIMEOUT,
+         "Don't wait");
+   Check(OsEventWaitTimeout(Event, 0x8, OS_EVENT_ANY, &F, 3) == SYSTIMEOUT &&
+         !Waiting(), "Timeout");
+
+   Pid = OsCreate(Waiter, 16384, 10, "Any1", (char *) &Any1);
+   OsSleep(1);
+   OsKill(Pid);
+   Check(!Waiting(), "Killed waiter off group");
+
+   Woke = 0;
+   OsCreate(Waiter, 16384, 10, "Any1", (char *) &Any1);
+   OsSleep(1);
+   OsEventDelete(Event);
+   OsSleep(1);
+   Check(Errors == 1 && Woke == 0, "Delete wakes with SYSERR");
+   Check(OsEventSet(Event, 1) == SYSERR, "Deleted");
+
+   /*------------------------------------------------------------------------*/
+   /* Buffer pool: use it up, and free one to a blocked allocator...         */
+   /*------------------------------------------------------------------------*/
+   for (i = 0; i < NBUFF; i++)
+      Check(OsBuffAlloc(&Buff[i], 8000) == SYSOK, "OsBuffAlloc()");
+   OsCreate(Alloc, 16384, 10, "Alloc", NULL);
+   OsSleep(1);
+   Check(Got == NULL, "Pool used up");
+   OsBuffFree(Buff[0]);
+   OsSleep(1);
+   Check(Got == Buff[0], "Freed buffer handed on");
+
+   printf("testevent %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Waiter( char *Data )
+{
+   WANT    *Want = (WANT *) Data;
+   ULONG    F;
+
+   if (OsEventWait(Event, Want->Mask, Want->Options, &F) == SYSOK) {
+      Seen |= F;
+      Woke++;
+   } else
+      Errors++;
+}
+
+
+static void Alloc( char *Data )
+{
+   void    *Buff;
+
+   if (OsBuffAlloc(&Buff, 8000) == SYSOK)
+      Got = Buff;
+}
@@ -7,4 +7,3 @@ main (argc, argv)
 
    printf("Hello World\n");
 }
-
\ No newline at end of file
@@ -0,0 +1,206 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTORDER.C                                           */
+/*                                                                           */
+/*             Title:  Test OS_ORDER_FIFO and OS_ORDER_PRIO wait queues.     */
+/*                                                                           */
+/*       Description:  Processes of mixed priority queue up on a semaphore   */
+/*                     or lock, and are let go one at a time. Checks they go */
+/*                     in order of arrival by default and most urgent first  */
+/*                     with OS_ORDER_PRIO, also when a waiter's priority is  */
+/*                     raised by inheritance while it waits. A lock word set */
+/*                     back to zero is FIFO again.                           */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+#define  NWAITER      4
+
+static void Driver(  char *Data );
+static void SemUser( char *Data );
+static void LockUser(char *Data );
+static void Holder(  char *Data );
+static void Booster( char *Data );
+
+static int     Prios[NWAITER] = { 5, 15, 10, 20 };   /* In order of arrival. */
+static int     Fifo[NWAITER]  = { 5, 15, 10, 20 };
+static int     Urgent[NWAITER] = { 20, 15, 10, 5 };
+
+static HANDLE  Sem, Done;
+static HANDLE  Lock, Other;
+static int     Got[NWAITER];           /* Priorities in the order they went. */
+static int     NGot;
+static int     Failed;
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+static int Same( int *Want, int n )
+{
+   int      i;
+
+   for (i = 0; i < n; i++)
+      if (Got[i] != Want[i])
+         return False;
+   return NGot == n;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   Sem  = OsSemCreate(0);
+   Done = OsSemCreate(0);
+
+   if (OsCreate(Driver, 16384, 30, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void SemRound( void )           /* Queue all, post one at a time.     */
+{
+   int      i;
+
+   NGot = 0;
+   for (i = 0; i < NWAITER; i++) {
+      OsCreate(SemUser, 16384, Prios[i], "SemUser", NULL);
+      OsSleep(1);                      /* Let it queue before the next.      */
+   }
+
+   for (i = 0; i < NWAITER; i++) {
+      OsPost(Sem);
+      OsWait(Done);
+   }
+}
+
+
+static void LockRound( void )          /* Queue all, unlock to let them go.  */
+{
+   int      i;
+
+   NGot = 0;
+   OsLock(&Lock);
+   for (i = 0; i < NWAITER; i++) {
+      OsCreate(LockUser, 16384, Prios[i], "LockUser", NULL);
+      OsSleep(1);
+   }
+   OsUnlock(&Lock);
+
+   for (i = 0; i < NWAITER; i++)
+      OsWait(Done);
+}
+
+
+static void Driver( char *Data )
+{
+   int      Boosted[3] = { 5, 15, 10 };
+
+   SemRound();
+   Check(Same(Fifo, NWAITER), "Semaphore FIFO");
+
+   Check(OsSemOrder(Sem, OS_ORDER_PRIO) == SYSOK, "OsSemOrder()");
+   SemRound();
+   Check(Same(Urgent, NWAITER), "Semaphore by priority");
+
+   LockRound();
+   Check(Same(Fifo, NWAITER), "Lock FIFO");
+
+   Check(OsLockOrder(&Lock, OS_ORDER_PRIO) == SYSOK, "OsLockOrder()");
+   LockRound();
+   Check(Same(Urgent, NWAITER), "Lock by priority");
+
+   /*------------------------------------------------------------------------*/
+   /* Holder (5) holds Other and waits on Sem behind 15 and 10. Booster (25) */
+   /* wants Other, so Holder inherits 25 and should be posted first...       */
+   /*------------------------------------------------------------------------*/
+   NGot = 0;
+   OsCreate(Holder,  16384, 5,  "Holder",  NULL);
+   OsCreate(SemUser, 16384, 15, "SemUser", NULL);
+   OsCreate(SemUser, 16384, 10, "SemUser", NULL);
+   OsSleep(1);
+   Check(OsSemOrder(Sem, OS_ORDER_FIFO) == SYSERR, "Reorder with waiters");
+   OsCreate(Booster, 16384, 25, "Booster", NULL);
+   OsSleep(1);
+   OsPost(Sem);  OsWait(Done);         /* Holder, then Booster once it       */
+   OsWait(Done);                       /* gets Other.                        */
+   OsPost(Sem);  OsWait(Done);
+   OsPost(Sem);  OsWait(Done);
+   Check(Same(Boosted, 3), "Raised waiter moves up");
+
+   Check(OsLockOrder(&Lock, OS_ORDER_FIFO) == SYSOK, "OsLockOrder() back");
+   LockRound();
+   Check(Same(Fifo, NWAITER), "Lock FIFO again");
+
+   OsLockOrder(&Lock, OS_ORDER_PRIO);  /* A new lock in the same place       */
+   Lock = 0;                           /* starts out FIFO.                   */
+   LockRound();
+   Check(Same(Fifo, NWAITER), "New lock word FIFO");
+
+   printf("testorder %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void SemUser( char *Data )
+{
+   OsWait(Sem);
+   Got[NGot++] = CurrProc->BasePrio;   /* Own, not inherited.                */
+   OsPost(Done);
+}
+
+
+static void LockUser( char *Data )
+{
+   OsLock(&Lock);
+   Got[NGot++] = CurrProc->BasePrio;   /* Own, not inherited.                */
+   OsUnlock(&Lock);
+   OsPost(Done);
+}
+
+
+static void Holder( char *Data )
+{
+   OsLock(&Other);
+   OsWait(Sem);
+   Got[NGot++] = CurrProc->BasePrio;   /* Own, not inherited.                */
+   OsUnlock(&Other);
+   OsPost(Done);
+}
+
+
+static void Booster( char *Data )
+{
+   OsLock(&Other);
+   OsUnlock(&Other);
+   OsPost(Done);
+}
@@ -35,7 +35,7 @@ static HANDLE Sem2;
 static HANDLE Sem3;
 
 
-void main ()
+int main ()
 {
    HANDLE  Pid;
 
@@ -87,15 +87,17 @@ void main ()
 
    while (1) {
 
-      OsSched();
+      OsIdle();
 
+#if !defined(OS_HOSTED)                /* No console keyboard on the host.   */
       if (kbhit())
          if (toupper(getch()) == 'Y')
             break;
-
+#endif
    }
 
    OsTerm();                           /* Terminate OS KERNEL.               */
+   return 0;
 }
 
 
@@ -125,9 +127,9 @@ static void Task2( char far *Data )
    printf("Before 200 wait\n");
    OsSleep(200);
    printf("After 200 wait\n");
-   printf("Task %s waiting on Sem %d\n", Data, Sem1 );
+   printf("Task %s waiting on Sem %lu\n", Data, Sem1 );
    OsWait(Sem1);
-   printf("Task %s return from waiting on Sem %d\n", Data, Sem1 );
+   printf("Task %s return from waiting on Sem %lu\n", Data, Sem1 );
    OsSuspend( OsGetPid() );
 }
 
@@ -159,4 +161,3 @@ static void Task4( char far *Data )
 
    OsSuspend( OsGetPid() );
 }
-
\ No newline at end of file
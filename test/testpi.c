@@ -0,0 +1,179 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTPI.C                                              */
+/*                                                                           */
+/*             Title:  Test priority inheritance of OsLock().                */
+/*                                                                           */
+/*       Description:  Classic priority inversion: Low holds a lock that     */
+/*                     High wants while Medium, which does not use the lock, */
+/*                     has work to do. Reports the worst time High waited    */
+/*                     for the lock, with LockInherit on and then off. With  */
+/*                     inheritance Low finishes ahead of Medium, so High     */
+/*                     waits only for the rest of Low's critical section.    */
+/*                                                                           */
+/*                     Usage: testpi [rounds]                                */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  LOW          5                /* Priorities.                        */
+#define  MEDIUM       10
+#define  HIGH         20
+#define  DRIVER       30
+
+#define  CRITICAL     30               /* Low's time holding lock, millisecs.*/
+#define  HOG          100              /* Medium's work, millisecs.          */
+
+static void Driver( char *Data );
+static void Low(    char *Data );
+static void Medium( char *Data );
+static void High(   char *Data );
+
+static int           Rounds = 5;
+static volatile long PerMs;            /* Work loops per millisecond.        */
+static double        Worst;            /* Longest wait for lock this pass.   */
+
+static HANDLE        Lock;             /* The contended lock.                */
+static HANDLE        LowGo, MediumGo, HighGo, Done;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e3 + Ts.tv_nsec / 1e6;
+}
+
+
+static void Work( int Millisecs )      /* Burn CPU, not wall clock time.     */
+{
+   volatile long  i;
+
+   for (i = 0; i < PerMs * Millisecs; i++)
+      ;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   double   Start;
+
+   if (argc > 1)
+      Rounds = atoi(argv[1]);
+
+   PerMs = 1000000L;                   /* Calibrate Work().                  */
+   Start = Now();
+   Work(20);
+   PerMs = (long) (PerMs * 20 / (Now() - Start));
+
+   OsInit();
+
+   OsQuantum(LOW,    1);               /* Waking sleepers preempt these.     */
+   OsQuantum(MEDIUM, 1);
+
+   LowGo    = OsSemCreate(0);
+   MediumGo = OsSemCreate(0);
+   HighGo   = OsSemCreate(0);
+   Done     = OsSemCreate(0);
+
+   if (OsCreate(Driver, 16384, DRIVER, "Driver", NULL) == SYSERR ||
+       OsCreate(Low,    16384, LOW,    "Low",    NULL) == SYSERR ||
+       OsCreate(Medium, 16384, MEDIUM, "Medium", NULL) == SYSERR ||
+       OsCreate(High,   16384, HIGH,   "High",   NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   double   With = 0, Without = 0;
+   int      Pass, i;
+
+   for (Pass = 1; Pass >= 0; Pass--) {
+      LockInherit = Pass;
+      Worst       = 0;
+
+      for (i = 0; i < Rounds; i++) {
+         OsPost(LowGo);                /* Low takes the lock...              */
+         OsSleep(1);
+         OsPost(HighGo);               /* ...then High wants it while        */
+         OsPost(MediumGo);             /* Medium has work to do.             */
+         OsWait(Done);
+         OsWait(Done);
+         OsWait(Done);
+      }
+
+      if (Pass)
+         With    = Worst;
+      else
+         Without = Worst;
+   }
+
+   OsTerm();
+
+   printf("worst wait for lock: inheritance %.1f ms, none %.1f ms  %s\n",
+          With, Without, With < Without / 2 ? "ok" : "FAILED");
+
+   exit(With < Without / 2 ? 0 : 1);
+}
+
+
+static void Low( char *Data )
+{
+   for (;;) {
+      OsWait(LowGo);
+      OsLock(&Lock);
+      Work(CRITICAL);
+      OsUnlock(&Lock);
+      OsPost(Done);
+   }
+}
+
+
+static void Medium( char *Data )
+{
+   for (;;) {
+      OsWait(MediumGo);
+      Work(HOG);
+      OsPost(Done);
+   }
+}
+
+
+static void High( char *Data )
+{
+   double   Start, Wait;
+
+   for (;;) {
+      OsWait(HighGo);
+      Start = Now();
+      OsLock(&Lock);
+      Wait  = Now() - Start;
+      OsUnlock(&Lock);
+      if (Wait > Worst)
+         Worst = Wait;
+      OsPost(Done);
+   }
+}
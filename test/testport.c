@@ -0,0 +1,259 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTPORT.C                                            */
+/*                                                                           */
+/*             Title:  Test named message ports.                             */
+/*                                                                           */
+/*       Description:  A pool of workers that found their port by name       */
+/*                     waits on it; checks each message goes to one idle     */
+/*                     worker, the longest waiting, and none is lost or      */
+/*                     doubled. A killed worker comes off the port and a     */
+/*                     restarted one just opens it again. Subscribers to a   */
+/*                     broadcast port each get every message in order until  */
+/*                     they leave. Then timeouts, names and deleting, and    */
+/*                     that every message went back to the pool.             */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+#define  NWORK        4                /* Workers on the balanced port.      */
+#define  NSUB         3                /* Subscribers to the broadcast port. */
+#define  NROUND       3                /* Rounds of one message per worker.  */
+#define  NSEQ         64               /* Most messages sent to workers.     */
+#define  LEAVEAT      1                /* Subscriber 0 leaves after this.    */
+
+static void Driver(     char *Data );
+static void Worker(     char *Data );
+static void Subscriber( char *Data );
+
+typedef struct {
+   long     Seq;                       /* Sequence number.                   */
+   char     Pad[120];                  /* Longer ones go to the heap.        */
+} MSG;
+
+static HANDLE  Work, News;
+static int     Got[NWORK + 1];         /* Messages each worker got.          */
+static int     Seen[NSEQ];             /* Times each message was got.        */
+static int     Heard[NSUB];            /* Broadcasts each subscriber got.    */
+static int     Errors;                 /* Receives that returned SYSERR.     */
+static int     Failed;
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+static int Waiting( HANDLE Port )      /* Receivers on the port.             */
+{
+   PORT     *P = (PORT *) OsHandFind(PortAnchor, Port);
+   PORTWAIT *W;
+   int       n = 0;
+
+   for (W = ChainFirst(&P->Q.Waiters); W; W = ChainNext(&W->Link))
+      n++;
+   return n;
+}
+
+
+static void Send( HANDLE Port, long Seq )
+{
+   MSG      Msg;
+
+   Msg.Seq = Seq;
+   Check(OsPortSend(Port, &Msg, Seq & 1 ? sizeof(Msg) : sizeof(long)) ==
+         SYSOK, "OsPortSend()");
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   if (OsCreate(Driver, 16384, 20, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   MSGSTATS Stats;
+   HANDLE   Pid[NWORK], Port;
+   void    *Msg;
+   long     Seq = 0;
+   int      Length, Even, i, r;
+
+   /*------------------------------------------------------------------------*/
+   /* Names...                                                               */
+   /*------------------------------------------------------------------------*/
+   Work = OsPortCreate("work", OS_PORT_BALANCE);
+   Check(Work != SYSERR, "OsPortCreate()");
+   Check(OsPortCreate("work", OS_PORT_BALANCE) == SYSERR, "Name taken");
+   Check(OsPortOpen("work") == Work, "OsPortOpen()");
+   Check(OsPortOpen("none") == SYSERR, "OsPortOpen() of no port");
+
+   /*------------------------------------------------------------------------*/
+   /* Each message to one idle worker, the one that waited longest...        */
+   /*------------------------------------------------------------------------*/
+   for (i = 0; i < NWORK; i++)
+      Pid[i] = OsCreate(Worker, 16384, 10, "Worker", (char *) (long) i);
+   OsSleep(1);
+   Check(Waiting(Work) == NWORK, "Workers wait");
+
+   for (r = 0; r < NROUND; r++) {
+      for (i = 0; i < NWORK; i++)
+         Send(Work, Seq++);
+      OsSleep(1);
+   }
+   Even = 1;
+   for (i = 0; i < NWORK; i++)
+      Even &= Got[i] == NROUND;
+   Check(Even, "Balanced over idle workers");
+
+   /*------------------------------------------------------------------------*/
+   /* Queued while all are busy, taken by whoever asks next...               */
+   /*------------------------------------------------------------------------*/
+   for (i = 0; i < 2 * NWORK; i++)
+      Send(Work, Seq++);
+   OsSleep(1);
+   Check(Waiting(Work) == NWORK, "Queued ones taken");
+
+   /*------------------------------------------------------------------------*/
+   /* A killed worker is off the port, a restarted one opens it again...     */
+   /*------------------------------------------------------------------------*/
+   OsKill(Pid[0]);
+   Check(Waiting(Work) == NWORK - 1, "Killed worker off port");
+   Got[NWORK] = 0;
+   OsCreate(Worker, 16384, 10, "Worker", (char *) (long) NWORK);
+   OsSleep(1);
+   for (i = 0; i < NWORK; i++)
+      Send(Work, Seq++);
+   OsSleep(1);
+   Check(Got[NWORK] == 1, "Restarted worker gets work");
+
+   Even = 1;
+   for (i = 0; i < Seq; i++)
+      Even &= Seen[i] == 1;
+   Check(Even, "Each message got once");
+
+   /*------------------------------------------------------------------------*/
+   /* Broadcast to every member, in order, until it leaves...                */
+   /*------------------------------------------------------------------------*/
+   News = OsPortCreate("news", OS_PORT_BROADCAST);
+   Check(OsPortRecv(News, &Msg, &Length, 0) == SYSERR, "Not a member");
+   Send(News, 100);                    /* No members, no one gets it.        */
+   for (i = 0; i < NSUB; i++)
+      OsCreate(Subscriber, 16384, 10, "Subscri", (char *) (long) i);
+   OsSleep(1);
+   for (i = 0; i < 4; i++)
+      Send(News, i);
+   OsSleep(1);
+   Check(Heard[0] == LEAVEAT + 1 && Heard[1] == 4 && Heard[2] == 4,
+         "Broadcast");
+
+   /*------------------------------------------------------------------------*/
+   /* Timeouts, on a port no one else receives from...                       */
+   /*------------------------------------------------------------------------*/
+   Port = OsPortCreate(NULL, OS_PORT_BALANCE);
+   Check(OsPortRecv(Port, &Msg, &Length, 0) == SYSTIMEOUT, "Don't wait");
+   Check(OsPortRecv(Port, &Msg, &Length, 3) == SYSTIMEOUT &&
+         Waiting(Port) == 0, "Timeout");
+   Send(Port, 7);
+   Check(OsPortRecv(Port, &Msg, &Length, 3) == SYSOK &&
+         *(long *) Msg == 7 && Length == sizeof(MSG), "Queued");
+   OsMsgFree(Msg);
+   Check(OsPortDelete(Port) == SYSOK, "OsPortDelete() unnamed");
+
+   /*------------------------------------------------------------------------*/
+   /* Delete wakes receivers with SYSERR, and frees what is left...          */
+   /*------------------------------------------------------------------------*/
+   Errors = 0;
+   Send(News, 4);                      /* Left on subscribers' queues.       */
+   OsPortDelete(News);
+   OsPortDelete(Work);
+   OsSleep(1);
+   Check(Errors == NWORK + NSUB - 1, "Delete wakes with SYSERR");
+   Check(OsPortSend(Work, &Msg, 4) == SYSERR, "Deleted");
+   Check(OsPortOpen("work") == SYSERR, "Name gone");
+
+   OsMsgStats(&Stats);
+   Check(Stats.InUse == 0, "Messages back in pool");
+
+   printf("testport %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Worker( char *Data )
+{
+   int      Me = (int) (long) Data;
+   HANDLE   Port = OsPortOpen("work");
+   MSG     *Msg;
+   int      Length;
+
+   for (;;) {
+      if (OsPortRecv(Port, (void **) &Msg, &Length, -1L) != SYSOK) {
+         Errors++;
+         return;
+      }
+      if (Msg->Seq >= 0 && Msg->Seq < NSEQ)
+         Seen[Msg->Seq]++;
+      Got[Me]++;
+      OsMsgFree(Msg);
+   }
+}
+
+
+static void Subscriber( char *Data )
+{
+   int      Me = (int) (long) Data;
+   HANDLE   Port = OsPortOpen("news");
+   MSG     *Msg;
+   long     Seq;
+   int      Length;
+
+   OsPortJoin(Port);
+
+   for (;;) {
+      if (OsPortRecv(Port, (void **) &Msg, &Length, -1L) != SYSOK) {
+         Errors++;
+         return;
+      }
+      Seq = Msg->Seq;
+      if (Seq == Heard[Me] &&
+          Length == (Seq & 1 ? sizeof(MSG) : sizeof(long)))
+         Heard[Me]++;
+      OsMsgFree(Msg);
+
+      if (Me == 0 && Seq == LEAVEAT) {
+         OsPortLeave(Port);
+         return;
+      }
+   }
+}
@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTPRE.C                                             */
+/*                                                                           */
+/*             Title:  Test preemptive time slicing.                         */
+/*                                                                           */
+/*       Description:  Two CPU bound processes share one priority and never  */
+/*                     call OsSched(). A higher priority monitor sleeps and  */
+/*                     then checks that both made progress. Without time     */
+/*                     slicing the first spinner would run forever.          */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os.h"
+
+static void Spin(    char far *Data );
+static void Monitor( char far *Data );
+
+static volatile long Count[2];
+
+
+int main( void )
+{
+   OsInit();                           /* Initialize kernel.                 */
+
+   OsQuantum(10, 2);                   /* Slice priority 10 every 2 ticks.   */
+
+   if (OsCreate(Monitor, 8192, 20, "Monitor", NULL)           == SYSERR ||
+       OsCreate(Spin,    8192, 10, "Spin0",   (char *) &Count[0]) == SYSERR ||
+       OsCreate(Spin,    8192, 10, "Spin1",   (char *) &Count[1]) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Spin( char far *Data )
+{
+   volatile long *Counter = (volatile long *) Data;
+
+   for (;;)
+      (*Counter)++;
+}
+
+
+static void Monitor( char far *Data )
+{
+   long  c0, c1;
+
+   OsSleep(100);                       /* Let the spinners run a second.     */
+
+   c0 = Count[0];
+   c1 = Count[1];
+
+   OsTerm();
+
+   printf("Spin0 %ld  Spin1 %ld  %s\n", c0, c1,
+          c0 > 0 && c1 > 0 ? "ok" : "FAILED");
+
+   exit(c0 > 0 && c1 > 0 ? 0 : 1);
+}
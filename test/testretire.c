@@ -0,0 +1,146 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTRETIRE.C                                          */
+/*                                                                           */
+/*             Title:  Test OsHandRetire(), killing a process in use.        */
+/*                                                                           */
+/*       Description:  Holder protects the Pid of Victim and waits. Driver   */
+/*                     kills Victim, which must return at once (it used to   */
+/*                     wait for Holder, which waits for Driver), leave the   */
+/*                     Pid unfindable and keep the process out of the pool   */
+/*                     until Holder lets it go. Then the same for a retired  */
+/*                     semaphore handle, freed through a counting Free       */
+/*                     routine.                                              */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+static void Driver( char *Data );
+static void Victim( char *Data );
+static void Holder( char *Data );
+
+static HANDLE  VictimPid;
+static HANDLE  Held, Release, Done;
+static int     Freed;                  /* Calls of CountFree().              */
+static int     Failed;
+
+
+static int Pooled( void )              /* Dead processes in the pools.       */
+{
+   int   i, n = 0;
+
+   for (i = 0; i < NPOOL; i++)
+      n += PoolCount[i];
+   return n;
+}
+
+
+static int CountFree( void *Resource )
+{
+   Freed++;
+   return SYSOK;
+}
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   Held    = OsSemCreate(0);
+   Release = OsSemCreate(0);
+   Done    = OsSemCreate(0);
+
+   if (OsCreate(Driver, 16384, 20, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   HANDLE   Sem;
+   int      Before;
+
+   /*------------------------------------------------------------------------*/
+   /* Kill a process whose Pid someone else holds...                         */
+   /*------------------------------------------------------------------------*/
+   VictimPid = OsCreate(Victim, 16384, 10, "Victim", NULL);
+   OsCreate(Holder, 16384, 10, "Holder", NULL);
+   OsWait(Held);
+
+   Before = Pooled();
+   Check(OsKill(VictimPid) == SYSOK, "OsKill");
+   Check(OsHandFind(ProcessAnchor, VictimPid) == NULL, "Pid unpublished");
+   Check(Pooled() == Before,         "Process kept while held");
+
+   OsPost(Release);
+   OsWait(Done);
+   Check(Pooled() == Before + 1,     "Process pooled when let go");
+
+   /*------------------------------------------------------------------------*/
+   /* Retire a semaphore handle, held and not held...                        */
+   /*------------------------------------------------------------------------*/
+   Sem = OsSemCreate(0);
+   OsHandProtect(SemaphoreAnchor, Sem);
+   Check(OsHandRetire(SemaphoreAnchor, Sem, CountFree) == SYSOK, "Retire");
+   Check(OsHandRetire(SemaphoreAnchor, Sem, CountFree) == SYSERR,
+         "Retire twice");
+   Check(OsHandProtect(SemaphoreAnchor, Sem) == NULL, "Protect retired");
+   Check(Freed == 0,                 "Resource kept while held");
+   OsHandUnprotect(SemaphoreAnchor, Sem);
+   Check(Freed == 1,                 "Resource freed when let go");
+   Check(OsHandUnprotect(SemaphoreAnchor, Sem) == SYSERR, "Stale handle");
+
+   Sem = OsSemCreate(0);
+   Check(OsHandRetire(SemaphoreAnchor, Sem, CountFree) == SYSOK &&
+         Freed == 2,                 "Retire unused");
+
+   printf("testretire %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Victim( char *Data )
+{
+   OsSuspend(OsGetPid());
+}
+
+
+static void Holder( char *Data )
+{
+   OsHandProtect(ProcessAnchor, VictimPid);
+   OsPost(Held);
+   OsWait(Release);
+   OsHandUnprotect(ProcessAnchor, VictimPid);
+   OsPost(Done);
+}
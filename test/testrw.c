@@ -0,0 +1,151 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTRW.C                                              */
+/*                                                                           */
+/*             Title:  Test RWLOCK waiters that are killed while they wait.  */
+/*                                                                           */
+/*       Description:  A reader blocked behind a writer, and a writer        */
+/*                     blocked behind a reader, are killed. The lock must    */
+/*                     then go to those still waiting, and later to new      */
+/*                     readers and writers, as if the dead had never come.   */
+/*                     Workers are waited for with a timeout, so one that    */
+/*                     never gets the lock fails the test instead of hanging */
+/*                     it.                                                   */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+#define  PATIENCE     100              /* Hundreds to wait for a worker.     */
+
+static void Driver( char *Data );
+static void Reader( char *Data );
+static void Writer( char *Data );
+
+static RWLOCK  Rw;
+static HANDLE  Done;
+static int     Failed;
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   Done = OsSemCreate(0);
+
+   if (OsCreate(Driver, 16384, 30, "Driver", NULL) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static HANDLE Start( void (*Worker)(char *) )   /* Start one, let it block.  */
+{
+   HANDLE   Pid;
+
+   Pid = OsCreate(Worker, 16384, 10, "Worker", NULL);
+   OsSleep(1);
+   return Pid;
+}
+
+
+static int Finished( void )            /* Did a worker get the lock?         */
+{
+   return OsWaitTimeout(Done, PATIENCE) == SYSOK;
+}
+
+
+static void Driver( char *Data )
+{
+   HANDLE   Victim;
+
+   /*------------------------------------------------------------------------*/
+   /* Readers first. A reader killed behind a writer must not be counted     */
+   /* when the lock is handed to the readers, or a writer waits forever...   */
+   /*------------------------------------------------------------------------*/
+   OsRwCreate(&Rw, 0);
+   OsRwWrite(&Rw);
+   Victim = Start(Reader);
+   Start(Reader);
+   OsKill(Victim);
+   OsRwUnlock(&Rw);
+   Check(Finished(), "Reader after killed reader");
+   Start(Writer);
+   Check(Finished(), "Writer after killed reader");
+
+   /*------------------------------------------------------------------------*/
+   /* Writers first. A writer killed behind a reader must neither get the    */
+   /* lock handed to it nor keep a waiting reader out...                     */
+   /*------------------------------------------------------------------------*/
+   OsRwDelete(&Rw);
+   OsRwCreate(&Rw, OS_RW_WRITERS);
+   OsRwRead(&Rw);
+   Victim = Start(Writer);
+   Start(Reader);                      /* Held off by the waiting writer.    */
+   OsKill(Victim);
+   OsRwUnlock(&Rw);
+   Check(Finished(), "Reader after killed writer");
+   Start(Writer);
+   Check(Finished(), "Writer after killed writer");
+
+   /*------------------------------------------------------------------------*/
+   /* The only waiter killed: the lock is free again, fast paths and all...  */
+   /*------------------------------------------------------------------------*/
+   OsRwWrite(&Rw);
+   Victim = Start(Writer);
+   OsKill(Victim);
+   OsRwUnlock(&Rw);
+   Check(Rw.State == 0, "Free after only waiter killed");
+   Check(OsRwRead(&Rw) == SYSOK && OsRwUnlock(&Rw) == SYSOK, "Reader again");
+   OsRwDelete(&Rw);
+
+   printf("testrw %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Reader( char *Data )
+{
+   if (OsRwRead(&Rw) == SYSOK) {
+      OsRwUnlock(&Rw);
+      OsPost(Done);
+   }
+}
+
+
+static void Writer( char *Data )
+{
+   if (OsRwWrite(&Rw) == SYSOK) {
+      OsRwUnlock(&Rw);
+      OsPost(Done);
+   }
+}
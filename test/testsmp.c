@@ -0,0 +1,138 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTSMP.C                                             */
+/*                                                                           */
+/*             Title:  Test multiple CPU (OS_SMP) scheduling.                */
+/*                                                                           */
+/*       Description:  Several workers on several CPUs share a counter       */
+/*                     guarded by a semaphore, and another guarded by a fast */
+/*                     semaphore, and send messages to one collector, so     */
+/*                     posts, message sends and receives wake processes on   */
+/*                     other CPUs. Checks that nothing is lost and reports   */
+/*                     how many CPUs did work.                               */
+/*                                                                           */
+/*                     Usage: testsmp [cpus] [loops]                         */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  NWORK        8                /* Worker processes.                  */
+#define  EVERY        16               /* Worker sends a message this often. */
+
+static void Worker(    char *Data );
+static void Collector( char *Data );
+
+static long          Loops = 20000;
+static long          Shared;           /* Guarded by Mutex.                  */
+static long          FastShared;       /* Guarded by FastMutex.              */
+static long          Received;         /* Messages collected.                */
+static volatile long CpuMask;          /* CPUs that ran a worker.            */
+
+static HANDLE        Mutex;
+static FASTSEM       FastMutex;
+static HANDLE        Done;
+static HANDLE        CollPid;
+
+
+int main( int argc, char *argv[] )
+{
+   struct timespec   t0, t1;
+   int               Cpus = 4;
+   int               i, n, ok;
+
+   if (argc > 1)
+      Cpus  = atoi(argv[1]);
+   if (argc > 2)
+      Loops = atol(argv[2]);
+
+   OsInit();
+   n = OsSmpStart(Cpus);
+
+   Mutex = OsSemCreate(1);
+   OsFastSemCreate(&FastMutex, 1);
+   Done  = OsSemCreate(0);
+
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+
+   CollPid = OsCreate(Collector, 16384, 12, "Collect", NULL);
+   for (i = 0; i < NWORK; i++)
+      OsCreate(Worker, 16384, 10, "Worker", NULL);
+
+   for (i = 0; i < NWORK + 1; i++)     /* Workers and collector finish.      */
+      OsWait(Done);
+
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+
+   ok = Shared   == NWORK * Loops &&
+        FastShared == NWORK * Loops &&
+        Received == NWORK * (Loops / EVERY);
+
+   printf("cpus %d  shared %ld/%ld  fast %ld/%ld  messages %ld/%ld  cpus used %d  "
+          "%.1f ms  %s\n",
+          n, Shared, NWORK * Loops, FastShared, NWORK * Loops, Received, NWORK * (Loops / EVERY),
+          __builtin_popcountl(CpuMask),
+          (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+          ok ? "ok" : "FAILED");
+
+   OsTerm();
+   return ok ? 0 : 1;
+}
+
+
+static void Worker( char *Data )
+{
+   volatile long  Spin;
+   long           i;
+
+   for (i = 1; i <= Loops; i++) {
+      for (Spin = 0; Spin < 200; Spin++)   /* Some work outside kernel.      */
+         ;
+
+      OsWait(Mutex);
+      Shared++;
+      OsPost(Mutex);
+
+      OsFastWait(&FastMutex);
+      FastShared++;
+      OsFastPost(&FastMutex);
+
+      if (i % EVERY == 0)
+         OsMsgSend(CollPid, &i, sizeof(i), False);
+
+      __atomic_fetch_or(&CpuMask, 1L << OsCpu()->Id, __ATOMIC_RELAXED);
+   }
+
+   OsPost(Done);
+}
+
+
+static void Collector( char *Data )
+{
+   void  *Msg;
+   int    Length;
+
+   while (Received < NWORK * (Loops / EVERY)) {
+      if (OsMsgRecv(&Msg, &Length, True) == SYSOK) {
+         Received++;
+         OsFree(Msg);
+      }
+   }
+
+   OsPost(Done);
+}
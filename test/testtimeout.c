@@ -0,0 +1,218 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTTIMEOUT.C                                         */
+/*                                                                           */
+/*             Title:  Test timed waits.                                     */
+/*                                                                           */
+/*       Description:  OsWaitTimeout(), OsLockTimeout(), OsMsgRecvTimeout(), */
+/*                     OsMsgSendTimeout() and OsSuspendTimeout() each time   */
+/*                     out, and each succeeds when what it waits for comes   */
+/*                     first. After a timeout the waiter must be off the     */
+/*                     semaphore or lock, with counts and lent priority      */
+/*                     given back, and no timer left behind; a message sent  */
+/*                     too late stays queued and its receiver readies no     */
+/*                     one. Also kills a process waiting on a semaphore and  */
+/*                     checks the count is given back.                       */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "oskernel.h"
+
+#define  DRIVER       20
+#define  OTHER        10
+
+static void Driver( char *Data );
+static void Poster( char *Data );
+static void Holder( char *Data );
+static void Waiter( char *Data );
+static void Sink(   char *Data );
+
+static HANDLE  Sem, Go, Done;
+static HANDLE  Lock;
+static HANDLE  DriverPid;
+static int     Failed;
+
+
+static double Now( void )
+{
+   struct timespec   Ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &Ts);
+   return Ts.tv_sec * 1e3 + Ts.tv_nsec / 1e6;
+}
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   Sem  = OsSemCreate(0);
+   Go   = OsSemCreate(0);
+   Done = OsSemCreate(0);
+
+   if ((DriverPid = OsCreate(Driver, 16384, DRIVER, "Driver", NULL))
+       == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   PROCESS *Me = CurrProc;
+   HANDLE   Pid;
+   void    *Msg;
+   int      Length;
+   double   Start, Took;
+
+   /*------------------------------------------------------------------------*/
+   /* Semaphores...                                                          */
+   /*------------------------------------------------------------------------*/
+   Check(OsWaitTimeout(Sem, 0) == SYSTIMEOUT, "OsWaitTimeout(0)");
+
+   Start = Now();
+   Check(OsWaitTimeout(Sem, 5) == SYSTIMEOUT, "OsWaitTimeout expires");
+   Took  = Now() - Start;
+   Check(Took >= 45 && Took < 500, "OsWaitTimeout time");
+
+   OsPost(Sem);                        /* Count must be back to 0, so 1 now. */
+   Check(OsWaitTimeout(Sem, 0) == SYSOK, "Count given back");
+
+   OsCreate(Poster, 16384, OTHER, "Poster", NULL);
+   Check(OsWaitTimeout(Sem, 100) == SYSOK, "OsWaitTimeout posted");
+   Check(Me->Timer == NULL && ChainFirst(&EventAnchor) == NULL,
+         "Timer stopped");
+
+   /*------------------------------------------------------------------------*/
+   /* Locks...                                                               */
+   /*------------------------------------------------------------------------*/
+   Pid = OsCreate(Holder, 16384, OTHER, "Holder", NULL);
+   OsWait(Done);                       /* Holder has the lock.               */
+   Check(OsLockTimeout(&Lock, 0) == SYSTIMEOUT, "OsLockTimeout(0)");
+   Check(OsLockTimeout(&Lock, 3) == SYSTIMEOUT, "OsLockTimeout expires");
+   Check(((PROCESS *) OsHandFind(ProcessAnchor, Pid))->Prio == OTHER,
+         "Lent priority taken back");
+   OsPost(Go);                         /* Holder unlocks after a sleep.      */
+   Check(OsLockTimeout(&Lock, 100) == SYSOK && Lock == DriverPid,
+         "OsLockTimeout locked");
+   OsUnlock(&Lock);
+   OsWait(Done);
+
+   /*------------------------------------------------------------------------*/
+   /* Messages...                                                            */
+   /*------------------------------------------------------------------------*/
+   Check(OsMsgRecvTimeout(&Msg, &Length, 0) == SYSTIMEOUT,
+         "OsMsgRecvTimeout(0)");
+   Check(OsMsgRecvTimeout(&Msg, &Length, 3) == SYSTIMEOUT,
+         "OsMsgRecvTimeout expires");
+   OsCreate(Poster, 16384, OTHER, "Poster", (char *) 1);
+   if (OsMsgRecvTimeout(&Msg, &Length, 100) == SYSOK)
+      OsFree(Msg);
+   else
+      Check(0, "OsMsgRecvTimeout received");
+   OsWait(Sem);                        /* Poster has finished.               */
+
+   Pid = OsCreate(Sink, 16384, OTHER, "Sink", NULL);
+   Check(OsMsgSendTimeout(Pid, "hi", 3, 3) == SYSTIMEOUT,
+         "OsMsgSendTimeout expires");
+   OsPost(Go);                         /* Sink takes it late, readies no one.*/
+   OsWait(Done);
+   Pid = OsCreate(Sink, 16384, OTHER, "Sink", NULL);
+   OsPost(Go);
+   Check(OsMsgSendTimeout(Pid, "hi", 3, 100) == SYSOK,
+         "OsMsgSendTimeout received");
+   OsWait(Done);
+
+   /*------------------------------------------------------------------------*/
+   /* Suspend...                                                             */
+   /*------------------------------------------------------------------------*/
+   Check(OsSuspendTimeout(3) == SYSTIMEOUT, "OsSuspendTimeout expires");
+   OsCreate(Poster, 16384, OTHER, "Poster", (char *) 2);
+   Check(OsSuspendTimeout(100) == SYSOK, "OsSuspendTimeout resumed");
+   OsWait(Sem);
+
+   /*------------------------------------------------------------------------*/
+   /* Killing a waiter gives back its count...                               */
+   /*------------------------------------------------------------------------*/
+   Pid = OsCreate(Waiter, 16384, OTHER, "Waiter", NULL);
+   OsSleep(1);                         /* Waiter waits on Sem.               */
+   OsKill(Pid);
+   OsPost(Sem);
+   Check(OsWaitTimeout(Sem, 0) == SYSOK, "Killed waiter off semaphore");
+
+   Check(ChainFirst(&EventAnchor) == NULL, "No timers left");
+
+   printf("testtimeout %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Poster( char *Data )       /* Posts, sends or resumes Driver.    */
+{
+   OsSleep(1);
+
+   switch ((int) (long) Data) {
+      case 0:  OsPost(Sem);                                    break;
+      case 1:  OsMsgSend(DriverPid, "hi", 3, False);  OsPost(Sem);  break;
+      case 2:  OsResume(DriverPid);                   OsPost(Sem);  break;
+   }
+}
+
+
+static void Holder( char *Data )
+{
+   OsLock(&Lock);
+   OsPost(Done);
+   OsWait(Go);
+   OsSleep(1);
+   OsUnlock(&Lock);
+   OsPost(Done);
+}
+
+
+static void Waiter( char *Data )
+{
+   OsWait(Sem);
+}
+
+
+static void Sink( char *Data )         /* Receives one message when told to. */
+{
+   void    *Msg;
+   int      Length;
+
+   OsWait(Go);
+   if (OsMsgRecv(&Msg, &Length, True) == SYSOK)
+      OsFree(Msg);
+   OsPost(Done);
+}
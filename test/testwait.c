@@ -0,0 +1,167 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTWAIT.C                                            */
+/*                                                                           */
+/*             Title:  Test OsWaitAny() and OsWaitAll().                     */
+/*                                                                           */
+/*       Description:  One process waits on two semaphores and its message   */
+/*                     queue while a helper posts or sends. Checks the index */
+/*                     returned, that counts are taken, timeouts, deleting a */
+/*                     watched semaphore, killing a watching process, and    */
+/*                     that no watches are left behind. (No device driver    */
+/*                     runs on the host, so devices are not tried.)          */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "oskernel.h"
+
+static void Driver( char *Data );
+static void Helper( char *Data );
+static void Victim( char *Data );
+
+static HANDLE  A, B;
+static HANDLE  DriverPid;
+static int     Failed;
+
+
+static void Check( int Ok, char *What )
+{
+   if (!Ok) {
+      printf("%s FAILED\n", What);
+      Failed++;
+   }
+}
+
+
+static int Count( HANDLE Sem )         /* Count of a semaphore.              */
+{
+   return ((SEMAPHORE *) OsHandFind(SemaphoreAnchor, Sem))->Count;
+}
+
+
+static int Watched( HANDLE Sem )       /* Someone watching a semaphore?      */
+{
+   return ChainFirst(&((SEMAPHORE *) OsHandFind(SemaphoreAnchor, Sem))
+                     ->Watchers) != NULL;
+}
+
+
+int main( int argc, char *argv[] )
+{
+   OsInit();
+
+   A = OsSemCreate(0);
+   B = OsSemCreate(0);
+
+   if ((DriverPid = OsCreate(Driver, 16384, 20, "Driver", NULL)) == SYSERR) {
+      fprintf(stderr, "OsCreate() error\n");
+      exit(1);
+   }
+
+   for (;;)
+      OsIdle();
+}
+
+
+static void Driver( char *Data )
+{
+   WAITOBJ  List[3];
+   HANDLE   C, Pid;
+   void    *Msg;
+   int      Length;
+
+   List[0].Type = OS_WAIT_SEM;  List[0].Handle = A;
+   List[1].Type = OS_WAIT_SEM;  List[1].Handle = B;
+   List[2].Type = OS_WAIT_MSG;  List[2].Handle = 0;
+
+   /*------------------------------------------------------------------------*/
+   /* Any...                                                                 */
+   /*------------------------------------------------------------------------*/
+   Check(OsWaitAny(List, 3, 0) == SYSTIMEOUT, "OsWaitAny(0)");
+   Check(OsWaitAny(List, 3, 3) == SYSTIMEOUT, "OsWaitAny expires");
+   Check(!Watched(A) && !Watched(B), "Watches down after timeout");
+
+   OsPost(A);
+   Check(OsWaitAny(List, 3, -1) == 0 && Count(A) == 0, "Ready at once");
+
+   OsCreate(Helper, 16384, 10, "Helper", (char *) 1);
+   Check(OsWaitAny(List, 3, 100) == 1 && Count(B) == 0, "Posted B");
+
+   OsCreate(Helper, 16384, 10, "Helper", (char *) 2);
+   Check(OsWaitAny(List, 3, 100) == 2, "Message");
+   if (OsMsgRecvTimeout(&Msg, &Length, 0) == SYSOK)
+      OsFree(Msg);
+
+   /*------------------------------------------------------------------------*/
+   /* All...                                                                 */
+   /*------------------------------------------------------------------------*/
+   OsPost(A);
+   Check(OsWaitAll(List, 2, 3) == SYSTIMEOUT && Count(A) == 1,
+         "OsWaitAll expires, takes nothing");
+   OsCreate(Helper, 16384, 10, "Helper", (char *) 1);
+   Check(OsWaitAll(List, 2, 100) == SYSOK && Count(A) == 0 && Count(B) == 0,
+         "OsWaitAll takes both");
+
+   /*------------------------------------------------------------------------*/
+   /* Deleting and killing...                                                */
+   /*------------------------------------------------------------------------*/
+   C = OsSemCreate(0);
+   List[1].Handle = C;
+   OsCreate(Helper, 16384, 10, "Helper", (char *) C);
+   Check(OsWaitAny(List, 2, 100) == 1, "Deleted semaphore fires");
+   List[1].Handle = B;
+
+   Pid = OsCreate(Victim, 16384, 10, "Victim", NULL);
+   OsSleep(1);
+   Check(Watched(A) && Watched(B), "Victim watching");
+   OsKill(Pid);
+   Check(!Watched(A) && !Watched(B), "Watches down after kill");
+   OsPost(A);
+   Check(Count(A) == 1, "Count untouched by killed watcher");
+
+   Check(!Watched(A) && !Watched(B) && ChainFirst(&EventAnchor) == NULL,
+         "Nothing left behind");
+
+   printf("testwait %s\n", Failed ? "FAILED" : "ok");
+
+   OsTerm();
+   exit(Failed ? 1 : 0);
+}
+
+
+static void Helper( char *Data )       /* 1: post B, 2: send, else delete.   */
+{
+   OsSleep(1);
+
+   if (Data == (char *) 1)
+      OsPost(B);
+   else if (Data == (char *) 2)
+      OsMsgSend(DriverPid, "hi", 3, False);
+   else
+      OsSemDelete((HANDLE) Data);
+}
+
+
+static void Victim( char *Data )
+{
+   WAITOBJ  List[2];
+
+   List[0].Type = OS_WAIT_SEM;  List[0].Handle = A;
+   List[1].Type = OS_WAIT_SEM;  List[1].Handle = B;
+
+   OsWaitAny(List, 2, -1);
+}
@@ -0,0 +1,134 @@
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*               *******************************************                 */
+/*               *                                         *                 */
+/*               *              OS KERNEL                  *                 */
+/*               *                                         *                 */
+/*               *  COPYRIGHT (c) 1994 by JOHN C. OVERTON  *                 */
+/*               *                                         *                 */
+/*               *******************************************                 */
+/*                                                                           */
+/*            Module:  TESTWAKE.C                                            */
+/*                                                                           */
+/*             Title:  Test idle CPUs (OS_SMP) are woken for what they own.  */
+/*                                                                           */
+/*       Description:  Round after round, the INIT process, which runs at    */
+/*                     priority 0 on CPU 0, starts a receiver and a few      */
+/*                     senders and waits for them. They spread out over the  */
+/*                     other CPUs and kick each other, and the last to       */
+/*                     finish readies INIT from there while CPU 0 sleeps     */
+/*                     with no tick. Only CPU 0 may run INIT, so it must be  */
+/*                     kicked awake. A watchdog host thread fails the test   */
+/*                     if nothing is received and no round ends for a        */
+/*                     while, rather than letting it hang.                   */
+/*                                                                           */
+/*                     Usage: testwake [cpus] [rounds]                       */
+/*                                                                           */
+/*            Author:  John C. Overton                                       */
+/*                                                                           */
+/*              Date:  10/18/26                                              */
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "oskernel.h"
+
+#define  NSEND        8                /* Senders each round.                */
+#define  NEACH        30000            /* Messages each sender sends.        */
+#define  STALL        5                /* Seconds without progress is a hang.*/
+
+static void  Sender(   char *Data );
+static void  Receiver( char *Data );
+static void *Watchdog( void *Arg );
+
+static long          Rounds = 100;
+static volatile long Round;            /* Rounds finished so far.            */
+static volatile long Received;         /* Messages received so far.          */
+static HANDLE        RecvPid;
+static HANDLE        Done;
+
+
+int main( int argc, char *argv[] )
+{
+   pthread_t   Dog;
+   int         Cpus = 4;
+   int         i, n;
+
+   if (argc > 1)
+      Cpus   = atoi(argv[1]);
+   if (argc > 2)
+      Rounds = atol(argv[2]);
+
+   pthread_create(&Dog, NULL, Watchdog, NULL);
+
+   OsInit();
+   n = OsSmpStart(Cpus);
+
+   Done = OsSemCreate(0);
+
+   for (Round = 0; Round < Rounds; Round++) {
+      RecvPid = OsCreate(Receiver, 16384, 10, "Receiver", NULL);
+      for (i = 0; i < NSEND; i++)
+         OsCreate(Sender, 16384, 10, "Sender", NULL);
+      for (i = 0; i < NSEND + 1; i++)
+         OsWait(Done);                 /* Senders, then the receiver.        */
+   }
+
+   printf("testwake: cpus %d  rounds %ld  ok\n", n, Rounds);
+
+   OsTerm();
+   return 0;
+}
+
+
+static void Sender( char *Data )
+{
+   long     i;
+
+   for (i = 0; i < NEACH; i++)
+      OsMsgSend(RecvPid, &i, sizeof(i), False);
+
+   OsPost(Done);
+}
+
+
+static void Receiver( char *Data )
+{
+   void    *Msg;
+   int      Length;
+   long     i;
+
+   for (i = 0; i < NSEND * NEACH; i++) {
+      OsMsgRecv(&Msg, &Length, True);
+      OsFree(Msg);
+      Received++;
+   }
+
+   OsPost(Done);
+}
+
+
+static void *Watchdog( void *Arg )
+{
+   sigset_t    All;
+   long        Last = -1;
+   long        Now;
+
+   sigfillset(&All);                   /* Leave ticks and kicks to the CPUs. */
+   pthread_sigmask(SIG_BLOCK, &All, NULL);
+
+   for (;;) {
+      sleep(STALL);
+      if ((Now = Round + Received) == Last) {
+         printf("testwake: hung in round %ld  FAILED\n", Round);
+         fflush(stdout);
+         _exit(1);
+      }
+      Last = Now;
+   }
+   return NULL;
+}